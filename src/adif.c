@@ -0,0 +1,367 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * adif.c - read ADIF logs, and count up what's been worked
+ *
+ * An ADIF file is fields like <CALL:5>K7IHZ, each record ending with
+ * <EOR>, perhaps after a header ending with <EOH>. The file is mapped, and
+ * the fields are found in place, without copying: each tag gives the
+ * length of the value after it, so values are skipped over, never scanned.
+ *
+ * A log of hundreds of thousands of QSOs is counted up in parallel: one
+ * pass finds where every ADIF_CHUNK'th record starts, then the thread pool
+ * takes the chunks between those, each thread looking up the callsigns in
+ * its chunks and counting into its own adif_stats, and finally those are
+ * added together. The first pass only reads tags, so it's quick; and
+ * because it follows the lengths, a value that happens to contain "<EOR>"
+ * can't throw it off, as searching for it would.
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dxcc.h"
+#include "awards_enum.h"
+#include "locator.h"
+#include "threadpool.h"
+
+#define ADIF_CHUNK 256 /* records */
+#define MAX_TAG 64 /* longer tags are taken as text */
+
+/*!
+    Find the next field in the \a size bytes of \a data, from \a offset:
+    \a field is set to point at its name and value in \a data (the value is
+    NULL for a tag without one, like <EOR>). Returns the offset after it,
+    or \a size if there are no more. Text between fields is skipped, and so
+    is a '<' that doesn't begin a tag.
+ */
+size_t adif_next_field(const char* data, size_t size, size_t offset, adif_field* field)
+{
+	while (offset < size) {
+		const char *tag = memchr(data + offset, '<', size - offset), *p, *end;
+		size_t length = 0;
+		bool has_length = false;
+
+		if (!tag)
+			return size;
+		offset = tag - data + 1;
+		end = data + MIN(size, offset + MAX_TAG);
+		for (p = tag + 1; p < end && *p != ':' && *p != '>'; ++p)
+			;
+		if (p == end || p == tag + 1)
+			continue;
+		field->name = tag + 1;
+		field->name_length = p - field->name;
+		if (*p == ':') {
+			for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+				length = length * 10 + *p - '0';
+				has_length = true;
+			}
+			/* then maybe :type */
+			while (p < end && *p != '>')
+				++p;
+			if (p == end || !has_length)
+				continue;
+		}
+		++p;
+		if (has_length && length > (size_t)(data + size - p))
+			length = data + size - p;
+		field->value = has_length ? p : NULL;
+		field->length = length;
+		return p - data + length;
+	}
+	return size;
+}
+
+/* whether \a field is called \a name, which is in upper case */
+static bool is_field(const adif_field* field, const char* name)
+{
+	unsigned int i;
+
+	for (i = 0; i < field->name_length && name[i]; ++i)
+		if (toupper((uchar)field->name[i]) != name[i])
+			return false;
+	return i == field->name_length && !name[i];
+}
+
+/* the value of \a field, terminated, in \a buf of \a size bytes; empty if it doesn't fit */
+static const char* field_value(const adif_field* field, char* buf, size_t size)
+{
+	if (!field->value || field->length >= size)
+		field = NULL;
+	memcpy(buf, field ? field->value : "", field ? field->length : 0);
+	buf[field ? field->length : 0] = '\0';
+	return buf;
+}
+
+adif_stats* adif_stats_new(const dxcc_context* ctx)
+{
+	adif_stats* stats = g_new0(adif_stats, 1);
+
+	stats->nentities = dxcc_context_entities(ctx);
+	stats->entity_qsos = g_new0(unsigned int, stats->nentities ? stats->nentities : 1);
+	stats->awards = awards_new();
+	return stats;
+}
+
+void adif_stats_free(adif_stats* stats)
+{
+	if (!stats)
+		return;
+	g_free(stats->entity_qsos);
+	awards_free(stats->awards);
+	g_free(stats);
+}
+
+/* add the counts of \a from to \a to */
+static void stats_merge(adif_stats* to, const adif_stats* from)
+{
+	to->qsos += from->qsos;
+	to->unknown += from->unknown;
+	to->located += from->located;
+	to->confirmed += from->confirmed;
+	for (unsigned int i = 0; i < to->nentities && i < from->nentities; ++i)
+		to->entity_qsos[i] += from->entity_qsos[i];
+	for (int i = 0; i < AWARD_BANDS; ++i)
+		to->band_qsos[i] += from->band_qsos[i];
+	for (int i = 0; i < AWARD_MODES; ++i)
+		to->mode_qsos[i] += from->mode_qsos[i];
+	awards_merge(to->awards, from->awards);
+}
+
+/* the fields of a record that count */
+typedef struct
+{
+	adif_field call, grid, band, freq, mode, qsl, lotw, state, iota, cqz;
+} qso_fields;
+
+typedef struct
+{
+	const char* data;
+	size_t size;
+	const size_t* starts; /* of every ADIF_CHUNK'th record, and then the end */
+	const dxcc_context* ctx;
+	const zone_map* zones;
+	adif_stats** stats; /* for each worker, made when it first needs it */
+} adif_job;
+
+/* count one QSO into \a stats */
+static void count_qso(const adif_job* job, adif_stats* stats, const qso_fields* f, dxcc_scratch* scratch)
+{
+	char call[DXCC_MAX_CALLSIGN + 1], grid[11], buf[32];
+	double longitude, latitude;
+	bool confirmed, located;
+	int band, mode, country;
+	dxcc_data info;
+
+	++stats->qsos;
+	field_value(&f->call, call, sizeof(call));
+	for (char* c = call; *c; ++c)
+		*c = toupper((uchar)*c);
+	country = dxcc_lookup(job->ctx, call, &info, scratch);
+	if (country <= 0) {
+		++stats->unknown;
+		return;
+	}
+	if ((unsigned int)country < stats->nentities)
+		++stats->entity_qsos[country];
+
+	band = awards_band(field_value(&f->band, buf, sizeof(buf)));
+	if (band < 0 && f->freq.value)
+		band = awards_band_from_freq(atof(field_value(&f->freq, buf, sizeof(buf))));
+	mode = awards_mode(field_value(&f->mode, buf, sizeof(buf)));
+	if (band >= 0)
+		++stats->band_qsos[band];
+	if (mode >= 0)
+		++stats->mode_qsos[mode];
+	confirmed = (f->qsl.length && (*f->qsl.value | 0x20) == 'y')
+	    || (f->lotw.length && (*f->lotw.value | 0x20) == 'y');
+	stats->confirmed += confirmed;
+
+	/* the grid says where it was, and so maybe its zones; but the logged zone comes first */
+	located = locator2longlat(&longitude, &latitude, field_value(&f->grid, grid, sizeof(grid))) == RIG_OK;
+	if (located) {
+		++stats->located;
+		info.longitude = longitude;
+		info.latitude = latitude;
+		set_zones_from_location(&info, job->zones);
+		awards_add(stats->awards, AWARD_LOCATOR, locator_to_num(grid), band, mode, confirmed);
+	}
+	if (f->cqz.value) {
+		int zone = atoi(field_value(&f->cqz, buf, sizeof(buf)));
+
+		/* a zone out of range is a typo, and the one we know is better */
+		if (zone >= 1 && zone <= MAX_ZONES)
+			info.cq = zone;
+	}
+
+	awards_add(stats->awards, AWARD_DXCC, country, band, mode, confirmed);
+	awards_add(stats->awards, AWARD_WAZ, info.cq, band, mode, confirmed);
+	awards_add(stats->awards, AWARD_WAC, info.continent, band, mode, confirmed);
+	if (f->state.value && !strcmp(info.countryname, "United States"))
+		awards_add(stats->awards, AWARD_WAS, state_to_enum((char*)field_value(&f->state, buf, sizeof(buf))),
+		    band, mode, confirmed);
+	if (f->iota.value)
+		awards_add(stats->awards, AWARD_IOTA, iota_to_num((char*)field_value(&f->iota, buf, sizeof(buf))),
+		    band, mode, confirmed);
+}
+
+/* count the records of chunks [begin .. end) */
+static void read_range(void* data, int worker, size_t begin, size_t end)
+{
+	adif_job* job = data;
+	size_t offset = job->starts[begin], stop = job->starts[end];
+	adif_stats* stats = job->stats[worker];
+	dxcc_scratch scratch;
+	qso_fields f;
+	adif_field field;
+
+	if (!stats)
+		stats = job->stats[worker] = adif_stats_new(job->ctx);
+	memset(&f, 0, sizeof(f));
+	while (offset < stop) {
+		field.name = NULL;
+		offset = adif_next_field(job->data, stop, offset, &field);
+		if (!field.name)
+			break;
+		switch (toupper((uchar)field.name[0])) {
+		case 'B':
+			if (is_field(&field, "BAND"))
+				f.band = field;
+			break;
+		case 'C':
+			if (is_field(&field, "CALL"))
+				f.call = field;
+			else if (is_field(&field, "CQZ"))
+				f.cqz = field;
+			break;
+		case 'E':
+			if (is_field(&field, "EOR")) {
+				count_qso(job, stats, &f, &scratch);
+				memset(&f, 0, sizeof(f));
+			}
+			break;
+		case 'F':
+			if (is_field(&field, "FREQ"))
+				f.freq = field;
+			break;
+		case 'G':
+			if (is_field(&field, "GRIDSQUARE"))
+				f.grid = field;
+			break;
+		case 'I':
+			if (is_field(&field, "IOTA"))
+				f.iota = field;
+			break;
+		case 'L':
+			if (is_field(&field, "LOTW_QSL_RCVD"))
+				f.lotw = field;
+			break;
+		case 'M':
+			if (is_field(&field, "MODE"))
+				f.mode = field;
+			break;
+		case 'Q':
+			if (is_field(&field, "QSL_RCVD"))
+				f.qsl = field;
+			break;
+		case 'S':
+			if (is_field(&field, "STATE"))
+				f.state = field;
+			break;
+		}
+	}
+}
+
+/* where every ADIF_CHUNK'th record starts, and the end of the last one */
+static GArray* find_chunks(const char* data, size_t size)
+{
+	GArray* starts = g_array_new(FALSE, FALSE, sizeof(size_t));
+	size_t offset = 0, start = 0, records = 0;
+	adif_field field;
+
+	/* a header is anything before <EOH>, unless the file starts with a tag */
+	if (size && data[0] != '<') {
+		while (offset < size) {
+			field.name = NULL;
+			offset = adif_next_field(data, size, offset, &field);
+			if (field.name && is_field(&field, "EOH")) {
+				start = offset;
+				break;
+			}
+		}
+	}
+	g_array_append_val(starts, start);
+	for (offset = start; offset < size;) {
+		field.name = NULL;
+		offset = adif_next_field(data, size, offset, &field);
+		if (field.name && is_field(&field, "EOR") && ++records % ADIF_CHUNK == 0)
+			g_array_append_val(starts, offset);
+	}
+	if (records % ADIF_CHUNK)
+		g_array_append_val(starts, size);
+	return starts;
+}
+
+/*!
+    Read the ADIF log at \a path, look up the CALL of each QSO in \a ctx,
+    and add what was worked to \a stats (made with the same context): QSOs
+    by entity, band and mode, and the awards, with confirmed ones those
+    with QSL_RCVD or LOTW_QSL_RCVD = Y. The zone is the logged CQZ if
+    there is one, or else from GRIDSQUARE by \a zones (which may be NULL),
+    or else from cty.dat. Returns 0 on success, or 1 if the file can't be
+    read.
+
+    The file is read in place, and counted up by all the threads of the
+    pool at once.
+ */
+int adif_read(const char* path, const dxcc_context* ctx, const zone_map* zones, adif_stats* stats)
+{
+	adif_job job = { 0 };
+	GArray* starts;
+	struct stat st;
+	int fd, workers;
+
+	if (!ctx || !stats || (fd = open(path, O_RDONLY)) < 0)
+		return (1);
+	if (fstat(fd, &st)) {
+		close(fd);
+		return (1);
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return (0);
+	}
+	job.data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (job.data == MAP_FAILED)
+		return (1);
+	job.size = st.st_size;
+	job.ctx = ctx;
+	job.zones = zones;
+
+	starts = find_chunks(job.data, job.size);
+	job.starts = (const size_t*)starts->data;
+	workers = threadpool_size();
+	job.stats = g_new0(adif_stats*, workers);
+	threadpool_run(read_range, &job, starts->len - 1, 1);
+	for (int i = 0; i < workers; ++i) {
+		if (job.stats[i])
+			stats_merge(stats, job.stats[i]);
+		adif_stats_free(job.stats[i]);
+	}
+	g_free(job.stats);
+	g_array_free(starts, TRUE);
+	munmap((void*)job.data, job.size);
+	return (0);
+}
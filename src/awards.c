@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * awards.c - what's been worked and confirmed, for DXCC, WAZ, WAC, WAS,
+ * IOTA and grids, by band and mode
+ *
+ * Each award's items are numbered densely (entities, zones, continents and
+ * states as they are; IOTA and locators packed from iota_to_num() and
+ * locator_to_num()), and for each band and mode there's a bitset of the
+ * items worked and another of those confirmed. There are also bitsets for
+ * any band, any mode, and both, so that "is it new on this band?" is one
+ * bit test like the rest, and so is counting.
+ *
+ * For each award, the bitsets are laid out one after another: worked then
+ * confirmed, for each mode (and then any mode), for each band (and then
+ * any band).
+ */
+
+#include <string.h>
+
+#include "dxcc.h"
+#include "awards_enum.h"
+
+#define MAX_ENTITIES 1024
+#define LOCATOR_SQUARES (180 * 180)
+#define SLOTS ((AWARD_BANDS + 1) * (AWARD_MODES + 1) * 2)
+
+struct awards
+{
+	guint64* bits[NB_AWARDS];
+	guint words[NB_AWARDS]; /* in each bitset */
+};
+
+/* ADIF band names, and their edges in MHz */
+static const struct
+{
+	const char* name;
+	double low, high;
+} bands[AWARD_BANDS] = {
+	{ "2190m", 0.1357, 0.1378 }, { "630m", 0.472, 0.479 }, { "560m", 0.501, 0.504 },
+	{ "160m", 1.8, 2.0 }, { "80m", 3.5, 4.0 }, { "60m", 5.06, 5.45 }, { "40m", 7.0, 7.3 },
+	{ "30m", 10.1, 10.15 }, { "20m", 14.0, 14.35 }, { "17m", 18.068, 18.168 },
+	{ "15m", 21.0, 21.45 }, { "12m", 24.89, 24.99 }, { "10m", 28.0, 29.7 }, { "8m", 40.0, 45.0 },
+	{ "6m", 50.0, 54.0 }, { "5m", 54.000001, 69.9 }, { "4m", 70.0, 71.0 }, { "2m", 144.0, 148.0 },
+	{ "1.25m", 222.0, 225.0 }, { "70cm", 420.0, 450.0 }, { "33cm", 902.0, 928.0 },
+	{ "23cm", 1240.0, 1300.0 }, { "13cm", 2300.0, 2450.0 }, { "9cm", 3300.0, 3500.0 },
+	{ "6cm", 5650.0, 5925.0 }, { "3cm", 10000.0, 10500.0 }, { "1.25cm", 24000.0, 24250.0 },
+	{ "6mm", 47000.0, 47200.0 }, { "4mm", 75500.0, 81000.0 }, { "2.5mm", 119980.0, 123000.0 },
+	{ "2mm", 134000.0, 149000.0 }, { "1mm", 241000.0, 250000.0 }, { "submm", 300000.0, 7500000.0 },
+};
+
+/* how many items each award has */
+static guint award_items(int award)
+{
+	switch (award) {
+	case AWARD_DXCC:
+		return MAX_ENTITIES;
+	case AWARD_WAZ:
+		return MAX_ZONES + 1;
+	case AWARD_WAC:
+		return MAX_CONTINENTS;
+	case AWARD_WAS:
+		return MAX_STATES;
+	case AWARD_IOTA:
+		return MAX_IOTA_CONTINENTS * 1000;
+	case AWARD_LOCATOR:
+		return LOCATOR_SQUARES;
+	}
+	return 0;
+}
+
+awards* awards_new(void)
+{
+	awards* a = g_new0(awards, 1);
+
+	for (int i = 0; i < NB_AWARDS; ++i) {
+		a->words[i] = (award_items(i) + 63) / 64;
+		a->bits[i] = g_new0(guint64, (gsize)a->words[i] * SLOTS);
+	}
+	return a;
+}
+
+void awards_free(awards* a)
+{
+	if (!a)
+		return;
+	for (int i = 0; i < NB_AWARDS; ++i)
+		g_free(a->bits[i]);
+	g_free(a);
+}
+
+/* the band that \a band (an ADIF band name, in either case) is, or -1 */
+int awards_band(const char* band)
+{
+	for (int i = 0; band && i < AWARD_BANDS; ++i)
+		if (!g_ascii_strcasecmp(band, bands[i].name))
+			return i;
+	return -1;
+}
+
+/* the band that \a mhz is in, or -1 */
+int awards_band_from_freq(double mhz)
+{
+	for (int i = 0; i < AWARD_BANDS; ++i)
+		if (mhz >= bands[i].low && mhz <= bands[i].high)
+			return i;
+	return -1;
+}
+
+/* the ADIF name of \a band */
+const char* awards_band_name(int band)
+{
+	return band >= 0 && band < AWARD_BANDS ? bands[band].name : NULL;
+}
+
+/*!
+    The award mode of an ADIF \a mode: AWARD_MODE_CW, AWARD_MODE_PHONE (SSB,
+    AM, FM and digital voice) or AWARD_MODE_DATA (everything else); or -1 if
+    it's empty.
+ */
+int awards_mode(const char* mode)
+{
+	static const char* const phone[] = { "SSB", "USB", "LSB", "AM", "FM", "DIGITALVOICE", "PHONE" };
+
+	if (!mode || !*mode)
+		return -1;
+	if (!g_ascii_strcasecmp(mode, "CW"))
+		return AWARD_MODE_CW;
+	for (size_t i = 0; i < sizeof(phone) / sizeof(phone[0]); ++i)
+		if (!g_ascii_strcasecmp(mode, phone[i]))
+			return AWARD_MODE_PHONE;
+	return AWARD_MODE_DATA;
+}
+
+/* the bit number of \a key in \a award, or -1 if it's out of range */
+static inline int item(int award, int key)
+{
+	int first, second, third, fourth;
+
+	switch (award) {
+	case AWARD_DXCC:
+		return key >= 0 && key < MAX_ENTITIES ? key : -1;
+	case AWARD_WAZ:
+		return key >= 1 && key <= MAX_ZONES ? key : -1;
+	case AWARD_WAC:
+		return key >= 0 && key < MAX_CONTINENTS ? key : -1;
+	case AWARD_WAS:
+		return key >= 0 && key < MAX_STATES ? key : -1;
+	case AWARD_IOTA:
+		return key >= 0 && key < MAX_IOTA_CONTINENTS * 1000 ? key : -1;
+	case AWARD_LOCATOR:
+		/* from 010100 .. 181899: fields from 1, squares from 0 */
+		first = key / 10000;
+		second = key / 100 % 100;
+		third = key / 10 % 10;
+		fourth = key % 10;
+		if (key < 0 || first < 1 || first > 18 || second < 1 || second > 18)
+			return -1;
+		return ((first - 1) * 10 + third) * 180 + (second - 1) * 10 + fourth;
+	}
+	return -1;
+}
+
+/* the bitset of \a award for \a band and \a mode (either may be AWARDS_ANY) */
+static inline guint64* bitset(const awards* a, int award, int band, int mode, bool confirmed)
+{
+	int slot;
+
+	if (band == AWARDS_ANY)
+		band = AWARD_BANDS;
+	if (mode == AWARDS_ANY)
+		mode = AWARD_MODES;
+	slot = (band * (AWARD_MODES + 1) + mode) * 2 + confirmed;
+	return a->bits[award] + (gsize)slot * a->words[award];
+}
+
+static inline bool valid(int award, int band, int mode)
+{
+	return award >= 0 && award < NB_AWARDS && band >= AWARDS_ANY && band < AWARD_BANDS
+	    && mode >= AWARDS_ANY && mode < AWARD_MODES;
+}
+
+static inline bool test(const guint64* set, int bit)
+{
+	return set[bit / 64] >> (bit % 64) & 1;
+}
+
+/*!
+    Record that \a key of \a award (see awards_check()) was worked on
+    \a band and in \a mode, either of which may be AWARDS_ANY if unknown,
+    and whether it's \a confirmed. Returns false if any of them is out of
+    range. Don't check anything in \a a from other threads meanwhile.
+ */
+bool awards_add(awards* a, int award, int key, int band, int mode, bool confirmed)
+{
+	int bit = valid(award, band, mode) ? item(award, key) : -1;
+	guint64 mask;
+
+	if (!a || bit < 0)
+		return false;
+	mask = 1ULL << (bit % 64);
+	for (int c = 0; c <= confirmed; ++c) {
+		bitset(a, award, band, mode, c)[bit / 64] |= mask;
+		bitset(a, award, band, AWARDS_ANY, c)[bit / 64] |= mask;
+		bitset(a, award, AWARDS_ANY, mode, c)[bit / 64] |= mask;
+		bitset(a, award, AWARDS_ANY, AWARDS_ANY, c)[bit / 64] |= mask;
+	}
+	return true;
+}
+
+/*!
+    What would be new about \a key of \a award on \a band and in \a mode:
+    AWARD_NEW if it was never worked (or if \a confirmed, never confirmed),
+    AWARD_NEW_BAND if not on \a band, AWARD_NEW_MODE if not in \a mode, and
+    AWARD_NEW_SLOT if not on both; 0 if it's nothing new, or out of range.
+    \a band or \a mode may be AWARDS_ANY, to leave it out.
+
+    The keys are: for AWARD_DXCC, the entity number from dxcc_lookup(); for
+    AWARD_WAZ, the CQ zone; for AWARD_WAC, the continent as in dxcc_data;
+    for AWARD_WAS, from state_to_enum(); for AWARD_IOTA, from iota_to_num();
+    and for AWARD_LOCATOR, from locator_to_num().
+ */
+unsigned int awards_check(const awards* a, int award, int key, int band, int mode, bool confirmed)
+{
+	int bit = a && valid(award, band, mode) ? item(award, key) : -1;
+
+	if (bit < 0)
+		return 0;
+	return !test(bitset(a, award, AWARDS_ANY, AWARDS_ANY, confirmed), bit) * AWARD_NEW
+	    | !test(bitset(a, award, band, AWARDS_ANY, confirmed), bit) * AWARD_NEW_BAND
+	    | !test(bitset(a, award, AWARDS_ANY, mode, confirmed), bit) * AWARD_NEW_MODE
+	    | !test(bitset(a, award, band, mode, confirmed), bit) * AWARD_NEW_SLOT;
+}
+
+/* whether \a key of \a award is AWARD_NEW_SLOT; just that one bit test */
+static inline unsigned int is_new(const awards* a, int award, int key, int band, int mode)
+{
+	int bit = item(award, key);
+
+	return bit >= 0 && !test(bitset(a, award, band, mode, false), bit);
+}
+
+/* locator_to_num() of the square that \a grid starts with, or -1 if it doesn't */
+static int square_key(const char* grid)
+{
+	int first = (grid[0] | 0x20) - 'a', second;
+
+	if (first < 0 || first >= 18)
+		return -1;
+	second = (grid[1] | 0x20) - 'a';
+	if (second < 0 || second >= 18 || grid[2] < '0' || grid[2] > '9' || grid[3] < '0' || grid[3] > '9')
+		return -1;
+	return (first + 1) * 10000 + (second + 1) * 100 + (grid[2] - '0') * 10 + grid[3] - '0';
+}
+
+/*!
+    Which awards a station heard on \a band in \a mode would count for, as
+    a bit (1 << award) for each, where it's AWARD_NEW_SLOT: its entity,
+    CQ zone and continent, from \a info, as dxcc_lookup() found them; and
+    its 4-character grid square, if \a grid (which may be NULL) starts
+    with one.
+ */
+unsigned int awards_needed(const awards* a, const dxcc_data* info, const char* grid, int band, int mode)
+{
+	unsigned int needed = 0;
+	int key;
+
+	if (!a || !info || !valid(0, band, mode))
+		return 0;
+	if (info->country) {
+		needed |= is_new(a, AWARD_DXCC, info->country, band, mode) << AWARD_DXCC;
+		needed |= is_new(a, AWARD_WAZ, info->cq, band, mode) << AWARD_WAZ;
+		needed |= is_new(a, AWARD_WAC, info->continent, band, mode) << AWARD_WAC;
+	}
+	if (grid && (key = square_key(grid)) >= 0)
+		needed |= is_new(a, AWARD_LOCATOR, key, band, mode) << AWARD_LOCATOR;
+	return needed;
+}
+
+/* how many items of \a award were worked, or \a confirmed, on \a band and in \a mode (or AWARDS_ANY) */
+unsigned int awards_count(const awards* a, int award, int band, int mode, bool confirmed)
+{
+	const guint64* set;
+	unsigned int count = 0;
+
+	if (!a || !valid(award, band, mode))
+		return 0;
+	set = bitset(a, award, band, mode, confirmed);
+	for (guint i = 0; i < a->words[award]; ++i)
+		count += __builtin_popcountll(set[i]);
+	return count;
+}
+
+/* add everything worked and confirmed in \a from to \a to */
+void awards_merge(awards* to, const awards* from)
+{
+	if (!to || !from)
+		return;
+	for (int i = 0; i < NB_AWARDS; ++i)
+		for (gsize w = 0; w < (gsize)to->words[i] * SLOTS; ++w)
+			to->bits[i][w] |= from->bits[i][w];
+}
@@ -338,12 +338,20 @@ uint iota_to_num(char* str)
     Note: you get the same buffer each time you call this, so
     1) don't call it from more than one thread, and
     2) don't use the returned pointer outside the scope of the calling function.
-    Call strdup() if you need to keep the string for a longer time.
+    Call strdup() if you need to keep the string for a longer time,
+    or num_to_iota_r() to use your own buffer.
 */
 const char* num_to_iota(uint num)
+{
+	static char buf[IOTA_BUFSIZE];
+
+	return num_to_iota_r(num, buf);
+}
+
+/* num_to_iota(), writing into \a buf, of at least IOTA_BUFSIZE bytes */
+const char* num_to_iota_r(uint num, char* buf)
 {
 	const char* cont;
-	static char buf[8];
 
 	if (num == NOT_AN_IOTA)
 		return NULL;
@@ -372,7 +380,7 @@ const char* num_to_iota(uint num)
 	default:
 		return NULL;
 	}
-	snprintf(buf, sizeof(buf), "%s-%03u", cont, num % 1000);
+	snprintf(buf, IOTA_BUFSIZE, "%s-%03u", cont, num % 1000);
 	return buf;
 }
 
@@ -400,12 +408,19 @@ int locator_to_num(char* str)
     Note: you get the same buffer each time you call this, so
     1) don't call it from more than one thread, and
     2) don't use the returned pointer outside the scope of the calling function.
-    Call strdup() if you need to keep the string for a longer time.
+    Call strdup() if you need to keep the string for a longer time,
+    or num_to_locator_r() to use your own buffer.
 */
 const char* num_to_locator(int num)
 {
-	static char locator[5];
+	static char locator[LOCATOR_BUFSIZE];
 
+	return num_to_locator_r(num, locator);
+}
+
+/* num_to_locator(), writing into \a locator, of at least LOCATOR_BUFSIZE bytes */
+const char* num_to_locator_r(int num, char* locator)
+{
 	int first = num / 10000;
 	num = num - first * 10000;
 	int second = num / 100;
@@ -96,14 +96,20 @@ enum /* IOTA continents */
 #define NOT_AN_IOTA 9999
 #define NOT_A_LOCATOR 181900
 
+/* buffer sizes for num_to_iota_r() and num_to_locator_r() */
+#define IOTA_BUFSIZE 8
+#define LOCATOR_BUFSIZE 5
+
 uint cont_to_enum(char* str);
 const char* enum_to_cont(uint cont);
 uint state_to_enum(char* str);
 const char* enum_to_state(uint st);
 uint iota_to_num(char* str);
 const char* num_to_iota(uint st);
+const char* num_to_iota_r(uint num, char* buf);
 int locator_to_num(char* str);
 const char* num_to_locator(int num);
+const char* num_to_locator_r(int num, char* locator);
 
 /* DXCC, WAZ, WAC, WAS, IOTA, LOCATOR */
 #define NB_AWARDS 6
@@ -0,0 +1,676 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * bench.c - time loading the tables, and the lookup, grid and distance kernels
+ *
+ *   bench [-m] [-n operations]
+ *
+ * Run it from src, so that ../share/clu/cty.dat is found. Each kernel runs
+ * over a synthetic corpus made with a fixed seed, so that runs can be
+ * compared: callsigns made from common prefixes, the same with /P and with
+ * DL/ in front, the full-call exceptions from cty.dat, grids of 2 to 10
+ * characters and random pairs of coordinates. For each, it reports the time
+ * and heap allocations per operation (for scan_tokens, per word found), and
+ * the peak RSS so far.
+ *
+ * -m prints tab-separated lines instead, for tracking regressions:
+ *
+ *   kernel ns/op allocations/op peak-RSS-KiB
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dxcc.h"
+#include "locator.h"
+
+#define CORPUS_SIZE 4096
+#define LOAD_ITERATIONS 5
+#define LOOKUP_BATCH 65536 /* callsigns per lookupcountry_batch() */
+
+static const char* cty_location = "../share/clu/cty.dat";
+static const char* abbrev_location = "../share/clu/abbrev.tsv";
+
+static const char* prefixes[] = {
+	"K", "W", "N", "AA", "KH6", "VE", "XE", "PY", "LU", "CE", "DL", "G", "F", "I", "EA",
+	"ON", "PA", "OH", "SM", "LA", "OZ", "SP", "OK", "HA", "YO", "LZ", "UA", "UR", "JA", "HL",
+	"BY", "VU", "YB", "VK", "ZL", "ZS", "5B", "9A", "S5", "4X"
+};
+
+static bool machine_readable;
+static unsigned long allocations;
+static volatile double sink;
+
+#ifdef __GLIBC__
+/* count heap allocations, including glib's */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+	++allocations;
+	return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+/* xorshift, so that the corpus is the same everywhere */
+static unsigned int rnd(void)
+{
+	static unsigned int state = 2463534242u;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static double rnd_range(double min, double max)
+{
+	return min + (max - min) * (rnd() / 4294967296.0);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kib(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+static void report(const char* kernel, double ns, unsigned long allocs, long ops)
+{
+	if (machine_readable)
+		printf("%s\t%.1f\t%.3f\t%ld\n", kernel, ns / ops, (double)allocs / ops, peak_rss_kib());
+	else
+		printf("%-20s %12.1f ns/op %10.3f allocs/op %8ld KiB peak RSS\n",
+		    kernel, ns / ops, (double)allocs / ops, peak_rss_kib());
+}
+
+static void make_call(char* buf, size_t size, const char* before, const char* after)
+{
+	char suffix[4];
+	int i, len = 1 + rnd() % 3;
+
+	for (i = 0; i < len; ++i)
+		suffix[i] = 'A' + rnd() % 26;
+	suffix[len] = '\0';
+	snprintf(buf, size, "%s%s%d%s%s", before, prefixes[rnd() % G_N_ELEMENTS(prefixes)],
+	    rnd() % 10, suffix, after);
+}
+
+static char** make_calls(const char* before, const char* after)
+{
+	char** calls = g_new(char*, CORPUS_SIZE);
+
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		calls[i] = g_malloc(DXCC_MAX_CALLSIGN);
+		make_call(calls[i], DXCC_MAX_CALLSIGN, before, after);
+	}
+	return calls;
+}
+
+/* the =CALL exceptions from cty.dat, without their zone overrides */
+static char** read_exceptions(void)
+{
+	char** calls = g_new0(char*, CORPUS_SIZE);
+	char* text = NULL;
+	const char* p;
+	int n = 0;
+
+	if (!g_file_get_contents(cty_location, &text, NULL, NULL))
+		return calls;
+	for (p = text; n < CORPUS_SIZE && (p = strchr(p, '=')); ) {
+		size_t len = strcspn(++p, ",;([<{~ \r\n");
+
+		if (len > 0 && len < DXCC_MAX_CALLSIGN)
+			calls[n++] = g_strndup(p, len);
+		p += len;
+	}
+	g_free(text);
+	/* repeat them to fill up the corpus */
+	for (int i = 0; n && i + n < CORPUS_SIZE; ++i)
+		calls[i + n] = g_strdup(calls[i]);
+	return calls;
+}
+
+static void free_corpus(char** corpus)
+{
+	for (int i = 0; i < CORPUS_SIZE; ++i)
+		g_free(corpus[i]);
+	g_free(corpus);
+}
+
+static void bench_lookup(const char* kernel, char** calls, long ops)
+{
+	unsigned long allocs;
+	double start;
+	int sum = 0;
+
+	if (!calls[0])
+		return;
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i)
+		sum += lookupcountry_by_callsign(calls[i % CORPUS_SIZE]).country;
+	report(kernel, now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+}
+
+/*
+   the same callsigns as lookup_plain, a batch at a time: in batches of
+   LOOKUP_BATCH, which the thread pool shares out, and in batches of 1024,
+   no more than one chunk of the pool, which the calling thread does alone
+ */
+static void bench_lookup_batch(char** calls, long ops)
+{
+	static const char* batch[LOOKUP_BATCH];
+	static dxcc_data results[LOOKUP_BATCH];
+	static const struct { const char* kernel; long size; } runs[] = {
+		{ "lookup_batch", LOOKUP_BATCH }, { "lookup_batch_1", 1024 },
+	};
+	unsigned long allocs;
+	double start;
+	int sum = 0;
+
+	for (int i = 0; i < LOOKUP_BATCH; ++i)
+		batch[i] = calls[i % CORPUS_SIZE];
+	for (size_t r = 0; r < G_N_ELEMENTS(runs); ++r) {
+		allocs = allocations;
+		start = now_ns();
+		for (long done = 0; done < ops; done += runs[r].size) {
+			long n = MIN(runs[r].size, ops - done);
+
+			lookupcountry_batch(batch + done % LOOKUP_BATCH, results, n);
+			sum += results[n - 1].country;
+		}
+		report(runs[r].kernel, now_ns() - start, allocations - allocs, ops);
+	}
+	sink = sum;
+}
+
+/* a logger's entry field: each callsign typed a character at a time, looking it up after each */
+static void bench_typing(char** calls, long ops)
+{
+	dxcc_context* ctx = dxcc_context_load(cty_location, abbrev_location, NULL);
+	dxcc_cursor* cursor = dxcc_cursor_new(ctx);
+	char typed[DXCC_MAX_CALLSIGN + 1];
+	unsigned long allocs;
+	dxcc_scratch scratch;
+	dxcc_data result;
+	long keys = 0;
+	double start;
+	int sum = 0;
+
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; keys < ops; ++i) {
+		const char* call = calls[i % CORPUS_SIZE];
+
+		for (int j = 0; call[j]; ++j, ++keys) {
+			typed[j] = call[j];
+			typed[j + 1] = '\0';
+			sum += dxcc_lookup(ctx, typed, &result, &scratch);
+		}
+	}
+	report("typing_lookup", now_ns() - start, allocations - allocs, keys);
+
+	keys = 0;
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; keys < ops; ++i) {
+		const char* call = calls[i % CORPUS_SIZE];
+
+		dxcc_cursor_reset(cursor);
+		for (int j = 0; call[j]; ++j, ++keys)
+			sum += dxcc_cursor_push(cursor, call[j]);
+	}
+	report("typing_cursor", now_ns() - start, allocations - allocs, keys);
+	sink = sum;
+	dxcc_cursor_free(cursor);
+	dxcc_context_free(ctx);
+}
+
+/* is each station heard new for any award on its band and mode? half of them have been worked */
+static void bench_awards(char** calls, long ops)
+{
+	static dxcc_data infos[CORPUS_SIZE];
+	static char grids[CORPUS_SIZE][5];
+	awards* a = awards_new();
+	unsigned long allocs;
+	double start;
+	int sum = 0;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		infos[i] = lookupcountry_by_callsign(calls[i]);
+		longlat2locator(rnd_range(-180, 180), rnd_range(-90, 90), grids[i], 2);
+		if (i % 2) {
+			awards_add(a, AWARD_DXCC, infos[i].country, i % AWARD_BANDS, i % AWARD_MODES, false);
+			awards_add(a, AWARD_LOCATOR, locator_to_num(grids[i]), i % AWARD_BANDS, i % AWARD_MODES, false);
+		}
+	}
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i)
+		sum += awards_needed(a, &infos[i % CORPUS_SIZE], grids[i % CORPUS_SIZE], i % AWARD_BANDS, i % AWARD_MODES);
+	report("awards_needed", now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+	awards_free(a);
+}
+
+/* count up a log of QSOs with the callsigns of \a calls; up to 500000 of them */
+static void bench_adif(char** calls, long ops)
+{
+	static const char* const modes[] = { "CW", "SSB", "FT8", "RTTY", "FM" };
+	char path[] = "/tmp/clu-bench-adif-XXXXXX", grid[7];
+	long records = ops < 500000 ? ops : 500000;
+	unsigned long allocs;
+	dxcc_context* ctx = dxcc_context_load(cty_location, abbrev_location, NULL);
+	adif_stats* stats;
+	double start;
+	int fd = mkstemp(path);
+	FILE* fp = fd < 0 ? NULL : fdopen(fd, "w");
+
+	if (!fp || !ctx) {
+		if (fp)
+			fclose(fp);
+		dxcc_context_free(ctx);
+		return;
+	}
+	fprintf(fp, "clu bench\n<ADIF_VER:5>3.1.4 <EOH>\n");
+	for (long i = 0; i < records; ++i) {
+		const char* call = calls[i % CORPUS_SIZE];
+		const char* band = awards_band_name(3 + i % 12);
+		const char* mode = modes[i % 5];
+
+		longlat2locator(rnd_range(-180, 180), rnd_range(-90, 90), grid, 3);
+		fprintf(fp, "<CALL:%zu>%s <BAND:%zu>%s <MODE:%zu>%s <GRIDSQUARE:6>%s <QSO_DATE:8>20250101 %s<EOR>\n",
+		    strlen(call), call, strlen(band), band, strlen(mode), mode, grid,
+		    i % 3 ? "" : "<QSL_RCVD:1>Y ");
+	}
+	fclose(fp);
+
+	stats = adif_stats_new(ctx);
+	allocs = allocations;
+	start = now_ns();
+	adif_read(path, ctx, NULL, stats);
+	report("adif_read", now_ns() - start, allocations - allocs, records);
+	unlink(path);
+	sink = stats->qsos;
+	adif_stats_free(stats);
+	dxcc_context_free(ctx);
+}
+
+static void bench_is_grid(char** tokens, long ops)
+{
+	unsigned long allocs = allocations;
+	double start = now_ns();
+	int sum = 0;
+
+	for (long i = 0; i < ops; ++i)
+		sum += is_grid(tokens[i % CORPUS_SIZE]);
+	report("is_grid", now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+}
+
+/* lines like decodes, CQ then a callsign and a grid, with a signal report */
+static void bench_scan_tokens(char** tokens, long ops)
+{
+	size_t size = 0, count = 0, max = 4 * CORPUS_SIZE;
+	char* text = g_malloc(CORPUS_SIZE * (DXCC_MAX_CALLSIGN + 8));
+	token_span* spans = g_new(token_span, max);
+	unsigned long allocs;
+	double start;
+
+	for (int i = 0; i + 1 < CORPUS_SIZE; i += 2)
+		size += sprintf(text + size, "CQ %s %s -%d\n", tokens[i], tokens[i + 1], rnd() % 24);
+	allocs = allocations;
+	start = now_ns();
+	while (count < (size_t)ops)
+		count += scan_tokens(text, size, spans, max, NULL);
+	report("scan_tokens", now_ns() - start, allocations - allocs, count);
+	sink = spans[count % max].kind;
+	g_free(spans);
+	g_free(text);
+}
+
+static void bench_locator2longlat(int pairs, long ops)
+{
+	char kernel[32], grids[CORPUS_SIZE][12];
+	unsigned long allocs;
+	double start, lon, lat, sum = 0;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i)
+		longlat2locator(rnd_range(-180, 180), rnd_range(-90, 90), grids[i], pairs);
+	snprintf(kernel, sizeof(kernel), "locator2longlat_%d", pairs * 2);
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i) {
+		locator2longlat(&lon, &lat, grids[i % CORPUS_SIZE]);
+		sum += lon + lat;
+	}
+	report(kernel, now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+}
+
+static void bench_qrb(long ops)
+{
+	static double coords[CORPUS_SIZE][4];
+	unsigned long allocs;
+	double start, distance, azimuth, sum = 0;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		coords[i][0] = rnd_range(-180, 180);
+		coords[i][1] = rnd_range(-90, 90);
+		coords[i][2] = rnd_range(-180, 180);
+		coords[i][3] = rnd_range(-90, 90);
+	}
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i) {
+		const double* c = coords[i % CORPUS_SIZE];
+		qrb(c[0], c[1], c[2], c[3], &distance, &azimuth);
+		sum += distance + azimuth;
+	}
+	report("qrb", now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+
+	/* the same pairs, as arrays, a whole corpus per call */
+	static double lon1[CORPUS_SIZE], lat1[CORPUS_SIZE], lon2[CORPUS_SIZE], lat2[CORPUS_SIZE];
+	static double distances[CORPUS_SIZE], azimuths[CORPUS_SIZE];
+	long calls = (ops + CORPUS_SIZE - 1) / CORPUS_SIZE;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		lon1[i] = coords[i][0];
+		lat1[i] = coords[i][1];
+		lon2[i] = coords[i][2];
+		lat2[i] = coords[i][3];
+	}
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < calls; ++i) {
+		qrb_batch(lon1, lat1, lon2, lat2, distances, azimuths, CORPUS_SIZE);
+		sum += distances[i % CORPUS_SIZE] + azimuths[i % CORPUS_SIZE];
+	}
+	report("qrb_batch", now_ns() - start, allocations - allocs, calls * CORPUS_SIZE);
+	sink = sum;
+
+	/* from one home to the second point of each pair */
+	static float lonf[CORPUS_SIZE], latf[CORPUS_SIZE], distancesf[CORPUS_SIZE], azimuthsf[CORPUS_SIZE];
+	qrb_home home;
+
+	qrb_home_init(&home, lon1[0], lat1[0]);
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		lonf[i] = lon2[i];
+		latf[i] = lat2[i];
+	}
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i) {
+		qrb_from_home(&home, lon2[i % CORPUS_SIZE], lat2[i % CORPUS_SIZE], &distance, &azimuth);
+		sum += distance + azimuth;
+	}
+	report("qrb_from_home", now_ns() - start, allocations - allocs, ops);
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < calls; ++i) {
+		qrb_from_home_float(&home, lonf, latf, distancesf, azimuthsf, CORPUS_SIZE);
+		sum += distancesf[i % CORPUS_SIZE] + azimuthsf[i % CORPUS_SIZE];
+	}
+	report("qrb_from_home_float", now_ns() - start, allocations - allocs, calls * CORPUS_SIZE);
+	sink = sum;
+}
+
+/* what the tables save: a grid heard, then its path from home */
+static void bench_qrb_tables(long ops)
+{
+	dxcc_context* ctx = dxcc_context_load(cty_location, abbrev_location, NULL);
+	char grids[CORPUS_SIZE][12];
+	unsigned long allocs;
+	double start, sum = 0;
+	qrb_tables* tables;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i)
+		longlat2locator(rnd_range(-180, 180), rnd_range(-90, 90), grids[i], 2);
+	tables = qrb_tables_new();
+	allocs = allocations;
+	start = now_ns();
+	qrb_tables_set_home(tables, "FN31pr", ctx);
+	report("qrb_tables_build", now_ns() - start, allocations - allocs, 1);
+
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i)
+		sum += qrb_tables_grid(tables, grids[i % CORPUS_SIZE])->distance;
+	report("qrb_tables_grid", now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+	qrb_tables_free(tables);
+	dxcc_context_free(ctx);
+}
+
+/* stations heard, spread over the world: those within 1000 km of a point, and the nearest 10 */
+static void bench_spot_index(long ops)
+{
+	double lon[CORPUS_SIZE], lat[CORPUS_SIZE], sum = 0;
+	spot_hit hits[CORPUS_SIZE];
+	unsigned long allocs;
+	double start;
+	spot_index* index = spot_index_new();
+	long queries = ops / 100 + 1;
+
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		lon[i] = rnd_range(-180, 180);
+		lat[i] = rnd_range(-90, 90);
+	}
+	allocs = allocations;
+	start = now_ns();
+	for (int i = 0; i < CORPUS_SIZE; ++i)
+		spot_index_add(index, i, lon[i], lat[i]);
+	report("spot_index_add", now_ns() - start, allocations - allocs, CORPUS_SIZE);
+
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < queries; ++i)
+		sum += spot_index_within(index, lon[i % CORPUS_SIZE], lat[i % CORPUS_SIZE], 1000, hits, CORPUS_SIZE);
+	report("spot_index_within", now_ns() - start, allocations - allocs, queries);
+
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < queries; ++i)
+		sum += spot_index_nearest(index, lon[i % CORPUS_SIZE], lat[i % CORPUS_SIZE], 10, hits);
+	report("spot_index_nearest", now_ns() - start, allocations - allocs, queries);
+
+	/* what it saves: qrb() to every station */
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < queries / 10 + 1; ++i) {
+		for (int j = 0; j < CORPUS_SIZE; ++j) {
+			double distance, azimuth;
+
+			qrb(lon[i % CORPUS_SIZE], lat[i % CORPUS_SIZE], lon[j], lat[j], &distance, &azimuth);
+			sum += distance < 1000;
+		}
+	}
+	report("spot_brute_force", now_ns() - start, allocations - allocs, queries / 10 + 1);
+	sink = sum;
+	spot_index_free(index);
+}
+
+/*
+   zones by location: a zones.dat of 40 CQ zones, 75 ITU zones and 340
+   entities, as irregular polygons of 60 vertices, at random
+ */
+static void bench_zone_map(long ops)
+{
+	static const struct { const char* layer; int count; } layers[] = { { "CQ", 40 }, { "ITU", 75 }, { "DXCC", 340 } };
+	char path[] = "/tmp/clu-bench-zones-XXXXXX";
+	double lon[CORPUS_SIZE], lat[CORPUS_SIZE], start, sum = 0;
+	unsigned long allocs;
+	zone_location where;
+	zone_map* map;
+	int fd = mkstemp(path);
+	FILE* fp = fd < 0 ? NULL : fdopen(fd, "w");
+
+	if (!fp)
+		return;
+	for (int l = 0; l < 3; ++l) {
+		for (int i = 0; i < layers[l].count; ++i) {
+			double x = rnd_range(-160, 160), y = rnd_range(-70, 70), r = rnd_range(2, 20);
+
+			fprintf(fp, "%s %d", layers[l].layer, i + 1);
+			for (int v = 0; v < 60; ++v) {
+				double a = 2 * M_PI * v / 60, rr = r * rnd_range(0.5, 1);
+
+				fprintf(fp, " %.2f,%.2f", x + rr * cos(a), y + rr * sin(a));
+			}
+			fputc('\n', fp);
+		}
+	}
+	fclose(fp);
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		lon[i] = rnd_range(-180, 180);
+		lat[i] = rnd_range(-90, 90);
+	}
+
+	allocs = allocations;
+	start = now_ns();
+	map = zone_map_load(path);
+	report("zone_map_load", now_ns() - start, allocations - allocs, 1);
+	unlink(path);
+
+	allocs = allocations;
+	start = now_ns();
+	for (long i = 0; i < ops; ++i) {
+		zone_map_locate(map, lon[i % CORPUS_SIZE], lat[i % CORPUS_SIZE], &where);
+		sum += where.cq + where.itu;
+	}
+	report("zone_map_locate", now_ns() - start, allocations - allocs, ops);
+	sink = sum;
+	zone_map_free(map);
+}
+
+static int bench_load(void)
+{
+	unsigned long allocs;
+	dxcc_context* ctx;
+	double start;
+
+	/* parse cty.dat and build the tables, as when there's no snapshot */
+	allocs = allocations;
+	start = now_ns();
+	for (int i = 0; i < LOAD_ITERATIONS; ++i) {
+		if (readctydata(cty_location)) {
+			fprintf(stderr, "couldn't read %s\n", cty_location);
+			return (1);
+		}
+	}
+	report("load_parse", now_ns() - start, allocations - allocs, LOAD_ITERATIONS);
+
+	/* the first load writes the snapshot if it's missing or stale */
+	if (!(ctx = dxcc_context_load(cty_location, abbrev_location, NULL)))
+		return (1);
+	dxcc_context_free(ctx);
+
+	allocs = allocations;
+	start = now_ns();
+	for (int i = 0; i < LOAD_ITERATIONS; ++i)
+		dxcc_context_free(dxcc_context_load(cty_location, abbrev_location, NULL));
+	report("load_snapshot", now_ns() - start, allocations - allocs, LOAD_ITERATIONS);
+
+	return loadctydata(cty_location, abbrev_location);
+}
+
+int main(int argc, char* argv[])
+{
+	long ops = 1000000;
+	char **plain, **portable, **dl_slash, **exceptions, **tokens;
+	int c;
+
+	while ((c = getopt(argc, argv, "mn:")) != -1) {
+		switch (c) {
+		case 'm':
+			machine_readable = true;
+			break;
+		case 'n':
+			ops = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-m] [-n operations]\n", argv[0]);
+			return (1);
+		}
+	}
+	if (ops < 1)
+		ops = 1;
+
+	if (bench_load())
+		return (1);
+
+	plain = make_calls("", "");
+	portable = make_calls("", "/P");
+	dl_slash = make_calls("DL/", "");
+	exceptions = read_exceptions();
+	bench_lookup("lookup_plain", plain, ops);
+	bench_lookup_batch(plain, ops);
+	bench_lookup("lookup_portable", portable, ops);
+	bench_lookup("lookup_dl_slash", dl_slash, ops);
+	bench_lookup("lookup_exception", exceptions, ops);
+	bench_typing(plain, ops);
+	bench_awards(plain, ops);
+	bench_adif(plain, ops);
+
+	/* what clu does with each word: half callsigns, half grids */
+	tokens = g_new(char*, CORPUS_SIZE);
+	for (int i = 0; i < CORPUS_SIZE; ++i) {
+		tokens[i] = g_malloc(DXCC_MAX_CALLSIGN);
+		if (i % 2)
+			longlat2locator(rnd_range(-180, 180), rnd_range(-90, 90), tokens[i], 1 + i / 2 % 5);
+		else
+			g_strlcpy(tokens[i], plain[i], DXCC_MAX_CALLSIGN);
+	}
+	bench_is_grid(tokens, ops);
+	bench_scan_tokens(tokens, ops);
+
+	for (int pairs = 1; pairs <= 5; ++pairs)
+		bench_locator2longlat(pairs, ops);
+	bench_qrb(ops);
+	bench_qrb_tables(ops);
+	bench_spot_index(ops);
+	bench_zone_map(ops);
+
+	free_corpus(plain);
+	free_corpus(portable);
+	free_corpus(dl_slash);
+	free_corpus(exceptions);
+	free_corpus(tokens);
+	cleanup_dxcc();
+	return (0);
+}
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * clu.h - public interface of libclu
+ *
+ * Load cty.dat into a dxcc_context, then look up callsigns in it from any
+ * number of threads. Also Maidenhead grid conversion and great circle
+ * distance (qrb) from hamlib. Nothing here depends on global state.
+ */
+#ifndef CLU_H
+#define CLU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* struct for dxcc information from cty.dat */
+typedef struct
+{
+	const char *countryname;
+	unsigned int country;
+	unsigned char cq; /* uchar max=255 */
+	unsigned char itu;
+	unsigned char continent;
+	float latitude;
+	float longitude;
+	short timezone;
+	const char *px;
+	const char *exceptions;
+}
+dxcc_data;
+
+/* callsigns longer than this are not looked up */
+#define DXCC_MAX_CALLSIGN 32
+
+/* working space for dxcc_lookup() */
+typedef struct
+{
+	char px[DXCC_MAX_CALLSIGN + 1];
+} dxcc_scratch;
+
+/* loaded tables, which any number of threads can look things up in at once */
+typedef struct dxcc_context dxcc_context;
+
+/*
+ * Paths of cty.dat and abbrev.tsv are absolute, or relative to the
+ * directory of the executable.
+ */
+dxcc_context* dxcc_context_load(const char *cty_dat_path, const char *abbrev_tsv_path, int* error);
+void dxcc_context_free(dxcc_context* ctx);
+int dxcc_context_version(const dxcc_context* ctx);
+unsigned int dxcc_context_serial(const dxcc_context* ctx);
+int dxcc_context_entities(const dxcc_context* ctx);
+bool dxcc_entity(const dxcc_context* ctx, int country, dxcc_data* result);
+int dxcc_lookup(const dxcc_context* ctx, const char* callsign, dxcc_data* result, dxcc_scratch* scratch);
+void dxcc_lookup_batch(const dxcc_context* ctx, const char* const* callsigns, dxcc_data* results, size_t count);
+const char* dxcc_abbreviate(const dxcc_context* ctx, const char* country);
+const char* enum_to_cont(unsigned int cont);
+
+/* a callsign being typed, looked up as it grows */
+typedef struct dxcc_cursor dxcc_cursor;
+
+dxcc_cursor* dxcc_cursor_new(const dxcc_context* ctx);
+void dxcc_cursor_free(dxcc_cursor* cursor);
+void dxcc_cursor_reset(dxcc_cursor* cursor);
+int dxcc_cursor_push(dxcc_cursor* cursor, char c);
+int dxcc_cursor_pop(dxcc_cursor* cursor);
+const char* dxcc_cursor_callsign(const dxcc_cursor* cursor);
+int dxcc_cursor_result(const dxcc_cursor* cursor, dxcc_data* result);
+size_t dxcc_cursor_reachable(const dxcc_cursor* cursor, const unsigned short** countries);
+
+/* Maidenhead locators; the int functions return 0 on success */
+bool is_grid(const char* grid);
+bool set_location_from_grid(dxcc_data* info, const char* grid);
+int locator2longlat(double *longitude, double *latitude, const char *locator);
+int longlat2locator(double longitude, double latitude, char *locator_res, int pair_count);
+int qrb(double lon1, double lat1, double lon2, double lat2, double *distance, double *azimuth);
+double distance_long_path(double distance);
+double azimuth_long_path(double azimuth);
+int qrb_batch(const double* lon1, const double* lat1, const double* lon2, const double* lat2,
+    double* distance, double* azimuth, size_t count);
+
+/* our own location, with what qrb() would compute about it every time */
+typedef struct
+{
+	double longitude, latitude; /* degrees, as given */
+	double lon_rad, sin_lat, cos_lat;
+}
+qrb_home;
+
+int qrb_home_init(qrb_home* home, double longitude, double latitude);
+int qrb_from_home(const qrb_home* home, double longitude, double latitude, double* distance, double* azimuth);
+int qrb_from_home_float(const qrb_home* home, const float* longitude, const float* latitude,
+    float* distance, float* azimuth, size_t count);
+
+/* the short and long path, as from qrb(), distance_long_path() and azimuth_long_path() */
+typedef struct
+{
+	float distance, long_distance; /* km */
+	short azimuth, long_azimuth; /* whole degrees */
+}
+qrb_path;
+
+/* qrb_path from one home locator to every 4-character grid and every entity */
+typedef struct qrb_tables qrb_tables;
+
+qrb_tables* qrb_tables_new(void);
+void qrb_tables_free(qrb_tables* tables);
+int qrb_tables_set_home(qrb_tables* tables, const char* locator, const dxcc_context* ctx);
+const qrb_path* qrb_tables_grid(const qrb_tables* tables, const char* grid);
+const qrb_path* qrb_tables_entity(const qrb_tables* tables, int country);
+
+/* what's been worked and confirmed, by band and mode */
+typedef struct awards awards;
+
+enum { AWARD_DXCC, AWARD_WAZ, AWARD_WAC, AWARD_WAS, AWARD_IOTA, AWARD_LOCATOR };
+enum { AWARD_MODE_CW, AWARD_MODE_PHONE, AWARD_MODE_DATA, AWARD_MODES };
+#define AWARD_BANDS 33 /* the ADIF bands, from 2190m to submm */
+#define AWARDS_ANY (-1) /* band or mode */
+
+/* what awards_check() finds new */
+enum { AWARD_NEW = 1, AWARD_NEW_BAND = 2, AWARD_NEW_MODE = 4, AWARD_NEW_SLOT = 8 };
+
+awards* awards_new(void);
+void awards_free(awards* a);
+int awards_band(const char* band);
+int awards_band_from_freq(double mhz);
+const char* awards_band_name(int band);
+int awards_mode(const char* mode);
+bool awards_add(awards* a, int award, int key, int band, int mode, bool confirmed);
+unsigned int awards_check(const awards* a, int award, int key, int band, int mode, bool confirmed);
+unsigned int awards_needed(const awards* a, const dxcc_data* info, const char* grid, int band, int mode);
+unsigned int awards_count(const awards* a, int award, int band, int mode, bool confirmed);
+void awards_merge(awards* to, const awards* from);
+
+/* keys for awards_check() */
+unsigned int cont_to_enum(char* str);
+unsigned int state_to_enum(char* str);
+unsigned int iota_to_num(char* str);
+int locator_to_num(char* str);
+
+/* stations by location, for finding those near a point */
+typedef struct spot_index spot_index;
+
+typedef struct
+{
+	unsigned int id; /* as given to spot_index_add() */
+	double distance, azimuth; /* as from qrb() */
+}
+spot_hit;
+
+spot_index* spot_index_new(void);
+void spot_index_free(spot_index* index);
+unsigned int spot_index_size(const spot_index* index);
+int spot_index_add(spot_index* index, unsigned int id, double longitude, double latitude);
+bool spot_index_remove(spot_index* index, int handle);
+size_t spot_index_within(const spot_index* index, double longitude, double latitude, double radius,
+    spot_hit* hits, size_t max);
+size_t spot_index_nearest(const spot_index* index, double longitude, double latitude,
+    size_t k, spot_hit* hits);
+
+/* CQ zone, ITU zone and entity by location, from the polygons of zones.dat */
+typedef struct zone_map zone_map;
+
+enum { ZONE_CQ, ZONE_ITU, ZONE_ENTITY };
+
+typedef struct
+{
+	int cq, itu; /* 0 if unknown */
+	const char* entity; /* primary prefix in cty.dat, or NULL */
+}
+zone_location;
+
+zone_map* zone_map_load(const char* path);
+void zone_map_free(zone_map* map);
+bool zone_map_locate(const zone_map* map, double longitude, double latitude, zone_location* result);
+bool set_zones_from_location(dxcc_data* info, const zone_map* map);
+
+/* ADIF logs: one field, as found in place */
+typedef struct
+{
+	const char* name; /* not terminated */
+	unsigned int name_length;
+	const char* value; /* not terminated; NULL if the tag has no length */
+	unsigned int length;
+}
+adif_field;
+
+/* what an ADIF log holds */
+typedef struct
+{
+	unsigned int qsos;
+	unsigned int unknown; /* callsigns of no known entity */
+	unsigned int located; /* with a valid GRIDSQUARE */
+	unsigned int confirmed;
+	unsigned int nentities;
+	unsigned int* entity_qsos; /* by entity number, nentities of them */
+	unsigned int band_qsos[AWARD_BANDS];
+	unsigned int mode_qsos[AWARD_MODES];
+	awards* awards;
+}
+adif_stats;
+
+size_t adif_next_field(const char* data, size_t size, size_t offset, adif_field* field);
+adif_stats* adif_stats_new(const dxcc_context* ctx);
+void adif_stats_free(adif_stats* stats);
+int adif_read(const char* path, const dxcc_context* ctx, const zone_map* zones, adif_stats* stats);
+
+/* words in text that might be callsigns or grids */
+enum { TOKEN_OTHER, TOKEN_GRID, TOKEN_CALLSIGN };
+
+typedef struct
+{
+	size_t start; /* offset in the text */
+	unsigned int length;
+	unsigned char kind; /* TOKEN_OTHER, TOKEN_GRID or TOKEN_CALLSIGN */
+	bool line_start; /* the first word on its line */
+}
+token_span;
+
+int token_kind(const char* token, size_t len);
+size_t scan_tokens(const char* text, size_t size, token_span* spans, size_t max_spans, size_t* scanned);
+
+/* the roles of the words of a standard FT8 or FT4 message: their indices, or -1 */
+typedef struct
+{
+	int cq; /* CQ or QRZ */
+	int modifier; /* of CQ: DX, POTA, a frequency... */
+	int callee; /* the station called */
+	int caller; /* the station sending the message */
+	int grid; /* the caller's */
+	int report; /* signal report, R and report, RRR, RR73 or 73 */
+	bool callee_hashed, caller_hashed; /* sent as <callsign> */
+}
+ft8_message;
+
+bool ft8_parse(int count, const char* const* words, ft8_message* msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLU_H */
@@ -0,0 +1,541 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * ctyimage.c - build, write, map and search the compiled cty tables
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ctyimage.h"
+
+#define ALIGN8(n) (((n) + 7) & ~(guint32)7)
+
+/* FNV-1a */
+guint32 cty_hash(const char* key)
+{
+	guint32 h = 2166136261u;
+
+	for (; *key; ++key)
+		h = (h ^ (uchar)*key) * 16777619u;
+	return h;
+}
+
+/*
+   Find \a key in \a table; NULL if it's not there.
+   Looks at no more than table->maxprobe slots.
+ */
+const cty_slot* cty_image_find(const cty_image* img, const cty_table* table, const char* key)
+{
+	return cty_image_find_hashed(img, table, key, cty_hash(key));
+}
+
+/* cty_image_find() for when the caller already has cty_hash(key) */
+const cty_slot* cty_image_find_hashed(const cty_image* img, const cty_table* table, const char* key, guint32 hash)
+{
+	const cty_slot* slots = CTY_AT(img, cty_slot, table->slots);
+	guint32 i, n;
+
+	if (!table->slots)
+		return NULL;
+	i = hash & table->mask;
+	for (n = 0; n < table->maxprobe && slots[i].key; ++n, i = (i + 1) & table->mask)
+		if (!strcmp(cty_string(img, slots[i].key), key))
+			return &slots[i];
+	return NULL;
+}
+
+/*
+   Find the longest prefix of \a px (up to \a len characters, or all of it
+   if \a len < 0) that is in the trie. Returns its node, or NULL if there is
+   none, and sets *matchlen to the length of the prefix found.
+ */
+const pfx_node* cty_image_longest_prefix(const cty_image* img, const char* px, int len, int* matchlen)
+{
+	const pfx_node* trie = CTY_AT(img, pfx_node, img->trie);
+	const pfx_node* found = NULL;
+	guint32 node = 0, k, end;
+	int i;
+
+	*matchlen = 0;
+	for (i = 0; (len < 0 || i < len) && px[i]; ++i) {
+		k = trie[node].first_child;
+		end = k + trie[node].nchildren;
+		while (k < end && trie[k].label < px[i])
+			++k;
+		if (k == end || trie[k].label != px[i])
+			break;
+		node = k;
+		if (trie[node].country) {
+			found = &trie[node];
+			*matchlen = i + 1;
+		}
+	}
+	return found;
+}
+
+/* number of slots for a table of \a count entries: a power of 2, at most half full */
+static guint32 table_size(guint count)
+{
+	guint32 n = 8;
+
+	while (n < count * 2)
+		n <<= 1;
+	return n;
+}
+
+/* an empty arena for cty_arena_add() */
+GString* cty_arena_new(void)
+{
+	/* start with a NUL, so that no string is at offset 0 */
+	return g_string_new_len("", 1);
+}
+
+/* copy \a s with its NUL to the end of \a arena, and return its offset */
+guint32 cty_arena_add(GString* arena, const char* s)
+{
+	guint32 offset = arena->len;
+
+	g_string_append_len(arena, s, strlen(s) + 1);
+	return offset;
+}
+
+/* make \a table big enough for \a expected keys, so that it needn't grow while they're added */
+void cty_build_table_init(cty_build_table* table, guint expected)
+{
+	table->slots = g_array_new(FALSE, TRUE, sizeof(cty_slot));
+	g_array_set_size(table->slots, table_size(expected));
+	table->hashes = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_array_set_size(table->hashes, table->slots->len);
+	table->count = 0;
+}
+
+void cty_build_table_free(cty_build_table* table)
+{
+	g_array_free(table->slots, TRUE);
+	g_array_free(table->hashes, TRUE);
+}
+
+/* the slot number holding \a key, or of the empty one where it would go */
+static guint32 build_table_probe(const cty_build_table* table, const char* arena, const char* key, guint32 hash)
+{
+	const cty_slot* s = (const cty_slot*)table->slots->data;
+	const guint32* hashes = (const guint32*)table->hashes->data;
+	guint32 mask = table->slots->len - 1, i;
+
+	for (i = hash & mask; s[i].key && (hashes[i] != hash || strcmp(arena + s[i].key, key)); i = (i + 1) & mask)
+		;
+	return i;
+}
+
+/*!
+    Find \a key in \a table, or add it with value 0, copying it into
+    \a arena (so it must not point into the arena already). Returns its
+    slot, which stays valid until the next insertion.
+ */
+cty_slot* cty_build_table_insert(cty_build_table* table, GString* arena, const char* key)
+{
+	guint32 hash = cty_hash(key), i, j;
+	cty_slot* slot;
+
+	if ((table->count + 1) * 2 > table->slots->len) {
+		cty_build_table old = *table;
+
+		table->slots = g_array_new(FALSE, TRUE, sizeof(cty_slot));
+		g_array_set_size(table->slots, old.slots->len * 2);
+		table->hashes = g_array_new(FALSE, FALSE, sizeof(guint32));
+		g_array_set_size(table->hashes, table->slots->len);
+		for (i = 0; i < old.slots->len; ++i) {
+			cty_slot* o = &g_array_index(old.slots, cty_slot, i);
+			if (!o->key)
+				continue;
+			j = build_table_probe(table, arena->str, arena->str + o->key, g_array_index(old.hashes, guint32, i));
+			g_array_index(table->slots, cty_slot, j) = *o;
+			g_array_index(table->hashes, guint32, j) = g_array_index(old.hashes, guint32, i);
+		}
+		cty_build_table_free(&old);
+	}
+	i = build_table_probe(table, arena->str, key, hash);
+	slot = &g_array_index(table->slots, cty_slot, i);
+	if (!slot->key) {
+		slot->key = cty_arena_add(arena, key);
+		g_array_index(table->hashes, guint32, i) = hash;
+		table->count++;
+	}
+	return slot;
+}
+
+typedef struct
+{
+	char* base;
+	guint32 strings; /* where the next string goes */
+	cty_table* table;
+} image_builder;
+
+static guint32 add_string(image_builder* b, const char* s)
+{
+	guint32 offset = b->strings;
+	int len = strlen(s) + 1;
+
+	memcpy(b->base + offset, s, len);
+	b->strings += len;
+	return offset;
+}
+
+static void add_slot(gpointer key, gpointer value, gpointer user_data)
+{
+	image_builder* b = user_data;
+	cty_slot* slots = (cty_slot*)(b->base + b->table->slots);
+	guint32 i, n = 1;
+
+	for (i = cty_hash(key) & b->table->mask; slots[i].key; i = (i + 1) & b->table->mask)
+		++n;
+	if (n > b->table->maxprobe)
+		b->table->maxprobe = n;
+	slots[i].key = add_string(b, key);
+	slots[i].value = GPOINTER_TO_UINT(value);
+}
+
+static void add_abbreviation(gpointer key, gpointer value, gpointer user_data)
+{
+	image_builder* b = user_data;
+
+	/* the value is a string too: store its offset instead */
+	add_slot(key, GUINT_TO_POINTER(add_string(b, value)), b);
+}
+
+static void sum_abbreviation_lengths(gpointer key, gpointer value, gpointer user_data)
+{
+	*(guint32*)user_data += strlen(key) + strlen(value) + 2;
+}
+
+/* flatten the trie built while parsing into \a out, breadth-first */
+static void flatten_trie(GArray* trie, pfx_node* out)
+{
+	guint32 *order, i, next = 1, c;
+
+	order = g_new(guint32, trie->len);
+	order[0] = 0;
+	for (i = 0; i < trie->len; ++i) {
+		pfx_build_node* b = &g_array_index(trie, pfx_build_node, order[i]);
+		out[i].country = b->country;
+		out[i].label = b->label;
+		out[i].cq = b->cq;
+		out[i].itu = b->itu;
+		out[i].first_child = next;
+		out[i].nchildren = 0;
+		for (c = b->child; c; c = g_array_index(trie, pfx_build_node, c).sibling) {
+			order[next++] = c;
+			out[i].nchildren++;
+		}
+	}
+	g_free(order);
+}
+
+/*
+   fill in the reach of each node of \a trie (flattened, with \a n nodes), and
+   return the lists, for \a nentities entities. A node's entities are its own
+   and its children's, so going backwards, the children are done first; and a
+   node whose entities are the same as a child's (most often, one without a
+   prefix of its own and only one child) shares the child's list. Only the set
+   bits are visited when writing a list, so each node costs a few words, not a
+   pass over every entity.
+ */
+static GArray* build_reach(pfx_node* trie, guint32 n, guint32 nentities)
+{
+	guint32 words = (nentities + 63) / 64, i, c, e;
+	guint64* sets = g_new0(guint64, (gsize)n * words);
+	GArray* reach = g_array_new(FALSE, FALSE, sizeof(guint16));
+
+	for (i = n; i-- > 0;) {
+		guint64* set = sets + (gsize)i * words;
+		bool shared = false;
+		guint16 count = 0, item;
+		guint64 bits;
+
+		if (trie[i].country)
+			set[trie[i].country / 64] |= 1ULL << (trie[i].country % 64);
+		for (c = trie[i].first_child; c < trie[i].first_child + trie[i].nchildren; ++c)
+			for (e = 0; e < words; ++e)
+				set[e] |= sets[(gsize)c * words + e];
+		for (c = trie[i].first_child; !shared && c < trie[i].first_child + trie[i].nchildren; ++c) {
+			if (!memcmp(set, sets + (gsize)c * words, words * sizeof(guint64))) {
+				trie[i].reach = trie[c].reach;
+				shared = true;
+			}
+		}
+		if (shared)
+			continue;
+		trie[i].reach = reach->len;
+		for (e = 0; e < words; ++e)
+			count += __builtin_popcountll(set[e]);
+		g_array_append_val(reach, count);
+		for (e = 0; e < words; ++e) {
+			for (bits = set[e]; bits; bits &= bits - 1) {
+				item = e * 64 + __builtin_ctzll(bits);
+				g_array_append_val(reach, item);
+			}
+		}
+	}
+	g_free(sets);
+	return reach;
+}
+
+/* copy the table built while parsing, whose strings are now at \a strings */
+static void copy_table(image_builder* b, const cty_build_table* from, guint32 strings)
+{
+	cty_slot* slots = (cty_slot*)(b->base + b->table->slots);
+	guint32 i, n;
+
+	for (i = 0; i <= b->table->mask; ++i) {
+		const cty_slot* s = &g_array_index(from->slots, cty_slot, i);
+		if (!s->key)
+			continue;
+		slots[i].key = s->key + strings;
+		slots[i].value = s->value;
+		/* how many slots a search for it goes through */
+		n = ((i - (g_array_index(from->hashes, guint32, i) & b->table->mask)) & b->table->mask) + 1;
+		if (n > b->table->maxprobe)
+			b->table->maxprobe = n;
+	}
+}
+
+/*!
+    Build an image from the parsed tables: \a entities is an array of
+    cty_entity whose strings are offsets in \a strings (see cty_arena_new()),
+    \a trie the prefix trie, \a exceptions maps full callsigns to values
+    made by cty_exception(), and \a abbreviations (optional) maps country
+    names to abbreviations. Free the result with g_free().
+ */
+cty_image* cty_image_build(GArray* entities, GString* strings, GArray* trie,
+    const cty_build_table* exceptions, GHashTable* abbreviations, int version)
+{
+	guint32 size, abbrev_strings = 0, strings_at, i;
+	cty_image header, *img;
+	image_builder b;
+	pfx_node* nodes;
+	GArray* reach;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CTY_IMAGE_MAGIC, sizeof(header.magic));
+	header.format = CTY_IMAGE_FORMAT;
+	header.byte_order = CTY_IMAGE_BYTE_ORDER;
+	header.version = version;
+
+	size = ALIGN8(sizeof(cty_image));
+	header.entities = size;
+	header.nentities = entities->len;
+	size = ALIGN8(size + entities->len * sizeof(cty_entity));
+	header.trie = size;
+	header.ntrie = trie->len;
+	size = ALIGN8(size + trie->len * sizeof(pfx_node));
+	nodes = g_new0(pfx_node, trie->len);
+	flatten_trie(trie, nodes);
+	reach = build_reach(nodes, trie->len, entities->len);
+	header.reach = size;
+	header.nreach = reach->len;
+	size = ALIGN8(size + reach->len * sizeof(guint16));
+	header.exceptions.slots = size;
+	header.exceptions.mask = exceptions->slots->len - 1;
+	size += (header.exceptions.mask + 1) * sizeof(cty_slot);
+	if (abbreviations) {
+		header.abbreviations.slots = size;
+		header.abbreviations.mask = table_size(g_hash_table_size(abbreviations)) - 1;
+		size += (header.abbreviations.mask + 1) * sizeof(cty_slot);
+		g_hash_table_foreach(abbreviations, sum_abbreviation_lengths, &abbrev_strings);
+	}
+	strings_at = size;
+	header.size = ALIGN8(size + strings->len + abbrev_strings);
+
+	b.base = g_malloc0(header.size);
+	memcpy(b.base, &header, sizeof(header));
+	img = (cty_image*)b.base;
+	memcpy(b.base + strings_at, strings->str, strings->len);
+	b.strings = strings_at + strings->len;
+
+	for (i = 0; i < entities->len; ++i) {
+		cty_entity* e = (cty_entity*)(b.base + header.entities) + i;
+		*e = g_array_index(entities, cty_entity, i);
+		e->countryname += strings_at;
+		e->px += strings_at;
+		e->exceptions += strings_at;
+	}
+	memcpy(b.base + header.trie, nodes, trie->len * sizeof(pfx_node));
+	memcpy(b.base + header.reach, reach->data, reach->len * sizeof(guint16));
+	g_free(nodes);
+	g_array_free(reach, TRUE);
+	b.table = &img->exceptions;
+	copy_table(&b, exceptions, strings_at);
+	if (abbreviations) {
+		b.table = &img->abbreviations;
+		g_hash_table_foreach(abbreviations, add_abbreviation, &b);
+	}
+
+	return img;
+}
+
+/*
+   write \a img to \a path, replacing any previous file atomically;
+   any number of threads or processes may be doing it at once
+ */
+int cty_image_write(const cty_image* img, const char* path)
+{
+	char tmp[PATH_MAX + 8];
+	FILE* fp;
+	size_t n;
+	int fd;
+
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if ((fd = mkstemp(tmp)) < 0)
+		return (1);
+	fchmod(fd, 0644);
+	if ((fp = fdopen(fd, "wb")) == NULL) {
+		close(fd);
+		unlink(tmp);
+		return (1);
+	}
+	n = fwrite(img, 1, img->size, fp);
+	if (fclose(fp) || n != img->size || rename(tmp, path)) {
+		unlink(tmp);
+		return (2);
+	}
+	return (0);
+}
+
+static bool section_ok(const cty_image* img, guint32 offset, guint64 count, gsize elsize)
+{
+	return offset >= sizeof(cty_image) && !(offset & 7) && offset + count * elsize <= img->size;
+}
+
+static bool table_ok(const cty_image* img, const cty_table* table)
+{
+	return section_ok(img, table->slots, (guint64)table->mask + 1, sizeof(cty_slot))
+	    && !(table->mask & (table->mask + 1)) && table->maxprobe <= table->mask + 1;
+}
+
+/* whether \a offset is of a string: once the image is known to end with a NUL, any offset in it is */
+static bool string_ok(const cty_image* img, guint32 offset)
+{
+	return offset >= sizeof(cty_image) && offset < img->size;
+}
+
+/*
+   whether the keys of \a table, and its values (strings, or exceptions), are
+   in \a img; without branches, as the used and empty slots are in no order
+ */
+static bool slots_ok(const cty_image* img, const cty_table* table, bool string_values)
+{
+	const cty_slot* slots = CTY_AT(img, cty_slot, table->slots);
+	guint32 strings = img->size - sizeof(cty_image), i;
+	bool bad = false;
+
+	for (i = 0; i <= table->mask; ++i) {
+		bool value_bad = string_values ? slots[i].value - (guint32)sizeof(cty_image) >= strings
+		    : cty_exception_country(slots[i].value) >= img->nentities;
+
+		bad |= (slots[i].key != 0) & ((slots[i].key - (guint32)sizeof(cty_image) >= strings) | value_bad);
+	}
+	return !bad;
+}
+
+/*
+   whether every string offset, entity number and trie link in \a img
+   (whose sections are known to be in it) leads somewhere in it, so that
+   lookups can't stray outside, even if the file is corrupt
+ */
+static bool contents_ok(const cty_image* img)
+{
+	const cty_entity* entities = CTY_AT(img, cty_entity, img->entities);
+	const pfx_node* trie = CTY_AT(img, pfx_node, img->trie);
+	const guint16* reach = CTY_AT(img, guint16, img->reach);
+	guint32 i, j;
+
+	if (CTY_AT(img, char, 0)[img->size - 1])
+		return false;
+	for (i = 0; i < img->nentities; ++i) {
+		if (!string_ok(img, entities[i].countryname) || !string_ok(img, entities[i].px)
+		    || !string_ok(img, entities[i].exceptions))
+			return false;
+	}
+	for (i = 0; i < img->ntrie; ++i) {
+		const pfx_node* node = &trie[i];
+
+		if (node->country >= img->nentities || (guint64)node->first_child + node->nchildren > img->ntrie
+		    || node->reach >= img->nreach || (guint64)node->reach + 1 + reach[node->reach] > img->nreach)
+			return false;
+		for (j = 1; j <= reach[node->reach]; ++j)
+			if (reach[node->reach + j] >= img->nentities)
+				return false;
+	}
+	return slots_ok(img, &img->exceptions, false)
+	    && (!img->abbreviations.slots || slots_ok(img, &img->abbreviations, true));
+}
+
+static bool stamp_equal(const cty_stamp* a, const cty_stamp* b)
+{
+	return a->size == b->size && a->mtime_ns == b->mtime_ns;
+}
+
+/*!
+    Map the snapshot at \a path read-only. Returns NULL if it doesn't exist,
+    isn't valid, or was made from source files other than those described
+    by \a cty_dat and \a abbrev_tsv. Everything in it that refers to
+    something else is checked, so a corrupt or truncated file is refused
+    rather than crashing lookups later.
+ */
+const cty_image* cty_image_map(const char* path, const cty_stamp* cty_dat, const cty_stamp* abbrev_tsv)
+{
+	struct stat st;
+	const cty_image* img;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(cty_image)) {
+		close(fd);
+		return NULL;
+	}
+	img = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (img == MAP_FAILED)
+		return NULL;
+
+	if (memcmp(img->magic, CTY_IMAGE_MAGIC, sizeof(img->magic)) || img->format != CTY_IMAGE_FORMAT
+	    || img->byte_order != CTY_IMAGE_BYTE_ORDER || img->size != st.st_size
+	    || !stamp_equal(&img->cty_dat, cty_dat) || !stamp_equal(&img->abbrev_tsv, abbrev_tsv)
+	    || !section_ok(img, img->entities, img->nentities, sizeof(cty_entity)) || !img->nentities
+	    || !section_ok(img, img->trie, img->ntrie, sizeof(pfx_node)) || !img->ntrie
+	    || !section_ok(img, img->reach, img->nreach, sizeof(guint16)) || !img->nreach
+	    || !table_ok(img, &img->exceptions) || !img->exceptions.slots
+	    || (img->abbreviations.slots && !table_ok(img, &img->abbreviations)) || !contents_ok(img)) {
+		munmap((void*)img, st.st_size);
+		return NULL;
+	}
+	return img;
+}
+
+void cty_image_unmap(const cty_image* img)
+{
+	munmap((void*)img, img->size);
+}
+
+int cty_stamp_file(const char* path, cty_stamp* stamp)
+{
+	struct stat st;
+
+	if (stat(path, &st))
+		return (1);
+	stamp->size = st.st_size;
+	stamp->mtime_ns = (gint64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	return (0);
+}
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * ctyimage.h - compiled form of the tables from cty.dat and abbrev.tsv
+ *
+ * The image is one contiguous block with no pointers in it: every reference
+ * is a byte offset from the start of the image. So the same bytes can be
+ * built in memory after parsing, written to a snapshot file, and later
+ * mmap()ed read-only and used without any parsing.
+ */
+#ifndef CTYIMAGE_H
+#define CTYIMAGE_H
+
+#ifdef CLU_NO_GLIB
+#include "miniglib.h"
+#else
+#include <glib.h>
+#endif
+#include <stdbool.h>
+
+#include "dxcc.h"
+
+#define CTY_IMAGE_MAGIC "clu-cty"
+#define CTY_IMAGE_FORMAT 4
+#define CTY_IMAGE_BYTE_ORDER 0x01020304
+
+/* size and modification time of a source file, to tell whether a snapshot is stale */
+typedef struct
+{
+	gint64 size;
+	gint64 mtime_ns;
+} cty_stamp;
+
+/* an open-addressing hash table in the image */
+typedef struct
+{
+	guint32 slots;    /* offset of mask + 1 cty_slots; 0 if the table is absent */
+	guint32 mask;
+	guint32 maxprobe; /* the most slots that any search needs to look at */
+} cty_table;
+
+typedef struct
+{
+	char magic[8];
+	guint32 format;
+	guint32 byte_order;
+	guint32 size;     /* of the whole image, in bytes */
+	gint32 version;   /* from the =VER entry in cty.dat */
+	cty_stamp cty_dat;
+	cty_stamp abbrev_tsv;
+	/* sections: byte offsets from the start of the image, and sizes */
+	guint32 entities, nentities;
+	guint32 trie, ntrie;
+	guint32 reach, nreach; /* of guint16 */
+	cty_table exceptions;
+	cty_table abbreviations;
+} cty_image;
+
+/* a DXCC entity: like dxcc_data, with offsets of NUL-terminated strings */
+typedef struct
+{
+	guint32 countryname;
+	guint32 px;
+	guint32 exceptions;
+	float latitude;
+	float longitude;
+	gint16 timezone;
+	uchar cq;
+	uchar itu;
+	uchar continent;
+} cty_entity;
+
+/*
+ * The prefixes from cty.dat are compiled into a byte trie, so that the
+ * longest prefix of a callsign is found in one left-to-right pass.
+ * The nodes are stored breadth-first: the children of a node are
+ * contiguous and sorted by their label. Node 0 is the root.
+ *
+ * Each node also has the list of the entities of the prefixes in its
+ * subtree (including itself), for telling what a callsign being typed
+ * could still turn out to be: in the reach section, a count and then that
+ * many entity numbers, in order. Nodes with the same list share it.
+ */
+typedef struct
+{
+	guint32 first_child;
+	guint16 country; /* 0 if no prefix ends here */
+	uchar nchildren;
+	char label;      /* character leading from the parent to this node */
+	uchar cq;        /* zone overrides for this prefix, or 0 */
+	uchar itu;
+	guint32 reach;   /* index of its list in the reach section */
+} pfx_node;
+
+/* trie nodes while parsing: children as sorted sibling lists */
+typedef struct
+{
+	guint32 child;
+	guint32 sibling;
+	guint16 country;
+	char label;
+	uchar cq;
+	uchar itu;
+} pfx_build_node;
+
+/* open-addressing hash slot mapping a string to a value */
+typedef struct
+{
+	guint32 key; /* string offset; 0 for an empty slot */
+	guint32 value;
+} cty_slot;
+
+/*
+ * While parsing, the strings all go into one arena (a GString, whose offset
+ * 0 is never used), and the entities and tables refer to them by offset as
+ * in the image; so building the image is mostly copying, and the parser's
+ * tables are freed with a few g_free()s instead of one per string.
+ */
+typedef struct
+{
+	GArray* slots; /* of cty_slot: a power of 2 of them, at most half in use */
+	GArray* hashes; /* cty_hash() of each slot's key, so it's only computed once */
+	guint count;
+} cty_build_table;
+
+/* the value of an exception slot: the entity and its zone overrides, or 0 */
+static inline guint32 cty_exception(uint country, uchar cq, uchar itu)
+{
+	return country | (guint32)cq << 16 | (guint32)itu << 24;
+}
+
+static inline uint cty_exception_country(guint32 value)
+{
+	return value & 0xffff;
+}
+
+static inline uchar cty_exception_cq(guint32 value)
+{
+	return (value >> 16) & 0xff;
+}
+
+static inline uchar cty_exception_itu(guint32 value)
+{
+	return value >> 24;
+}
+
+#define CTY_AT(img, type, offset) ((const type*)((const char*)(img) + (offset)))
+
+/* the entities reachable from \a node, after their count */
+static inline const guint16* cty_reach(const cty_image* img, const pfx_node* node)
+{
+	return CTY_AT(img, guint16, img->reach) + node->reach;
+}
+
+static inline const char* cty_string(const cty_image* img, guint32 offset)
+{
+	return CTY_AT(img, char, offset);
+}
+
+static inline const cty_entity* cty_entity_at(const cty_image* img, uint country)
+{
+	return CTY_AT(img, cty_entity, img->entities) + country;
+}
+
+/* start loading the slot where a search for a key with \a hash begins */
+static inline void cty_table_prefetch(const cty_image* img, const cty_table* table, guint32 hash)
+{
+	__builtin_prefetch(CTY_AT(img, cty_slot, table->slots) + (hash & table->mask));
+}
+
+guint32 cty_hash(const char* key);
+const cty_slot* cty_image_find(const cty_image* img, const cty_table* table, const char* key);
+const cty_slot* cty_image_find_hashed(const cty_image* img, const cty_table* table, const char* key, guint32 hash);
+const pfx_node* cty_image_longest_prefix(const cty_image* img, const char* px, int len, int* matchlen);
+
+GString* cty_arena_new(void);
+guint32 cty_arena_add(GString* arena, const char* s);
+void cty_build_table_init(cty_build_table* table, guint expected);
+cty_slot* cty_build_table_insert(cty_build_table* table, GString* arena, const char* key);
+void cty_build_table_free(cty_build_table* table);
+
+cty_image* cty_image_build(GArray* entities, GString* strings, GArray* trie,
+    const cty_build_table* exceptions, GHashTable* abbreviations, int version);
+int cty_image_write(const cty_image* img, const char* path);
+const cty_image* cty_image_map(const char* path, const cty_stamp* cty_dat, const cty_stamp* abbrev_tsv);
+void cty_image_unmap(const cty_image* img);
+int cty_stamp_file(const char* path, cty_stamp* stamp);
+
+#endif /* CTYIMAGE_H */
@@ -0,0 +1,334 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * daemon.c - serve callsign lookups on a Unix domain socket
+ *
+ * The protocol is line-based: a client sends one callsign per line, and
+ * gets one line back for each, in the same order, with tab-separated fields
+ *
+ *   callsign country abbreviation countryname cq itu continent lat lon
+ *
+ * Clients may send as many requests as they like without waiting for the
+ * replies. One thread serves all clients with epoll; a client whose
+ * replies pile up unread is not read from until it catches up. A client
+ * may shut down its side when it has sent all its requests: the
+ * connection stays open until all the replies have been sent.
+ *
+ * SIGHUP reloads cty.dat in another thread, while lookups go on with the
+ * old tables until the new ones are ready. Signals are blocked, and read
+ * from a signalfd that epoll watches with the sockets, so that one arriving
+ * at any moment wakes the loop.
+ */
+
+#define _GNU_SOURCE /* accept4 */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "awards_enum.h"
+#include "daemon.h"
+#include "dxcc.h"
+#include "lookupcache.h"
+
+#define MAX_EVENTS 64
+#define MAX_LINE 256          /* longer requests close the connection */
+#define MAX_PENDING (1 << 20) /* stop reading when this many reply bytes are unsent */
+#define CACHE_SIZE 4096       /* callsigns whose lookups are remembered */
+
+typedef struct
+{
+	int fd;
+	bool reading;   /* EPOLLIN is enabled */
+	bool eof;       /* the client has sent all its requests */
+	size_t inlen;
+	char in[4096];
+	size_t outlen, outsent, outsize;
+	char* out;
+} client;
+
+static bool stopping;
+static int sfd = -1; /* signals; its epoll data is &sfd */
+static lookup_cache* cache;
+static const char *cty_dat, *abbrev_tsv;
+static pthread_t reloader;
+static bool reloader_started;
+static atomic_bool reloading;
+
+static void* reload_main(void* arg)
+{
+	(void)arg;
+	if (loadctydata(cty_dat, abbrev_tsv) == 0)
+		fprintf(stderr, "loaded cty version %d\n", loadedctyversion());
+	atomic_store(&reloading, false);
+	return NULL;
+}
+
+/* start reloading the tables in the background, unless that's already happening */
+static void reload(void)
+{
+	if (atomic_load(&reloading))
+		return;
+	if (reloader_started)
+		pthread_join(reloader, NULL);
+	atomic_store(&reloading, true);
+	reloader_started = !pthread_create(&reloader, NULL, reload_main, NULL);
+	if (!reloader_started)
+		atomic_store(&reloading, false);
+}
+
+static void client_close(int epfd, client* c)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	free(c->out);
+	free(c);
+}
+
+/* whether to read more requests: not after the last, nor while replies pile up */
+static bool client_wants_input(const client* c)
+{
+	return !c->eof && c->outlen - c->outsent < MAX_PENDING;
+}
+
+static void client_watch(int epfd, client* c)
+{
+	struct epoll_event ev;
+
+	c->reading = client_wants_input(c);
+	ev.events = (c->reading ? EPOLLIN : 0) | (c->outsent < c->outlen ? EPOLLOUT : 0);
+	ev.data.ptr = c;
+	epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+/* append the reply for one request line to the client's output */
+static void reply(client* c, const char* callsign)
+{
+	dxcc_data info;
+	const char* abbrev;
+	int n;
+
+	lookup_cache_lookup(cache, callsign, &info);
+	abbrev = abbreviate_country(info.countryname);
+	for (;;) {
+		n = snprintf(c->out + c->outlen, c->outsize - c->outlen,
+		    "%s\t%d\t%s\t%s\t%d\t%d\t%s\t%.2f\t%.2f\n",
+		    callsign, info.country, abbrev ? abbrev : "", info.countryname, info.cq, info.itu,
+		    enum_to_cont(info.continent), info.latitude, info.longitude);
+		if (c->outlen + n < c->outsize)
+			break;
+		c->outsize = c->outsize ? c->outsize * 2 : 4096;
+		c->out = realloc(c->out, c->outsize);
+	}
+	c->outlen += n;
+}
+
+/* write as much pending output as the socket takes; false on error */
+static bool client_flush(client* c)
+{
+	ssize_t n;
+
+	while (c->outsent < c->outlen) {
+		n = send(c->fd, c->out + c->outsent, c->outlen - c->outsent, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		c->outsent += n;
+	}
+	c->outlen = c->outsent = 0;
+	return true;
+}
+
+/*
+   read and answer requests; false if the client is gone or misbehaving.
+   At the end of its requests, answer one left without a newline too.
+ */
+static bool client_read(client* c)
+{
+	char *line, *end;
+	ssize_t n;
+
+	for (;;) {
+		n = read(c->fd, c->in + c->inlen, sizeof(c->in) - c->inlen);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		if (n == 0) {
+			c->eof = true;
+			if (c->inlen && c->inlen <= MAX_LINE) {
+				c->in[c->inlen] = '\0';
+				if (c->in[c->inlen - 1] == '\r')
+					c->in[c->inlen - 1] = '\0';
+				reply(c, c->in);
+				c->inlen = 0;
+			}
+			return true;
+		}
+		c->inlen += n;
+
+		line = c->in;
+		while ((end = memchr(line, '\n', c->in + c->inlen - line))) {
+			*end = '\0';
+			if (end > line && end[-1] == '\r')
+				end[-1] = '\0';
+			reply(c, line);
+			line = end + 1;
+		}
+		c->inlen -= line - c->in;
+		if (c->inlen > MAX_LINE)
+			return false;
+		memmove(c->in, line, c->inlen);
+		if (c->outlen - c->outsent >= MAX_PENDING)
+			return true;
+	}
+}
+
+static int listen_unix(const char* path)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "socket path too long: %s\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	/* remove a socket left behind by a previous run */
+	if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+		perror(path);
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* act on the signals that have arrived */
+static void read_signals(void)
+{
+	struct signalfd_siginfo si;
+
+	while (read(sfd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo == SIGHUP)
+			reload();
+		else
+			stopping = true;
+	}
+}
+
+/*!
+    Answer lookups from clients connecting to the Unix domain socket at
+    \a path, until SIGINT or SIGTERM. The tables must already be loaded
+    from \a cty_dat_path and \a abbrev_tsv_path, which are loaded again on
+    SIGHUP. Returns 0 on a clean shutdown, nonzero if the socket couldn't
+    be set up.
+ */
+int serve_unix_socket(const char* path, const char* cty_dat_path, const char* abbrev_tsv_path)
+{
+	struct epoll_event ev, events[MAX_EVENTS];
+	sigset_t signals, old_mask;
+	int lfd, epfd, n, i;
+
+	cty_dat = cty_dat_path;
+	abbrev_tsv = abbrev_tsv_path;
+	signal(SIGPIPE, SIG_IGN);
+
+	if ((lfd = listen_unix(path)) < 0)
+		return (1);
+	/* the reloader thread inherits the mask, so only the signalfd sees them */
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGHUP);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &old_mask);
+	if ((sfd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+		perror("signalfd");
+		pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+		close(lfd);
+		unlink(path);
+		return (1);
+	}
+	cache = lookup_cache_new(CACHE_SIZE);
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL; /* the listening socket */
+	epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev);
+	ev.data.ptr = &sfd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev);
+
+	while (!stopping) {
+		n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+		for (i = 0; i < n; ++i) {
+			client* c = events[i].data.ptr;
+			if (c == (client*)&sfd) {
+				read_signals();
+				continue;
+			}
+			if (!c) {
+				int fd;
+				while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+					c = calloc(1, sizeof(client));
+					c->fd = fd;
+					c->reading = true;
+					ev.events = EPOLLIN;
+					ev.data.ptr = c;
+					epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+				}
+				continue;
+			}
+			if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+				client_close(epfd, c);
+				continue;
+			}
+			if ((events[i].events & EPOLLIN) && !client_read(c)) {
+				/* send what we can of the replies to the last requests */
+				client_flush(c);
+				client_close(epfd, c);
+				continue;
+			}
+			/* once the client has sent all it will, close when all the replies are sent */
+			if (!client_flush(c) || (c->eof && c->outsent == c->outlen)) {
+				client_close(epfd, c);
+				continue;
+			}
+			if (c->reading != client_wants_input(c) || c->outsent < c->outlen
+			    || (events[i].events & EPOLLOUT))
+				client_watch(epfd, c);
+		}
+	}
+
+	close(epfd);
+	close(lfd);
+	unlink(path);
+	if (reloader_started)
+		pthread_join(reloader, NULL);
+	close(sfd);
+	sfd = -1;
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	lookup_cache_free(cache);
+	return (0);
+}
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * daemon.h - serve callsign lookups on a Unix domain socket
+ */
+#ifndef DAEMON_H
+#define DAEMON_H
+
+int serve_unix_socket(const char* path, const char* cty_dat_path, const char* abbrev_tsv_path);
+
+#endif /* DAEMON_H */
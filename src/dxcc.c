@@ -8,7 +8,7 @@
 */
 
 /*
- * dxcc.c - dxcc lookups and creation of the hashtable
+ * dxcc.c - dxcc lookups and creation of the tables
  */
 
 //
@@ -51,52 +51,133 @@
 //
 
 #include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef CLU_NO_GLIB
+#include "miniglib.h"
+#else
 #include <glib.h>
 #include <glib/gstdio.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "dxcc.h"
 #include "locator.h"
 #include "awards_enum.h"
+#include "ctyimage.h"
+#include "lookupcache.h"
+#include "rcu.h"
+#include "threadpool.h"
 
 #ifdef USE_AREA_DAT
 static const char* area_location = "/usr/share/xlog/dxcc/area.dat";
 #endif
 
+/* the tables being filled while parsing cty.dat */
 typedef struct
 {
-	int countries; /* number of countries loaded */
-} programstatetype;
+	GString* strings;           /* arena of all the strings in the tables below */
+	GArray* entities;           /* of cty_entity */
+	GArray* trie;               /* of pfx_build_node */
+	guint32* shallow;           /* trie nodes of 1- and 2-character prefixes, by label */
+	cty_build_table exceptions; /* full callsign -> cty_exception() */
+	int countries;              /* number of countries loaded */
+	int version;                /* from the =VER entry */
+} cty_parser;
+
+/* ASCII labels of the first two levels of the trie, each indexed directly */
+#define SHALLOW_NODES (128 + 128 * 128)
+
+/* loaded tables: built after parsing, or mapped from a snapshot */
+struct dxcc_context
+{
+	const cty_image* img;
+	bool mapped;
+	uint serial;    /* see dxcc_context_serial() */
+};
 
-programstatetype programstate;
-GPtrArray *dxcc, *area;
-GHashTable *prefixes, *full_callsign_exceptions, *abbreviations;
-int excitu, exccq;
+/* a dxcc_lookup_batch() in progress */
+typedef struct
+{
+	const cty_image* img;
+	const char* const* callsigns;
+	dxcc_data* results;
+} lookup_batch;
 
-/* free memory used by the dxcc array */
-void cleanup_dxcc(void)
+#define BATCH_CHUNK 1024 /* callsigns per thread pool chunk */
+#define BATCH_AHEAD 8    /* callsigns hashed ahead of looking them up */
+
+GPtrArray *area;
+GHashTable *abbreviations; /* from readabbrev() */
+
+/*
+   The tables that the functions without a context argument use.
+   They can be replaced while other threads are looking things up:
+   readers use them inside rcu_read_lock(), and the previous tables are
+   kept until the next replacement, so that strings in results stay valid.
+ */
+static _Atomic(dxcc_context*) current;
+static dxcc_context* retired;
+static pthread_mutex_t replace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint cty_generation; /* counts the times they were replaced */
+static atomic_uint context_serial; /* counts the contexts made */
+
+/*
+   In front of lookupcountry_by_callsign(), if enabled: each thread makes its
+   own cache when it first looks something up, and remakes it if the
+   capacity changes; it's freed when the thread exits.
+ */
+static atomic_uint cache_capacity;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local lookup_cache* cache;
+static _Thread_local uint cache_made; /* the capacity this thread's cache was made with */
+
+/* start parsing a cty.dat with about \a exceptions full-call exceptions */
+static void parser_init(cty_parser* parser, guint exceptions)
 {
-	int i;
+	parser->strings = cty_arena_new();
+	parser->entities = g_array_new(FALSE, TRUE, sizeof(cty_entity));
+	parser->trie = g_array_new(FALSE, TRUE, sizeof(pfx_build_node));
+	g_array_set_size(parser->trie, 1); /* the root */
+	parser->shallow = g_new0(guint32, SHALLOW_NODES);
+	cty_build_table_init(&parser->exceptions, exceptions);
+	parser->countries = 0;
+	parser->version = 0;
+}
 
-	/* free the dxcc array */
-	if (dxcc) {
-		for (i = 0; i < dxcc->len; i++) {
-			dxcc_data* d = g_ptr_array_index(dxcc, i);
-			g_free((char*)d->countryname);
-			g_free((char*)d->px);
-			g_free((char*)d->exceptions);
-			g_free(d);
-		}
-		g_ptr_array_free(dxcc, TRUE);
-	}
-	if (prefixes)
-		g_hash_table_destroy(prefixes);
-	if (full_callsign_exceptions)
-		g_hash_table_destroy(full_callsign_exceptions);
+/* free the tables that are only needed while parsing cty.dat */
+static void parser_free(cty_parser* parser)
+{
+	g_string_free(parser->strings, TRUE);
+	g_array_free(parser->entities, TRUE);
+	g_array_free(parser->trie, TRUE);
+	g_free(parser->shallow);
+	cty_build_table_free(&parser->exceptions);
+}
+
+static void set_context(dxcc_context* ctx);
+static GHashTable* parseabbrev(const char *abbrev_tsv_path);
+static lookup_cache* thread_cache(void);
+
+/* free memory used by the dxcc tables */
+void cleanup_dxcc(void)
+{
+	threadpool_shutdown();
+	set_context(NULL);
+	dxcc_context_free(retired);
+	retired = NULL;
+	lookupcountry_cache(0);
+	thread_cache();
 	if (abbreviations)
 		g_hash_table_destroy(abbreviations);
+	abbreviations = NULL;
 }
 
 #ifdef USE_AREA_DAT
@@ -120,49 +201,148 @@ void cleanup_area(void)
 #endif
 
 /*
- * go through exception string and stop when end of prefix
- * is reached (BT3L(23)[33] -> BT3L)
+   Add a prefix to the trie under construction; a later entry for the same
+   prefix wins. Zone overrides given for the same prefix more than once in
+   one entity are merged. The nodes of the first two characters are found
+   in parser->shallow, since those have the longest sibling lists.
+ */
+static void
+pfx_insert(cty_parser* parser, const char* pfx, uint country, uchar cq, uchar itu)
+{
+	GArray* pfx_build = parser->trie;
+	guint32 node = 0, *link, *shallow;
+	int depth;
+
+	if (!*pfx)
+		return;
+	for (depth = 0; *pfx; ++pfx, ++depth) {
+		shallow = NULL;
+		if (depth == 0 && (uchar)pfx[0] < 128)
+			shallow = &parser->shallow[(uchar)pfx[0]];
+		else if (depth == 1 && (uchar)pfx[-1] < 128 && (uchar)pfx[0] < 128)
+			shallow = &parser->shallow[128 + (uchar)pfx[-1] * 128 + (uchar)pfx[0]];
+		if (shallow && *shallow) {
+			node = *shallow;
+			continue;
+		}
+		link = &g_array_index(pfx_build, pfx_build_node, node).child;
+		while (*link && g_array_index(pfx_build, pfx_build_node, *link).label < *pfx)
+			link = &g_array_index(pfx_build, pfx_build_node, *link).sibling;
+		if (!*link || g_array_index(pfx_build, pfx_build_node, *link).label != *pfx) {
+			pfx_build_node new_node = { .sibling = *link, .label = *pfx };
+			guint32 idx = pfx_build->len;
+			/* g_array_append_val() may move the array: find the link again */
+			guint32 offset = (char*)link - pfx_build->data;
+			g_array_append_val(pfx_build, new_node);
+			link = (guint32*)(pfx_build->data + offset);
+			*link = idx;
+		}
+		node = *link;
+		if (shallow)
+			*shallow = node;
+	}
+	pfx_build_node* n = &g_array_index(pfx_build, pfx_build_node, node);
+	if (n->country != country)
+		n->cq = n->itu = 0;
+	n->country = country;
+	if (cq)
+		n->cq = cq;
+	if (itu)
+		n->itu = itu;
+}
+
+/* add a full callsign exception, merging zone overrides like pfx_insert() */
+static void
+exception_insert(cty_parser* parser, const char* call, uint country, uchar cq, uchar itu)
+{
+	cty_slot* slot = cty_build_table_insert(&parser->exceptions, parser->strings, call);
+	guint32 old = slot->value;
+
+	if (old && cty_exception_country(old) == country) {
+		if (!cq)
+			cq = cty_exception_cq(old);
+		if (!itu)
+			itu = cty_exception_itu(old);
+	}
+	slot->value = cty_exception(country, cq, itu);
+}
+
+/* isspace() without the locale */
+static inline bool is_space(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* strip whitespace from both ends of [s, end), NUL-terminating it in place */
+static char*
+strip(char* s, char* end)
+{
+	while (s < end && is_space(*s))
+		++s;
+	while (end > s && is_space(end[-1]))
+		--end;
+	*end = '\0';
+	return s;
+}
+
+/*
+   Parse one item of an entity's prefix list in place, e.g. BT3L(23)[33],
+   which ends at \a end: return the prefix (or the callsign, for an
+   exception like =BT3L), set *cq and *itu to its zone overrides (0 if not
+   given), and *exception to whether it's a full callsign.
  */
 static char*
-findpfx_in_exception(char* pfx)
+parse_prefix(char* item, char* end, uchar* cq, uchar* itu, bool* exception)
 {
-	char *end, *j;
+	char *j, *pfx_end = end;
 
-	g_strstrip(pfx);
-	end = pfx + strlen(pfx);
-	for (j = pfx; j < end; ++j) {
+	*itu = 0;
+	*cq = 0;
+	for (j = item; j < end; ++j) {
 		switch (*j) {
 		case '(':
+			if (j + 2 < end && *(j + 2) == ')')
+				*cq = *(j + 1) - 48;
+			else if (j + 3 < end && *(j + 3) == ')')
+				*cq = ((*(j + 1) - 48) * 10) + (*(j + 2) - 48);
+			/* fall through */
 		case '[':
-		case ';':
-			*j = '\0';
+			if (j + 2 < end && *(j + 2) == ']')
+				*itu = *(j + 1) - 48;
+			else if (j + 3 < end && *(j + 3) == ']')
+				*itu = ((*(j + 1) - 48) * 10) + (*(j + 2) - 48);
+			if (pfx_end == end)
+				pfx_end = j;
 			break;
 		}
 	}
 
-	// BOZO!!!!!!!
-	if (pfx[0] == '=')
-		return pfx + 1;
-	return pfx;
+	item = strip(item, pfx_end);
+	*exception = item[0] == '=';
+	return *exception ? item + 1 : item;
 }
 
-/* replace callsign area (K0AR/2 -> K2AR) so we can do correct lookups */
+/*
+   copy callsign into \a buf, replacing the callsign area (K0AR/2 -> K2AR)
+   so we can do correct lookups
+ */
 static char*
-change_area(char* callsign, int area)
+change_area(const char* callsign, int len, int area, char* buf)
 {
-	char *end, *j;
+	int j;
 
-	end = callsign + strlen(callsign);
-	for (j = callsign; j < end; ++j) {
-		switch (*j) {
+	for (j = 0; j < len; ++j) {
+		switch (callsign[j]) {
 		case '0' ... '9':
-			if ((j - callsign) > 1)
-				*j = area + 48;
+			buf[j] = j > 1 ? area + 48 : callsign[j];
 			break;
+		default:
+			buf[j] = callsign[j];
 		}
 	}
+	buf[len] = '\0';
 
-	return (g_strdup(callsign));
+	return (buf);
 }
 
 /*
@@ -171,151 +351,492 @@ change_area(char* callsign, int area)
    - replace callsign area's (K0AR/2 -> K2AR)
    - skip /mm, /am and /qrp
    - return string after slash if it is shorter than string before
+   Returns the start of the prefix candidate and sets *len to its length;
+   it's either part of \a checkcall or written into \a scratch, which must
+   have room for the callsign. Returns NULL if the location is unknown.
  */
-static char* getpx(const char* checkcall)
+static const char* getpx(const char* checkcall, int* len, char* scratch)
 {
+	const char* slash = strchr(checkcall, '/');
+	int before, after;
 
-	char *pxstr = NULL, **split;
-
+	*len = strlen(checkcall);
 	/* characters after '/' might contain a country */
-	if (strchr(checkcall, '/')) {
-		split = g_strsplit(checkcall, "/", 2);
-		if (split[1]) /* we might be typing */
-		{
-			if ((strlen(split[1]) > 1) && (strlen(split[1]) < strlen(split[0])))
-			/* this might be a candidate */
-			{
-				if ((g_ascii_strcasecmp(split[1], "AM") == 0)
-				    || (g_ascii_strcasecmp(split[1], "MM") == 0))
-					pxstr = NULL; /* don't know location */
-				else if (g_ascii_strcasecmp(split[1], "QRP") == 0)
-					pxstr = g_strdup(split[0]);
-				else
-					pxstr = g_strdup(split[1]);
-			} else if ((strlen(split[1]) == 1) && split[1][0] >= '0' && split[1][0] <= '9')
-			/* callsign area changed */
-			{
-				pxstr = change_area(split[0], atoi(split[1]));
-			} else
-				pxstr = g_strdup(split[0]);
-		} else
-			pxstr = g_strdup(split[0]);
-		g_strfreev(split);
-	} else
-		pxstr = g_strdup(checkcall);
-
-	return (pxstr);
+	if (!slash)
+		return checkcall;
+
+	before = slash - checkcall;
+	after = *len - before - 1;
+	*len = before;
+	if ((after > 1) && (after < before))
+	/* this might be a candidate */
+	{
+		if ((g_ascii_strcasecmp(slash + 1, "AM") == 0)
+		    || (g_ascii_strcasecmp(slash + 1, "MM") == 0))
+			return NULL; /* don't know location */
+		else if (g_ascii_strcasecmp(slash + 1, "QRP") == 0)
+			return checkcall;
+		*len = after;
+		return slash + 1;
+	} else if ((after == 1) && slash[1] >= '0' && slash[1] <= '9')
+	/* callsign area changed */
+	{
+		return change_area(checkcall, before, slash[1] - '0', scratch);
+	}
+	/* we might be typing */
+	return checkcall;
 }
 
-/* parse an exception and extract the CQ and ITU zone */
-static char*
-findexc(char* exception)
+/* the entity as returned from lookups, with pointers into the image */
+static dxcc_data entity_data(const cty_image* cty, const cty_entity* e)
 {
-	char *end, *j;
+	dxcc_data ret;
+
+	memset(&ret, 0, sizeof(ret));
+	ret.countryname = cty_string(cty, e->countryname);
+	ret.cq = e->cq;
+	ret.itu = e->itu;
+	ret.continent = e->continent;
+	ret.latitude = e->latitude;
+	ret.longitude = e->longitude;
+	ret.timezone = e->timezone;
+	ret.px = cty_string(cty, e->px);
+	ret.exceptions = cty_string(cty, e->exceptions);
+	return ret;
+}
 
-	excitu = 0;
-	exccq = 0;
-	end = exception + strlen(exception);
-	for (j = exception; j < end; ++j) {
-		switch (*j) {
-		case '(':
-			if (*(j + 2) == 41)
-				exccq = *(j + 1) - 48;
-			else if (*(j + 3) == 41)
-				exccq = ((*(j + 1) - 48) * 10) + (*(j + 2) - 48);
-		case '[':
-			if (*(j + 2) == 93)
-				excitu = *(j + 1) - 48;
-			else if (*(j + 3) == 93)
-				excitu = ((*(j + 1) - 48) * 10) + (*(j + 2) - 48);
-		case ';':
-			*j = '\0';
-			break;
+/*
+   The body of dxcc_lookup(), for a callsign of length \a len
+   (0 to just return the unknown entity) and \a hash from cty_hash()
+ */
+static int lookup_hashed(const cty_image* cty, const char* callsign, int len, guint32 hash,
+    dxcc_data* result, dxcc_scratch* scratch)
+{
+	const char* px;
+	const pfx_node* node = NULL;
+	uint country_i = 0;
+	uchar cq = 0, itu = 0;
+
+	if (len > 0) {
+		/* first check complete callsign exceptions list*/
+		const cty_slot* exception = cty_image_find_hashed(cty, &cty->exceptions, callsign, hash);
+		if (exception) {
+			country_i = cty_exception_country(exception->value);
+			cq = cty_exception_cq(exception->value);
+			itu = cty_exception_itu(exception->value);
+		} else {
+			/* Next, check whether the whole callsign is a prefix */
+			int matchlen, whole_len = len;
+			const pfx_node* whole = cty_image_longest_prefix(cty, callsign, len, &matchlen);
+
+			if (whole && matchlen == len)
+				node = whole;
+			else if ((px = getpx(callsign, &len, scratch->px))) {
+				/* without a '/', the walk above has already found the longest prefix */
+				if (px == callsign && len == whole_len)
+					node = whole;
+				else /* find the longest prefix of the candidate in one pass */
+					node = cty_image_longest_prefix(cty, px, len, &matchlen);
+			}
+			if (node) {
+				country_i = node->country;
+				cq = node->cq;
+				itu = node->itu;
+			}
 		}
 	}
-	return (exception);
+
+	*result = entity_data(cty, cty_entity_at(cty, country_i));
+	result->country = country_i;
+
+	/* CQ/ITU zone exceptions were recorded per prefix and per callsign when loading */
+	if (cq > 0)
+		result->cq = cq;
+	if (itu > 0)
+		result->itu = itu;
+	return country_i;
 }
 
 /*!
-    Look up information related to the given \a callsign.
-    Note: strings in the returned struct are static constants;
-    copy them if you need to keep them independently.
+    Look up information related to the given \a callsign in the tables of
+    \a ctx, putting the result into \a result and using \a scratch as
+    working space. Returns the entity number, 0 if it's unknown, or -1 if
+    the callsign is longer than DXCC_MAX_CALLSIGN.
+
+    This never allocates memory, and the work is bounded: besides reading up
+    to DXCC_MAX_CALLSIGN + 1 characters of the callsign, it hashes it once and
+    compares it with at most the exception table's maxprobe keys (a handful,
+    fixed when the table is built), then walks the prefix trie at most twice,
+    one node per character, comparing with at most the number of distinct
+    characters in the prefixes (A-Z, 0-9 and '/') at each node.
+    It only reads \a ctx, so it's safe to call from real-time threads, and
+    from any number of them at once with the same context, without locking.
+
+    Note: strings in the result point into \a ctx, and are valid until
+    it's freed; copy them if you need to keep them longer.
  */
-dxcc_data lookupcountry_by_callsign(const char* callsign)
+int dxcc_lookup(const dxcc_context* ctx, const char* callsign, dxcc_data* result, dxcc_scratch* scratch)
 {
-	int ipx, iexc;
-	char* px;
-	char **excsplit, *exc;
-	char* searchpx = NULL;
-	uint country_i = 0;
-
-	/* first check complete callsign exceptions list*/
-	country_i = GPOINTER_TO_INT(g_hash_table_lookup(full_callsign_exceptions, callsign));
+	int len = strnlen(callsign, DXCC_MAX_CALLSIGN + 1);
 
-	if (country_i == 0) {
-		/* Next, check the list of prefixes */
-		country_i = GPOINTER_TO_INT(g_hash_table_lookup(prefixes, callsign));
+	if (len > DXCC_MAX_CALLSIGN) {
+		lookup_hashed(ctx->img, callsign, 0, 0, result, scratch);
+		return -1;
 	}
+	return lookup_hashed(ctx->img, callsign, len, cty_hash(callsign), result, scratch);
+}
 
-	if (country_i == 0 && (px = getpx(callsign))) { /* start with full callsign and truncate it until a correct lookup */
-		for (ipx = strlen(px); ipx > 0; ipx--) {
-			searchpx = g_strndup(px, ipx);
-			country_i = GPOINTER_TO_INT(g_hash_table_lookup(prefixes, searchpx));
-			if (country_i > 0)
-				break;
+/* where a dxcc_cursor is, after some number of characters */
+typedef struct
+{
+	guint32 node; /* in the trie, or CURSOR_OFF_TRIE */
+	guint32 best; /* the deepest node on the way with a prefix, or 0 */
+	guint32 hash; /* cty_hash() of the characters so far */
+	guint16 country;
+	uchar cq, itu;
+} cursor_state;
+
+#define CURSOR_OFF_TRIE ((guint32)-1)
+
+struct dxcc_cursor
+{
+	const dxcc_context* ctx;
+	int len;
+	int slash; /* position of the first '/', or -1 */
+	char callsign[DXCC_MAX_CALLSIGN + 1];
+	cursor_state at[DXCC_MAX_CALLSIGN + 1]; /* after 0 .. len characters */
+};
+
+/*!
+    Start looking up a callsign as it's typed, one character at a time, in
+    the tables of \a ctx, which must outlive the cursor. Free it with
+    dxcc_cursor_free().
+ */
+dxcc_cursor* dxcc_cursor_new(const dxcc_context* ctx)
+{
+	dxcc_cursor* cursor;
+
+	if (!ctx)
+		return NULL;
+	cursor = g_new0(dxcc_cursor, 1);
+	cursor->ctx = ctx;
+	dxcc_cursor_reset(cursor);
+	return cursor;
+}
+
+void dxcc_cursor_free(dxcc_cursor* cursor)
+{
+	g_free(cursor);
+}
+
+/* forget what was typed, as when the entry field is cleared */
+void dxcc_cursor_reset(dxcc_cursor* cursor)
+{
+	cursor->len = 0;
+	cursor->slash = -1;
+	cursor->callsign[0] = '\0';
+	memset(&cursor->at[0], 0, sizeof(cursor_state));
+	cursor->at[0].hash = cty_hash("");
+}
+
+/*!
+    Type \a c at the end of the callsign (letters in either case), and
+    return the entity that dxcc_lookup() would find for all that's been
+    typed: 0 if it's unknown, or -1 if it's already DXCC_MAX_CALLSIGN long,
+    and \a c is ignored.
+
+    Until a '/' is typed, this takes a step down the prefix trie from where
+    the last character left off, and looks up the whole callsign in the
+    exceptions: the same bounded work for every character, however long the
+    callsign. After a '/', what the callsign's prefix is depends on what
+    follows it, so each character is a whole dxcc_lookup().
+ */
+int dxcc_cursor_push(dxcc_cursor* cursor, char c)
+{
+	const cty_image* cty = cursor->ctx->img;
+	const pfx_node* trie = CTY_AT(cty, pfx_node, cty->trie);
+	const cursor_state* prev = &cursor->at[cursor->len];
+	cursor_state* next;
+	const cty_slot* exception;
+	guint32 k, end;
+
+	if (cursor->len >= DXCC_MAX_CALLSIGN)
+		return -1;
+	c = toupper((uchar)c);
+	next = &cursor->at[cursor->len + 1];
+	cursor->callsign[cursor->len++] = c;
+	cursor->callsign[cursor->len] = '\0';
+	if (c == '/' && cursor->slash < 0)
+		cursor->slash = cursor->len - 1;
+
+	next->hash = (prev->hash ^ (uchar)c) * 16777619u; /* cty_hash(), one more character */
+	next->node = CURSOR_OFF_TRIE;
+	next->best = prev->best;
+	if (prev->node != CURSOR_OFF_TRIE) {
+		k = trie[prev->node].first_child;
+		end = k + trie[prev->node].nchildren;
+		while (k < end && trie[k].label < c)
+			++k;
+		if (k < end && trie[k].label == c) {
+			next->node = k;
+			if (trie[k].country)
+				next->best = k;
 		}
-		g_free(px);
-	} else
-		searchpx = g_strdup(callsign);
-
-	dxcc_data* d = g_ptr_array_index(dxcc, country_i);
-	dxcc_data ret = *d;
-	ret.country = country_i;
-
-	/* look for CQ/ITU zone exceptions */
-	if (strchr(d->exceptions, '(') || strchr(d->exceptions, '[')) {
-		excsplit = g_strsplit(d->exceptions, ",", -1);
-		for (iexc = 0;; iexc++) {
-			if (!excsplit[iexc])
-				break;
-			exc = findexc(excsplit[iexc]);
-			if (g_ascii_strcasecmp(searchpx, exc) == 0) {
-				if (excitu > 0)
-					ret.itu = excitu;
-				if (exccq > 0)
-					ret.cq = exccq;
+	}
+
+	if (cursor->slash >= 0 && !(next->node != CURSOR_OFF_TRIE && next->best == next->node)) {
+		dxcc_scratch scratch;
+		dxcc_data result;
+
+		next->country = lookup_hashed(cty, cursor->callsign, cursor->len, next->hash, &result, &scratch);
+		next->cq = result.cq;
+		next->itu = result.itu;
+	} else if ((exception = cty_image_find_hashed(cty, &cty->exceptions, cursor->callsign, next->hash))) {
+		next->country = cty_exception_country(exception->value);
+		next->cq = cty_exception_cq(exception->value);
+		next->itu = cty_exception_itu(exception->value);
+	} else {
+		next->country = trie[next->best].country;
+		next->cq = trie[next->best].cq;
+		next->itu = trie[next->best].itu;
+	}
+	return next->country;
+}
+
+/* take back the last character typed, and return the entity as it was before it */
+int dxcc_cursor_pop(dxcc_cursor* cursor)
+{
+	if (cursor->len > 0) {
+		cursor->callsign[--cursor->len] = '\0';
+		if (cursor->slash == cursor->len)
+			cursor->slash = -1;
+	}
+	return cursor->at[cursor->len].country;
+}
+
+/* what's been typed so far, in upper case */
+const char* dxcc_cursor_callsign(const dxcc_cursor* cursor)
+{
+	return cursor->callsign;
+}
+
+/*!
+    Put into \a result what dxcc_lookup() would for what's been typed so
+    far, and return its entity number.
+ */
+int dxcc_cursor_result(const dxcc_cursor* cursor, dxcc_data* result)
+{
+	const cty_image* cty = cursor->ctx->img;
+	const cursor_state* at = &cursor->at[cursor->len];
+
+	*result = entity_data(cty, cty_entity_at(cty, at->country));
+	result->country = at->country;
+	if (at->cq > 0)
+		result->cq = at->cq;
+	if (at->itu > 0)
+		result->itu = at->itu;
+	return at->country;
+}
+
+/*!
+    Set \a countries to the entities of all the prefixes that begin with
+    what's been typed so far, in order, and return how many there are: what
+    the callsign could still turn out to be, as more is typed. (Exceptions,
+    and what may come after a '/', are not included.) Returns 0 if no
+    prefix begins with it; then more characters won't change the prefix
+    found. The list is in the tables, so it takes no time to get.
+ */
+size_t dxcc_cursor_reachable(const dxcc_cursor* cursor, const unsigned short** countries)
+{
+	const cty_image* cty = cursor->ctx->img;
+	guint32 node = cursor->at[cursor->len].node;
+	const guint16* reach;
+
+	*countries = NULL;
+	if (node == CURSOR_OFF_TRIE)
+		return 0;
+	reach = cty_reach(cty, CTY_AT(cty, pfx_node, cty->trie) + node);
+	*countries = reach + 1;
+	return reach[0];
+}
+
+/*!
+    dxcc_lookup() in the tables loaded by loadctydata(). It's safe to call
+    from any number of threads at once, even while loadctydata() replaces
+    the tables.
+
+    Note: strings in the result stay valid until the tables have been
+    replaced twice more; copy them if you need to keep them longer.
+ */
+int lookupcountry_by_callsign_r(const char* callsign, dxcc_data* result, dxcc_scratch* scratch)
+{
+	rcu_reader reader = rcu_read_lock();
+	int ret = dxcc_lookup(atomic_load(&current), callsign, result, scratch);
+
+	rcu_read_unlock(reader);
+	return ret;
+}
+
+/* look up callsigns[begin .. end) of a dxcc_lookup_batch() */
+static void lookup_range(void* data, int worker, size_t begin, size_t end)
+{
+	const lookup_batch* b = data;
+	const cty_image* cty = b->img;
+	dxcc_scratch scratch;
+	guint32 hash[BATCH_AHEAD];
+	int len[BATCH_AHEAD];
+	size_t i, k, n;
+
+	(void)worker;
+	for (i = begin; i < end; i += n) {
+		n = MIN(BATCH_AHEAD, end - i);
+		/* hash a few callsigns first, so that their slots are loaded in parallel */
+		for (k = 0; k < n; ++k) {
+			len[k] = strnlen(b->callsigns[i + k], DXCC_MAX_CALLSIGN + 1);
+			hash[k] = 0;
+			if (len[k] > DXCC_MAX_CALLSIGN)
+				len[k] = 0;
+			else {
+				hash[k] = cty_hash(b->callsigns[i + k]);
+				cty_table_prefetch(cty, &cty->exceptions, hash[k]);
 			}
 		}
-		g_strfreev(excsplit);
+		for (k = 0; k < n; ++k)
+			lookup_hashed(cty, b->callsigns[i + k], len[k], hash[k], &b->results[i + k], &scratch);
 	}
-	g_free(searchpx); // Bug #60022
+}
+
+/*!
+    Look up \a count callsigns at once, putting what dxcc_lookup() would
+    return for callsigns[i] into results[i]. Large batches are split across
+    a pool of threads.
+ */
+void dxcc_lookup_batch(const dxcc_context* ctx, const char* const* callsigns, dxcc_data* results, size_t count)
+{
+	lookup_batch b = { ctx->img, callsigns, results };
+
+	threadpool_run(lookup_range, &b, count, BATCH_CHUNK);
+}
+
+/* dxcc_lookup_batch() in the tables loaded by loadctydata() */
+void lookupcountry_batch(const char* const* callsigns, dxcc_data* results, size_t count)
+{
+	rcu_reader reader = rcu_read_lock();
+
+	dxcc_lookup_batch(atomic_load(&current), callsigns, results, count);
+	rcu_read_unlock(reader);
+}
+
+/*!
+    Look up information related to the given \a callsign, as
+    lookupcountry_by_callsign_r() does, through the calling thread's cache
+    if lookupcountry_cache() gave it one.
+    Note: strings in the returned struct point into the loaded tables, and
+    stay valid until the tables have been replaced twice more after the
+    lookup; copy them if you need to keep them longer.
+ */
+dxcc_data lookupcountry_by_callsign(const char* callsign)
+{
+	lookup_cache* c = thread_cache();
+	dxcc_scratch scratch;
+	dxcc_data ret;
+
+	if (c)
+		lookup_cache_lookup(c, callsign, &ret);
+	else
+		lookupcountry_by_callsign_r(callsign, &ret, &scratch);
 	return ret;
 }
 
+static void free_thread_cache(void* c)
+{
+	lookup_cache_free(c);
+}
+
+static void make_cache_key(void)
+{
+	pthread_key_create(&cache_key, free_thread_cache);
+}
+
+/* the calling thread's cache, made or remade as lookupcountry_cache() last said; NULL if none */
+static lookup_cache* thread_cache(void)
+{
+	uint capacity = atomic_load_explicit(&cache_capacity, memory_order_relaxed);
+
+	if (capacity == cache_made)
+		return cache;
+	pthread_once(&cache_key_once, make_cache_key);
+	lookup_cache_free(cache);
+	cache = capacity ? lookup_cache_new(capacity) : NULL;
+	cache_made = capacity;
+	pthread_setspecific(cache_key, cache);
+	return cache;
+}
+
+/*!
+    Make lookupcountry_by_callsign() remember the results for up to
+    \a capacity recent callsigns, in each thread that calls it; 0 stops
+    caching. Each thread's cache is its own, so any number of threads can
+    go on calling lookupcountry_by_callsign() at once.
+ */
+void lookupcountry_cache(uint capacity)
+{
+	atomic_store(&cache_capacity, capacity);
+}
+
+/* hits and misses of the calling thread's lookupcountry_by_callsign() cache; false if it has none */
+bool lookupcountry_cache_stats(guint64* hits, guint64* misses)
+{
+	lookup_cache* c = thread_cache();
+
+	if (!c)
+		return false;
+	lookup_cache_stats(c, hits, misses);
+	return true;
+}
+
+/* the abbreviation of \a country from abbrev.tsv, if \a ctx was loaded with it */
+const char* dxcc_abbreviate(const dxcc_context* ctx, const char* country)
+{
+	const cty_slot* slot;
+
+	if (!ctx)
+		return NULL;
+	slot = cty_image_find(ctx->img, &ctx->img->abbreviations, country);
+	return slot ? cty_string(ctx->img, slot->value) : NULL;
+}
+
 const char *abbreviate_country(const char *country)
 {
-	gpointer p = g_hash_table_lookup(abbreviations, country);
-	//~ printf("for '%s' found %p\n", country, p);
-	return p;
+	if (abbreviations) {
+		gpointer p = g_hash_table_lookup(abbreviations, country);
+		//~ printf("for '%s' found %p\n", country, p);
+		return p;
+	}
+	rcu_reader reader = rcu_read_lock();
+	const char* ret = dxcc_abbreviate(atomic_load(&current), country);
+
+	rcu_read_unlock(reader);
+	return ret;
 }
 
 /* add an item from cty.dat to the dxcc array */
 static void
-dxcc_add(char* c, int w, int i, int cont, int lat, int lon,
+dxcc_add(cty_parser* parser, char* c, int w, int i, int cont, int lat, int lon,
     int tz, char* p, char* e)
 {
-	dxcc_data* new_dxcc = g_new(dxcc_data, 1);
-
-	new_dxcc->countryname = g_strdup(c);
-	new_dxcc->cq = w;
-	new_dxcc->itu = i;
-	new_dxcc->continent = cont;
-	new_dxcc->latitude = lat / 100.0;
-	new_dxcc->longitude = lon / -100.0;
-	new_dxcc->timezone = tz;
-	new_dxcc->px = g_strdup(p);
-	new_dxcc->exceptions = g_strdup(e);
-	g_ptr_array_add(dxcc, new_dxcc);
+	cty_entity new_dxcc;
+
+	new_dxcc.countryname = cty_arena_add(parser->strings, c);
+	new_dxcc.cq = w;
+	new_dxcc.itu = i;
+	new_dxcc.continent = cont;
+	new_dxcc.latitude = lat / 100.0;
+	new_dxcc.longitude = lon / -100.0;
+	new_dxcc.timezone = tz;
+	new_dxcc.px = cty_arena_add(parser->strings, p);
+	new_dxcc.exceptions = cty_arena_add(parser->strings, e);
+	g_array_append_val(parser->entities, new_dxcc);
 }
 
 #ifdef USE_AREA_DAT
@@ -338,9 +859,16 @@ area_add(char* c, int w, int i, char* cont, int lat, int lon,
 }
 #endif
 
+/* \a relpath relative to the directory of the executable, unless it's absolute */
 int set_data_path_relative(char *buf, int buflen, const char *relpath)
 {
-	readlink("/proc/self/exe", buf, buflen);
+	if (relpath[0] == '/') {
+		char *end = stpncpy(buf, relpath, buflen - 1);
+		*end = '\0';
+		return end - buf;
+	}
+	ssize_t n = readlink("/proc/self/exe", buf, buflen - 1);
+	buf[n < 0 ? 0 : n] = '\0';
 	char *last_slash = strrchr(buf, '/');
 	int pfx_len = last_slash - buf;
 	//~ printf("executable is %s, tail %s, as fit into buflen %d\n", buf, last_slash, buflen);
@@ -372,128 +900,312 @@ int readctyversion(const char *cty_dat_path)
 	return 0;
 }
 
-/* fill the hashtable with all of the prefixes from cty.dat */
-int readctydata(const char *cty_dat_path)
-{
-	char buf[131072], *pfx, **split, **pfxsplit;
-	int ichar = 0, dxccitem = 0, ipfx = 0, ch = 0;
-	gboolean firstcolon = FALSE;
-	char tmp[20];
-	int i;
-	FILE* fp;
-
-	set_data_path_relative(buf, sizeof(buf), cty_dat_path);
+/*
+   parse cty.dat into the tables of \a parser, which the caller frees
+   with parser_free() if this succeeds
 
-	if ((fp = g_fopen(buf, "r")) == NULL) {
-		printf("didn't find %s\n", buf);
+   The file is mapped privately, and each entity (up to its ';') is
+   tokenized in place in one pass: line breaks, and spaces after the
+   country name, are squeezed out; then it's split into its 9 fields at
+   the first 8 colons, and the last field (the prefix list) at commas.
+ */
+static int parsectydata(cty_parser* parser, const char *cty_dat_path)
+{
+	char path[PATH_MAX], *data, *rec, *rec_end, *in, *out, *field[9], *pfx, *item, *next;
+	int nfields, i;
+	guint exceptions;
+	bool in_name, exception;
+	uchar cq, itu;
+	struct stat st;
+	int fd;
+
+	set_data_path_relative(path, sizeof(path), cty_dat_path);
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		printf("didn't find %s\n", path);
 		return (1);
 	}
+	data = NULL;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		printf("couldn't map %s\n", path);
+		return (2);
+	}
 
-	dxcc = g_ptr_array_new();
-	prefixes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-	full_callsign_exceptions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	/* every exception starts with '=', so the table can be made big enough up front */
+	exceptions = 0;
+	for (in = data; data && in < data + st.st_size; ++in)
+		exceptions += *in == '=';
+	parser_init(parser, exceptions);
 
 	/* first field in case hash_table_lookup returns NULL */
-	dxcc_add("Unknown", 0, 0, 99, 0, 0, 0, "", "");
-	programstate.countries = 1;
-
-	while (!feof(fp)) {
-		while (ch != ';') {
-			ch = fgetc(fp);
-			/* ignore space (exept in the country string), new line, carriage return and semicolon */
-			if (ch == EOF)
-				break;
-			if (ch == ':')
-				firstcolon = TRUE;
-			if (ch == ' ' && firstcolon)
+	dxcc_add(parser, "Unknown", 0, 0, 99, 0, 0, 0, "", "");
+	parser->countries = 1;
+
+	for (rec = data; data && (rec_end = memchr(rec, ';', data + st.st_size - rec)); rec = rec_end + 1) {
+		/* ignore space (exept in the country string), new line and carriage return */
+		in_name = true;
+		for (in = out = rec; in < rec_end; ++in) {
+			if (*in == ':')
+				in_name = false;
+			else if (*in == '\r' || *in == '\n' || (*in == ' ' && !in_name))
 				continue;
-			if (ch == '\r')
-				continue;
-			if (ch == '\n')
-				continue;
-			if (ch == ';')
-				continue;
-			if (ichar >= sizeof(buf)) {
-				printf("buffer not big enough for cty.dat\n");
-				return 2;
-			}
-			buf[ichar++] = ch;
+			*out++ = *in;
 		}
-		if (ch == EOF)
-			break;
 
-		tmp[0] = '\0';
-		buf[ichar] = '\0';
-		ichar = 0;
-		ch = 0;
-		firstcolon = FALSE;
-
-		/* split up the first line */
-		split = g_strsplit(buf, ":", 9);
+		/* split up the first line; the last field is the rest */
+		field[0] = rec;
+		for (nfields = 1; nfields < 9 && (next = memchr(field[nfields - 1], ':', out - field[nfields - 1])); ++nfields)
+			field[nfields] = next + 1;
+		if (nfields < 9)
+			continue;
+		for (i = 0; i < 9; ++i)
+			field[i] = strip(field[i], i < 8 ? field[i + 1] - 1 : out);
 
 		/* ignore WAE countries */
 		/* WAE countries count for CQ contests, but not for ARRL contests. */
-		if (!g_strrstr(split[7], "*")) {
-			for (dxccitem = 0; dxccitem < 9; dxccitem++)
-				g_strstrip(split[dxccitem]);
-
-			dxcc_add(split[0], atoi(split[1]), atoi(split[2]), cont_to_enum(split[3]),
-			    (int)(strtod(split[4], NULL) * 100), (int)(strtod(split[5], NULL) * 100),
-			    (int)(strtod(split[6], NULL) * 10), split[7], split[8]);
-
-			/* NOTE: split[7] is the description prefix, it is not added to the hashtable */
-			/* With this addition, the user can enter the "callsign" like "3D2/R" and the */
-			/* scoring window locator box will show the proper DXCC entity, even though   */
-			/* this isn't a "real" callsign.  AMS 24-feb-2013 */
-
-			if (strchr(split[7], '/')) {
-				for (i = 0; i < strlen(split[7]); i++) {
-					tmp[i] = toupper(split[7][i]);
-				}
-				tmp[i] = '\0';
-				g_hash_table_insert(prefixes, g_strdup(tmp), GINT_TO_POINTER(programstate.countries));
-			}
+		if (strchr(field[7], '*'))
+			continue;
+
+		dxcc_add(parser, field[0], atoi(field[1]), atoi(field[2]), cont_to_enum(field[3]),
+		    (int)(strtod(field[4], NULL) * 100), (int)(strtod(field[5], NULL) * 100),
+		    (int)(strtod(field[6], NULL) * 10), field[7], field[8]);
+
+		/* NOTE: field[7] is the description prefix, it is not added to the hashtable */
+		/* With this addition, the user can enter the "callsign" like "3D2/R" and the */
+		/* scoring window locator box will show the proper DXCC entity, even though   */
+		/* this isn't a "real" callsign.  AMS 24-feb-2013 */
+
+		if (strchr(field[7], '/')) {
+			for (pfx = field[7]; *pfx; ++pfx)
+				*pfx = toupper((uchar)*pfx);
+			pfx_insert(parser, field[7], parser->countries, 0, 0);
+		}
 
-			/* split up the second line */
-			/* The second line is made up of prefixes AND exceptions which start with '=' */
-			/* As of 2.0.11, there are two hashes, one for prefixes and one for           */
-			/* callsign exceptions due to a recently discovered bug.                      */
-
-			pfxsplit = g_strsplit(split[8], ",", 0);
-			for (ipfx = 0;; ipfx++) {
-				if (!pfxsplit[ipfx])
-					break;
-
-				pfx = findpfx_in_exception(pfxsplit[ipfx]);
-				if (!strncmp(pfxsplit[ipfx], "=", 1)) {
-					g_hash_table_insert(full_callsign_exceptions, g_strdup(pfx), GINT_TO_POINTER(programstate.countries));
-				} else {
-					g_hash_table_insert(prefixes, g_strdup(pfx), GINT_TO_POINTER(programstate.countries));
-				}
+		/* The second line is made up of prefixes AND exceptions which start with '=' */
+		/* The prefixes go into the trie, and the exceptions into their own table.   */
+		for (item = field[8]; *item; item = next + 1) {
+			next = strchr(item, ',');
+			if (!next)
+				next = item + strlen(item);
+			bool last = !*next;
+			pfx = parse_prefix(item, next, &cq, &itu, &exception);
+			if (exception) {
+				exception_insert(parser, pfx, parser->countries, cq, itu);
+				if (!strncmp(pfx, "VER", 3))
+					parser->version = atoi(pfx + 3);
+			} else {
+				pfx_insert(parser, pfx, parser->countries, cq, itu);
 			}
-			g_strfreev(pfxsplit);
-			programstate.countries++;
+			if (last)
+				break;
 		}
-		g_strfreev(split);
+		parser->countries++;
 	}
-	fclose(fp);
+	if (data)
+		munmap(data, st.st_size);
 	return (0);
 }
 
-int readabbrev(const char *abbrev_tsv_path)
+static dxcc_context* context_new(const cty_image* img, bool mapped)
+{
+	dxcc_context* ctx = g_new(dxcc_context, 1);
+
+	ctx->img = img;
+	ctx->mapped = mapped;
+	ctx->serial = atomic_fetch_add(&context_serial, 1) + 1;
+	return ctx;
+}
+
+/* free the tables of \a ctx; lookups in it must have finished */
+void dxcc_context_free(dxcc_context* ctx)
+{
+	if (!ctx)
+		return;
+	if (ctx->mapped)
+		cty_image_unmap(ctx->img);
+	else
+		g_free((cty_image*)ctx->img);
+	g_free(ctx);
+}
+
+/*
+   replace the tables that the functions without a context argument use;
+   lookups in other threads carry on meanwhile, with the old or new tables
+ */
+static void set_context(dxcc_context* ctx)
+{
+	pthread_mutex_lock(&replace_lock);
+	dxcc_context* old = atomic_exchange(&current, ctx);
+	atomic_fetch_add(&cty_generation, 1);
+	/* nobody can still be looking in the tables before the old ones */
+	rcu_synchronize();
+	dxcc_context_free(retired);
+	retired = old;
+	pthread_mutex_unlock(&replace_lock);
+}
+
+/* fill the tables from cty.dat */
+int readctydata(const char *cty_dat_path)
+{
+	cty_parser parser;
+	int ret = parsectydata(&parser, cty_dat_path);
+
+	if (ret == 0) {
+		set_context(context_new(cty_image_build(parser.entities, parser.strings, parser.trie,
+		    &parser.exceptions, NULL, parser.version), false));
+		parser_free(&parser);
+	}
+	return ret;
+}
+
+/*!
+    Load the tables from cty.dat and the abbreviations from abbrev.tsv
+    into a new context, which can be used by any number of threads at once.
+    If there is a snapshot (cty.dat.bin) made from the same versions of both
+    files, it's mapped and used without any parsing; otherwise both files are
+    parsed and the snapshot is written for next time, if the directory is
+    writable. Returns NULL on failure, and sets *error (if given) to the
+    error from readctydata() if cty.dat could not be read, or 3 if
+    abbrev.tsv could not be read.
+ */
+dxcc_context* dxcc_context_load(const char *cty_dat_path, const char *abbrev_tsv_path, int* error)
+{
+	char path[PATH_MAX], snapshot[PATH_MAX + 4];
+	cty_stamp cty_dat, abbrev_tsv;
+	const cty_image* img;
+	cty_image* built;
+	cty_parser parser;
+	GHashTable* abbrevs;
+	int ret;
+
+	if (!error)
+		error = &ret;
+	*error = 0;
+	set_data_path_relative(path, sizeof(path), cty_dat_path);
+	snprintf(snapshot, sizeof(snapshot), "%s.bin", path);
+	if (cty_stamp_file(path, &cty_dat)) {
+		printf("didn't find %s\n", path);
+		*error = 1;
+		return NULL;
+	}
+	set_data_path_relative(path, sizeof(path), abbrev_tsv_path);
+	if (cty_stamp_file(path, &abbrev_tsv)) {
+		printf("didn't find %s\n", path);
+		*error = 3;
+		return NULL;
+	}
+
+	if ((img = cty_image_map(snapshot, &cty_dat, &abbrev_tsv)))
+		return context_new(img, true);
+
+	if ((*error = parsectydata(&parser, cty_dat_path)))
+		return NULL;
+	if (!(abbrevs = parseabbrev(abbrev_tsv_path))) {
+		parser_free(&parser);
+		*error = 3;
+		return NULL;
+	}
+	built = cty_image_build(parser.entities, parser.strings, parser.trie, &parser.exceptions,
+	    abbrevs, parser.version);
+	parser_free(&parser);
+	g_hash_table_destroy(abbrevs);
+	built->cty_dat = cty_dat;
+	built->abbrev_tsv = abbrev_tsv;
+	cty_image_write(built, snapshot);
+	return context_new(built, false);
+}
+
+/*!
+    Load the tables with dxcc_context_load(), for the functions without a
+    context argument. Returns 0 on success, or the error from
+    dxcc_context_load().
+
+    To pick up a new cty.dat, call it again, e.g. from a background thread:
+    lookups in other threads don't wait while it loads, and go on with the
+    old tables until the new ones are complete. If loading fails, the old
+    tables stay.
+ */
+int loadctydata(const char *cty_dat_path, const char *abbrev_tsv_path)
+{
+	int ret;
+	dxcc_context* ctx = dxcc_context_load(cty_dat_path, abbrev_tsv_path, &ret);
+
+	if (ctx)
+		set_context(ctx);
+	return ret;
+}
+
+/* the version of the cty.dat loaded into \a ctx, from its =VER entry */
+int dxcc_context_version(const dxcc_context* ctx)
+{
+	return ctx ? ctx->img->version : 0;
+}
+
+/*!
+    A number for \a ctx that no other context made by this process has had
+    (0 for NULL), so that what was computed from it can be told from what
+    was computed from a later one, even one at the same address.
+ */
+unsigned int dxcc_context_serial(const dxcc_context* ctx)
+{
+	return ctx ? ctx->serial : 0;
+}
+
+/* the number of entities in \a ctx, including 0 for unknown */
+int dxcc_context_entities(const dxcc_context* ctx)
+{
+	return ctx ? (int)ctx->img->nentities : 0;
+}
+
+/*!
+    Put entity number \a country of \a ctx (as returned by dxcc_lookup())
+    into \a result, as a lookup of one of its callsigns would, but without
+    zone exceptions. Returns false if there's no such entity.
+ */
+bool dxcc_entity(const dxcc_context* ctx, int country, dxcc_data* result)
+{
+	if (!ctx || !result || country < 0 || country >= (int)ctx->img->nentities)
+		return false;
+	*result = entity_data(ctx->img, cty_entity_at(ctx->img, country));
+	result->country = country;
+	return true;
+}
+
+/* the version of the loaded cty.dat, from its =VER entry */
+int loadedctyversion(void)
+{
+	rcu_reader reader = rcu_read_lock();
+	int ret = dxcc_context_version(atomic_load(&current));
+
+	rcu_read_unlock(reader);
+	return ret;
+}
+
+/* changes whenever the tables are loaded again, invalidating earlier results */
+uint loadedctygeneration(void)
+{
+	return atomic_load(&cty_generation);
+}
+
+/* read abbrev.tsv into a table of country name -> abbreviation; NULL on failure */
+static GHashTable* parseabbrev(const char *abbrev_tsv_path)
 {
 	char buf[128];
 	FILE* fp;
 	int count = 0;
+	GHashTable* abbreviations;
 
 	set_data_path_relative(buf, sizeof(buf), abbrev_tsv_path);
 
 	if ((fp = g_fopen(buf, "r")) == NULL) {
 		printf("didn't find %s\n", buf);
-		return (1);
+		return NULL;
 	}
 
-	abbreviations = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	abbreviations = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 
 	while (!feof(fp)) {
 		if (!fgets(buf, sizeof(buf), fp))
@@ -512,6 +1224,19 @@ int readabbrev(const char *abbrev_tsv_path)
 
 	fclose(fp);
 	//~ printf("read %d abbreviations\n", count);
+	return abbreviations;
+}
+
+/* load the abbreviations for abbreviate_country() from abbrev.tsv */
+int readabbrev(const char *abbrev_tsv_path)
+{
+	GHashTable* table = parseabbrev(abbrev_tsv_path);
+
+	if (!table)
+		return (1);
+	if (abbreviations)
+		g_hash_table_destroy(abbreviations);
+	abbreviations = table;
 	return (0);
 }
 
@@ -587,16 +1312,21 @@ char lookuparea(const char* callsign)
 
 void list_all_countries()
 {
-	if (dxcc) {
-		for (int i = 0; i < dxcc->len; i++) {
-			dxcc_data* d = g_ptr_array_index(dxcc, i);
-			const char *abbrev = abbreviate_country(d->countryname);
+	rcu_reader reader = rcu_read_lock();
+	const dxcc_context* ctx = atomic_load(&current);
+
+	if (ctx) {
+		const cty_image* cty = ctx->img;
+		for (guint32 i = 0; i < cty->nentities; i++) {
+			const char *countryname = cty_string(cty, cty_entity_at(cty, i)->countryname);
+			const char *abbrev = abbreviate_country(countryname);
 			if (abbrev)
-				printf("%s\t%s\n", abbrev, d->countryname);
+				printf("%s\t%s\n", abbrev, countryname);
 			else
-				printf("\t%s\n", d->countryname);
+				printf("\t%s\n", countryname);
 		}
 	}
+	rcu_read_unlock(reader);
 }
 
 void hash_inc(GHashTable* hash_table, const char* key)
@@ -7,7 +7,11 @@
    Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
 */
 
+#ifdef CLU_NO_GLIB
+#include "miniglib.h"
+#else
 #include <glib.h>
+#endif
 #include <stdbool.h>
 
 #ifndef uchar
@@ -20,24 +24,7 @@
 #ifndef DXCC_H
 #define DXCC_H
 
-/* struct for dxcc information from cty.dat */
-typedef struct
-{
-	const char *countryname;
-	uint country;
-	uchar cq; /* uchar max=255 */
-	uchar itu;
-	uchar continent;
-	float latitude;
-	float longitude;
-	short timezone;
-	const char *px;
-	const char *exceptions;
-#ifdef USE_AREA_DAT
-	const char *area; // TODO fill it
-#endif
-}
-dxcc_data;
+#include "clu.h"
 
 #ifdef USE_AREA_DAT
 /* struct for dxcc information from area.dat */
@@ -58,13 +45,19 @@ void cleanup_area(void);
 #endif
 
 void cleanup_dxcc(void);
+int set_data_path_relative(char *buf, int buflen, const char *relpath);
 int readctyversion(const char *cty_dat_path);
 int readctydata(const char *cty_dat_path);
 int readabbrev(const char *abbrev_tsv_path);
-bool is_grid(const char* grid);
+int loadctydata(const char *cty_dat_path, const char *abbrev_tsv_path);
+int loadedctyversion(void);
+uint loadedctygeneration(void);
 dxcc_data lookupcountry_by_callsign(const char* callsign);
+int lookupcountry_by_callsign_r(const char* callsign, dxcc_data* result, dxcc_scratch* scratch);
+void lookupcountry_batch(const char* const* callsigns, dxcc_data* results, size_t count);
+void lookupcountry_cache(uint capacity);
+bool lookupcountry_cache_stats(guint64* hits, guint64* misses);
 const char *abbreviate_country(const char *country);
-bool set_location_from_grid(dxcc_data* info, const char* grid);
 
 void list_all_countries();
 void hash_inc(GHashTable* hash_table, const char* key);
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * ft8msg.c - who is who in a standard FT8 or FT4 message
+ *
+ * The standard messages are few, and their words always come in the same
+ * order, so the role of each word follows from its position and its shape:
+ *
+ *   CQ [modifier] CALLER [grid]
+ *   QRZ CALLER [grid]
+ *   CALLEE CALLER [grid | report | R report | R grid | RRR | RR73 | 73]
+ *
+ * where the caller is the station sending the message, so the grid is
+ * always the caller's. A callsign may be sent hashed, in angle brackets,
+ * and then it may be unknown: <...>. The modifier of a CQ is up to four
+ * letters (DX, NA, POTA, TEST...) or three digits (a frequency).
+ */
+
+#include <string.h>
+
+#include "clu.h"
+
+static bool is_word(const char* word, const char* expected)
+{
+	return !strcmp(word, expected);
+}
+
+/* a callsign, or one in angle brackets, or <...> */
+static bool is_callsign(const char* word, bool* hashed)
+{
+	size_t len = strlen(word);
+
+	*hashed = len > 2 && word[0] == '<' && word[len - 1] == '>';
+	if (*hashed)
+		return (len == 5 && !strncmp(word, "<...>", 5))
+		    || token_kind(word + 1, len - 2) == TOKEN_CALLSIGN;
+	return token_kind(word, len) == TOKEN_CALLSIGN;
+}
+
+static bool is_grid4(const char* word)
+{
+	return strlen(word) == 4 && token_kind(word, 4) == TOKEN_GRID;
+}
+
+/* -30 .. +49 and the like, maybe with R in front */
+static bool is_report(const char* word)
+{
+	if (*word == 'R')
+		++word;
+	if (*word != '-' && *word != '+')
+		return false;
+	++word;
+	if (*word < '0' || *word > '9')
+		return false;
+	++word;
+	if (*word >= '0' && *word <= '9')
+		++word;
+	return !*word;
+}
+
+static bool is_modifier(const char* word)
+{
+	size_t len = strlen(word), i;
+
+	if (len == 3 && strspn(word, "0123456789") == 3)
+		return true;
+	for (i = 0; i < len; ++i)
+		if (word[i] < 'A' || word[i] > 'Z')
+			return false;
+	return len > 0 && len <= 4;
+}
+
+/*!
+    Parse the \a count \a words of a standard FT8 or FT4 message (without
+    the time, SNR and so on that come before it in a decode) into \a msg,
+    where each role is the index of its word, or -1 if the message doesn't
+    have it. Returns false, with \a msg undefined, if it's not one of the
+    standard forms.
+
+    The grid in "RR73" position is taken as the acknowledgement, as WSJT-X
+    does, although it's also a grid.
+ */
+bool ft8_parse(int count, const char* const* words, ft8_message* msg)
+{
+	int i = 0;
+
+	msg->cq = msg->modifier = msg->callee = msg->caller = msg->grid = msg->report = -1;
+	msg->callee_hashed = msg->caller_hashed = false;
+	if (count < 2)
+		return false;
+
+	if (is_word(words[0], "CQ") || is_word(words[0], "QRZ")) {
+		bool hashed;
+
+		msg->cq = i++;
+		if (count >= 3 && is_word(words[0], "CQ") && is_modifier(words[i])
+		    && is_callsign(words[i + 1], &hashed))
+			msg->modifier = i++;
+		if (!is_callsign(words[i], &msg->caller_hashed))
+			return false;
+		msg->caller = i++;
+		if (i < count && is_grid4(words[i]))
+			msg->grid = i++;
+		return i == count;
+	}
+
+	if (!is_callsign(words[0], &msg->callee_hashed) || !is_callsign(words[1], &msg->caller_hashed))
+		return false;
+	msg->callee = 0;
+	msg->caller = 1;
+	i = 2;
+	if (i == count)
+		return true;
+	if (is_word(words[i], "RR73") || is_word(words[i], "RRR") || is_word(words[i], "73")
+	    || is_report(words[i])) {
+		msg->report = i++;
+	} else if (is_word(words[i], "R") && i + 1 < count && is_grid4(words[i + 1])) {
+		msg->report = i++;
+		msg->grid = i++;
+	} else if (is_grid4(words[i])) {
+		msg->grid = i++;
+	}
+	return i == count;
+}
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * lookupcache.c - remember the results of recent lookups
+ *
+ * On the air, the same few hundred callsigns come up over and over, so a
+ * small cache of lookup results saves most of the work. It holds a fixed
+ * number of entries, allocated up front, and when it's full the least
+ * recently used one is replaced. Entries are found through a chained hash
+ * table, and kept in order of use on a doubly-linked list; links are entry
+ * numbers + 1, so that 0 can mean none.
+ *
+ * Results point into the loaded tables, so the cache empties itself when
+ * they are reloaded (see loadedctygeneration()).
+ */
+
+#include <string.h>
+
+#include "ctyimage.h"
+#include "lookupcache.h"
+
+typedef struct
+{
+	char callsign[DXCC_MAX_CALLSIGN + 1];
+	guint32 hash;
+	guint32 chain;      /* next entry in the same bucket */
+	guint32 newer, older;
+	int ret;
+	dxcc_data result;
+} cache_entry;
+
+struct lookup_cache
+{
+	guint32 capacity, used;
+	guint32 mask;       /* number of buckets - 1 */
+	guint32 newest, oldest;
+	uint generation;    /* of the tables that the entries came from */
+	guint64 hits, misses;
+	guint32* buckets;
+	cache_entry* entries;
+};
+
+/*!
+    Make a cache for the results of up to \a capacity lookups.
+    It's not thread-safe: give each thread its own.
+ */
+lookup_cache* lookup_cache_new(uint capacity)
+{
+	lookup_cache* cache = g_new0(lookup_cache, 1);
+	guint32 n = 8;
+
+	while (n < capacity)
+		n <<= 1;
+	cache->capacity = MAX(capacity, 1);
+	cache->mask = n - 1;
+	cache->buckets = g_new0(guint32, n);
+	cache->entries = g_new(cache_entry, cache->capacity);
+	cache->generation = loadedctygeneration();
+	return cache;
+}
+
+void lookup_cache_free(lookup_cache* cache)
+{
+	if (!cache)
+		return;
+	g_free(cache->buckets);
+	g_free(cache->entries);
+	g_free(cache);
+}
+
+/* forget all the entries; the hit and miss counts are kept */
+void lookup_cache_clear(lookup_cache* cache)
+{
+	memset(cache->buckets, 0, (cache->mask + 1) * sizeof(guint32));
+	cache->used = 0;
+	cache->newest = cache->oldest = 0;
+	cache->generation = loadedctygeneration();
+}
+
+void lookup_cache_stats(const lookup_cache* cache, guint64* hits, guint64* misses)
+{
+	*hits = cache->hits;
+	*misses = cache->misses;
+}
+
+#define ENTRY(cache, link) (&(cache)->entries[(link) - 1])
+
+static void unlink_entry(lookup_cache* cache, guint32 link)
+{
+	cache_entry* e = ENTRY(cache, link);
+
+	if (e->newer)
+		ENTRY(cache, e->newer)->older = e->older;
+	else
+		cache->newest = e->older;
+	if (e->older)
+		ENTRY(cache, e->older)->newer = e->newer;
+	else
+		cache->oldest = e->newer;
+}
+
+static void make_newest(lookup_cache* cache, guint32 link)
+{
+	cache_entry* e = ENTRY(cache, link);
+
+	e->newer = 0;
+	e->older = cache->newest;
+	if (cache->newest)
+		ENTRY(cache, cache->newest)->newer = link;
+	else
+		cache->oldest = link;
+	cache->newest = link;
+}
+
+/* take the oldest entry out of its bucket, to be reused */
+static guint32 evict(lookup_cache* cache)
+{
+	guint32 link = cache->oldest;
+	guint32* p = &cache->buckets[ENTRY(cache, link)->hash & cache->mask];
+
+	while (*p != link)
+		p = &ENTRY(cache, *p)->chain;
+	*p = ENTRY(cache, link)->chain;
+	unlink_entry(cache, link);
+	return link;
+}
+
+/*!
+    Like lookupcountry_by_callsign_r(), but the result may come from
+    \a cache, which then remembers it. The callsign is the key as given:
+    lookups are case-sensitive, as cty.dat is. Callsigns longer than
+    DXCC_MAX_CALLSIGN are never cached. Once the cache is full, this
+    doesn't allocate memory.
+ */
+int lookup_cache_lookup(lookup_cache* cache, const char* callsign, dxcc_data* result)
+{
+	dxcc_scratch scratch;
+	cache_entry* e;
+	guint32 hash, link;
+	int len = strnlen(callsign, DXCC_MAX_CALLSIGN + 1);
+
+	if (len > DXCC_MAX_CALLSIGN)
+		return lookupcountry_by_callsign_r(callsign, result, &scratch);
+	if (cache->generation != loadedctygeneration())
+		lookup_cache_clear(cache);
+
+	hash = cty_hash(callsign);
+	for (link = cache->buckets[hash & cache->mask]; link; link = e->chain) {
+		e = ENTRY(cache, link);
+		if (e->hash == hash && !strcmp(e->callsign, callsign)) {
+			if (cache->newest != link) {
+				unlink_entry(cache, link);
+				make_newest(cache, link);
+			}
+			++cache->hits;
+			*result = e->result;
+			return e->ret;
+		}
+	}
+
+	++cache->misses;
+	link = cache->used < cache->capacity ? ++cache->used : evict(cache);
+	e = ENTRY(cache, link);
+	memcpy(e->callsign, callsign, len + 1);
+	e->hash = hash;
+	e->ret = lookupcountry_by_callsign_r(callsign, &e->result, &scratch);
+	e->chain = cache->buckets[hash & cache->mask];
+	cache->buckets[hash & cache->mask] = link;
+	make_newest(cache, link);
+	*result = e->result;
+	return e->ret;
+}
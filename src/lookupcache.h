@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * lookupcache.h - remember the results of recent lookups
+ */
+#ifndef LOOKUPCACHE_H
+#define LOOKUPCACHE_H
+
+#include "dxcc.h"
+
+typedef struct lookup_cache lookup_cache;
+
+lookup_cache* lookup_cache_new(uint capacity);
+void lookup_cache_free(lookup_cache* cache);
+int lookup_cache_lookup(lookup_cache* cache, const char* callsign, dxcc_data* result);
+void lookup_cache_clear(lookup_cache* cache);
+void lookup_cache_stats(const lookup_cache* cache, guint64* hits, guint64* misses);
+
+#endif /* LOOKUPCACHE_H */
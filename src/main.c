@@ -11,27 +11,91 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <limits.h>
 #include <locale.h>
 #include <string.h>
 #include <stdio.h>
+#include <poll.h>
 
 #include "dxcc.h"
 #include "locator.h"
 #include "awards_enum.h"
+#include "daemon.h"
 
 static const char* cty_location = "../share/clu/cty.dat";
 static const char* abbrev_location = "../share/clu/abbrev.tsv";
+static const char* zones_location = "../share/clu/zones.dat";
+static zone_map* zones; /* if zones.dat is there */
 
 bool show_prefix = false;
 bool show_distance = false;
 
+/* load cty.dat and abbrev.tsv, or the snapshot made from them */
+static void
+load(void)
+{
+	switch (loadctydata(cty_location, abbrev_location)) {
+	case 0:
+		break;
+	case 3:
+		exit(-3);
+	default:
+		exit(-2);
+	}
+}
+
+/* load the zone boundaries, which are optional */
+static void
+load_zones(void)
+{
+	char path[PATH_MAX];
+
+	set_data_path_relative(path, sizeof(path), zones_location);
+	if (access(path, R_OK) == 0)
+		zones = zone_map_load(zones_location);
+}
+
+/* print what's been worked and confirmed in the ADIF log at \a path */
+static int
+summarize_log(const char* path)
+{
+	static const char* const names[] = { "DXCC", "WAZ", "WAC", "WAS", "IOTA", "grids" };
+	dxcc_context* ctx = dxcc_context_load(cty_location, abbrev_location, NULL);
+	adif_stats* stats;
+	int ret;
+
+	if (!ctx)
+		return (-2);
+	load_zones();
+	stats = adif_stats_new(ctx);
+	ret = adif_read(path, ctx, zones, stats);
+	if (ret)
+		fprintf(stderr, "didn't find %s\n", path);
+	else {
+		printf("%u QSOs, %u confirmed, %u of unknown entities, %u with grids\n",
+		    stats->qsos, stats->confirmed, stats->unknown, stats->located);
+		for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+			printf("%-6s worked %5u confirmed %5u\n", names[i],
+			    awards_count(stats->awards, i, AWARDS_ANY, AWARDS_ANY, false),
+			    awards_count(stats->awards, i, AWARDS_ANY, AWARDS_ANY, true));
+		for (int i = 0; i < AWARD_BANDS; ++i)
+			if (stats->band_qsos[i])
+				printf("%-6s %6u QSOs, %3u entities\n", awards_band_name(i), stats->band_qsos[i],
+				    awards_count(stats->awards, AWARD_DXCC, i, AWARDS_ANY, false));
+	}
+	adif_stats_free(stats);
+	zone_map_free(zones);
+	dxcc_context_free(ctx);
+	return ret;
+}
+
 /* command line options */
 static void
 parsecommandline(int argc, char* argv[])
 {
 	int p;
 
-	while ((p = getopt(argc, argv, "pdlhv")) != -1) {
+	while ((p = getopt(argc, argv, "pdlhva:s:")) != -1) {
 		switch (p) {
 		case 'p':
 			show_prefix = true;
@@ -40,87 +104,97 @@ parsecommandline(int argc, char* argv[])
 			show_distance = true;
 			break;
 		case 'l':
-			if (readctydata(cty_location)) // error if not false
-				exit(-2);
-			if (readabbrev(abbrev_location))
-				exit(-3);
+			load();
 			list_all_countries();
 			exit(0);
 		case 'v':
-			printf("cty version %d\n", readctyversion(cty_location));
+			load();
+			printf("cty version %d\n", loadedctyversion());
+			load_zones();
+			printf("zones %s\n", zones ? "from zones.dat" : "from cty.dat only (no zones.dat)");
+			zone_map_free(zones);
 			exit(0);
+		case 'a':
+			exit(summarize_log(optarg));
+		case 's':
+			load();
+			exit(serve_unix_socket(optarg, cty_location, abbrev_location));
 		case ':':
 		case '?':
 		case 'h':
-			printf("Usage: clu [option] callsign\n");
+			printf("Usage: clu [option] callsign...\n");
+			printf("	With no callsigns, read lines of them (or FT8 messages, spots...) from standard input\n");
 			printf("	-p	Show prefix and exceptions for the country\n");
 			printf("	-d	Show distance between two grids\n");
+			printf("	-s path	Answer lookups from clients of a Unix domain socket at path, one callsign per line;\n\t\tSIGHUP reloads cty.dat\n");
+			printf("	-a path	Count the QSOs in an ADIF log by award, band and entity, and exit\n");
 			printf("	-l	List all known countries and their abbreviations, and exit\n");
 			printf("	-h	Display this help and exit\n");
 			printf("	-v	Output version information and exit\n");
+			printf("Zones are refined by grid only if %s (relative to the clu binary) exists;\nnone is installed with clu, ", zones_location);
+			printf("so by default each callsign gets the CQ and ITU zones cty.dat gives its prefix\n");
 			exit(0);
 		}
 	}
 }
 
+/* print what was found about \a callsign, and the \a grid it's at if known */
+static void
+print_callsign(const char *callsign, const char *grid, const dxcc_data *info)
+{
+	const char *abbrev = abbreviate_country(info->countryname);
+
+	if (grid)
+		printf("%s @ %s: ", callsign, grid);
+	else
+		printf("%s: ", callsign);
+	if (show_prefix) {
+		printf("country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f prefix %s exceptions: %s\n",
+			info->country, abbrev, info->countryname, info->cq, info->itu,
+			info->continent, enum_to_cont(info->continent), info->latitude, info->longitude, info->px, info->exceptions);
+	} else {
+		printf("country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f\n",
+			info->country, abbrev, info->countryname, info->cq, info->itu,
+			info->continent, enum_to_cont(info->continent), info->latitude, info->longitude);
+	}
+}
+
 /*!
 	Expect a series of callsigns, alternating callsigns and grids,
 	FT8 messages, etc. Detect the callsigns and grids and
 	look up their countries and coordinates.
+	\a kinds are the token_kind() of \a tokens: only the ones that
+	look like callsigns are looked up.
 */
-int main(int argc, char* argv[])
+static void
+classify(int count, char* tokens[], const unsigned char* kinds)
 {
-	parsecommandline(argc, argv);
-	if (readctydata(cty_location)) // error if not false
-		return -2;
-	if (readabbrev(abbrev_location))
-		exit(-3);
-#ifdef USE_AREA_DAT
-	readareadata();
-#endif
 	dxcc_data info;
 	memset(&info, 0, sizeof(info));
-	bool is_gr = is_grid(argv[optind]);
+	bool is_gr = count > 0 && kinds[0] == TOKEN_GRID;
 	char *callsign = 0;
 	float last_lat = 999.0, last_lon = 999.0;
-	for (int i = optind; i < argc; ++i) {
+	for (int i = 0; i < count; ++i) {
 		bool is_cs = false;
-		bool next_is_gr = i < argc && is_grid(argv[i + 1]);
-		if (!is_gr) {
-			info = lookupcountry_by_callsign(argv[i]);
-			if (info.country && strlen(argv[i]) > strlen(info.px)) {
+		bool next_is_gr = i + 1 < count && kinds[i + 1] == TOKEN_GRID;
+		if (!is_gr && kinds[i] == TOKEN_CALLSIGN) {
+			info = lookupcountry_by_callsign(tokens[i]);
+			if (info.country && strlen(tokens[i]) > strlen(info.px)) {
 				// country was found and the candidate is longer than its prefix: must be a callsign
 				is_cs = true;
-				callsign = argv[i];
+				callsign = tokens[i];
 			}
 		}
-		//~ printf("    %s: cs? %d gr? %d\n", argv[i], is_cs, is_gr);
-		if (!is_cs && is_gr) // refine the callsign's location by grid, if found
-			set_location_from_grid(&info, argv[i]);
+		//~ printf("    %s: cs? %d gr? %d\n", tokens[i], is_cs, is_gr);
+		// refine the callsign's location by grid, if found, and its zones by location
+		if (!is_cs && is_gr && set_location_from_grid(&info, tokens[i]) && callsign)
+			set_zones_from_location(&info, zones);
 		if (is_gr && callsign) {
-			const char *abbrev = abbreviate_country(info.countryname);
-			if (show_prefix) {
-				printf("%s @ %s: country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f prefix %s exceptions: %s\n",
-					callsign, argv[i], info.country, abbrev, info.countryname, info.cq, info.itu,
-					info.continent, enum_to_cont(info.continent), info.latitude, info.longitude, info.px, info.exceptions);
-			} else {
-				printf("%s @ %s: country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f\n",
-					callsign, argv[i], info.country, abbrev, info.countryname, info.cq, info.itu,
-					info.continent, enum_to_cont(info.continent), info.latitude, info.longitude);
-			}
+			print_callsign(callsign, tokens[i], &info);
 			callsign = 0;
 			memset(&info, 0, sizeof(info));
 		} else if (is_cs && !next_is_gr) {
-			const char *abbrev = abbreviate_country(info.countryname);
-			if (show_prefix) {
-				printf("%s: country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f prefix %s exceptions: %s\n",
-					callsign, info.country, abbrev, info.countryname, info.cq, info.itu,
-					info.continent, enum_to_cont(info.continent), info.latitude, info.longitude, info.px, info.exceptions);
-			} else {
-				printf("%s: country %d %s '%s' cq %d itu %d continent %d %s lat %6.2f lon %6.2f\n",
-					callsign, info.country, abbrev, info.countryname, info.cq, info.itu,
-					info.continent, enum_to_cont(info.continent), info.latitude, info.longitude);
-			}
+			print_callsign(callsign, NULL, &info);
 			callsign = 0;
 			memset(&info, 0, sizeof(info));
 		} else if (is_gr) {
@@ -130,13 +204,13 @@ int main(int argc, char* argv[])
 				ret = qrb(last_lon, last_lat, info.longitude, info.latitude, &dist, &azimuth);
 				if (ret == RIG_OK)
 					printf("%s:\t%.2f,%.2f to %.2f,%.2f\t: distance %5.0lf azimuth %3.0lf\n",
-						argv[i], last_lat, last_lon, info.latitude, info.longitude, dist, azimuth);
+						tokens[i], last_lat, last_lon, info.latitude, info.longitude, dist, azimuth);
 				else
 					printf("distance calculation failed\n");
 			}
 			if (ret != RIG_OK) {
 				printf("%s:\t%.2f,%.2f\n",
-					argv[i], info.latitude, info.longitude);
+					tokens[i], info.latitude, info.longitude);
 			}
 		}
 		if (is_gr) {
@@ -145,8 +219,161 @@ int main(int argc, char* argv[])
 		}
 		is_gr = next_is_gr;
 	}
+}
+
+/* look up a callsign from a message, which may be in <angle brackets> */
+static void
+print_station(const char *word, bool hashed, const char *grid)
+{
+	char callsign[DXCC_MAX_CALLSIGN + 1];
+	dxcc_data info;
+
+	if (hashed) {
+		if (!strcmp(word, "<...>"))
+			return;
+		snprintf(callsign, sizeof(callsign), "%.*s", (int)strlen(word) - 2, word + 1);
+		word = callsign;
+	}
+	info = lookupcountry_by_callsign(word);
+	if (info.country) {
+		if (grid && set_location_from_grid(&info, grid))
+			set_zones_from_location(&info, zones);
+		print_callsign(word, grid, &info);
+	} else if (grid && set_location_from_grid(&info, grid)) {
+		printf("%s:\t%.2f,%.2f\n", grid, info.latitude, info.longitude);
+	}
+}
+
+/*
+	If \a tokens are a standard FT8 or FT4 message, perhaps after the
+	time, SNR, DT and frequency of a decode (from WSJT-X's ALL.TXT, or
+	its window, with ~ before the message), look up the callsigns in it,
+	and attach the grid to the station that sent it.
+	Returns false if it's not such a message.
+*/
+static bool
+classify_message(int count, char* tokens[])
+{
+	ft8_message msg;
+	int start = 0;
+
+	for (int i = 0; i < count && i < 8; ++i) {
+		if (!strcmp(tokens[i], "~") || !strcmp(tokens[i], "+")) {
+			start = i + 1;
+			break;
+		}
+		if ((!strcmp(tokens[i], "FT8") || !strcmp(tokens[i], "FT4")) && i + 4 < count) {
+			start = i + 4;
+			break;
+		}
+	}
+	if (!ft8_parse(count - start, (const char* const*)tokens + start, &msg))
+		return false;
+	if (msg.callee >= 0)
+		print_station(tokens[start + msg.callee], msg.callee_hashed, NULL);
+	print_station(tokens[start + msg.caller], msg.caller_hashed,
+		msg.grid >= 0 ? tokens[start + msg.grid] : NULL);
+	return true;
+}
+
+/*
+	Read lines from standard input until EOF, and classify the
+	whitespace-separated tokens on each line independently.
+	Whatever complete lines have been read are scanned at once with
+	scan_tokens(), and the tokens are terminated in place.
+	The output is flushed whenever we are about to wait for more input.
+*/
+static void
+classify_stdin(void)
+{
+	size_t size = 65536, used = 0, end, count, scanned, i, line;
+	size_t maxspans = 4096;
+	char *buf = malloc(size);
+	token_span *spans = malloc(maxspans * sizeof(token_span));
+	char **tokens = malloc(maxspans * sizeof(char*));
+	unsigned char *kinds = malloc(maxspans);
+	struct pollfd ready = { .fd = STDIN_FILENO, .events = POLLIN };
+	ssize_t n;
+
+	setvbuf(stdout, NULL, _IOFBF, 65536);
+	/* the same callsigns keep coming up in a stream of decodes or spots */
+	lookupcountry_cache(4096);
+	for (;;) {
+		if (used == size)
+			buf = realloc(buf, size *= 2);
+		/* show the answers before waiting for more input, but not after every read */
+		if (poll(&ready, 1, 0) == 0)
+			fflush(stdout);
+		n = read(STDIN_FILENO, buf + used, size - used);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			/* classify the last line, even without a newline */
+			n = 0;
+			if (used == 0)
+				break;
+			buf[used++] = '\n';
+		}
+		used += n;
+		for (end = used; end > 0 && buf[end - 1] != '\n'; --end)
+			;
+		/* find all the tokens in the complete lines, with room for more than that */
+		while ((count = scan_tokens(buf, end, spans, maxspans, &scanned)) == maxspans && scanned < end) {
+			maxspans *= 2;
+			spans = realloc(spans, maxspans * sizeof(token_span));
+			tokens = realloc(tokens, maxspans * sizeof(char*));
+			kinds = realloc(kinds, maxspans);
+		}
+		for (i = 0; i < count; ++i) {
+			/* each is followed by a separator, at least the newline */
+			buf[spans[i].start + spans[i].length] = '\0';
+			tokens[i] = buf + spans[i].start;
+			kinds[i] = spans[i].kind;
+		}
+		for (line = 0, i = 1; i <= count; ++i) {
+			if (i == count || spans[i].line_start) {
+				if (!classify_message(i - line, tokens + line))
+					classify(i - line, tokens + line, kinds + line);
+				line = i;
+			}
+		}
+		memmove(buf, buf + end, used - end);
+		used -= end;
+		if (n == 0 && used == 0)
+			break;
+	}
+	fflush(stdout);
+	free(spans);
+	free(kinds);
+	free(tokens);
+	free(buf);
+}
+
+/*!
+	Classify the tokens given as arguments; or if there are none,
+	each line from standard input, so that one process (which loads
+	cty.dat only once) can serve a whole pipeline.
+*/
+int main(int argc, char* argv[])
+{
+	parsecommandline(argc, argv);
+	load();
+	load_zones();
+#ifdef USE_AREA_DAT
+	readareadata();
+#endif
+	if (optind < argc) {
+		unsigned char kinds[argc - optind];
+
+		for (int i = optind; i < argc; ++i)
+			kinds[i - optind] = token_kind(argv[i], strlen(argv[i]));
+		if (!classify_message(argc - optind, argv + optind))
+			classify(argc - optind, argv + optind, kinds);
+	} else
+		classify_stdin();
 #ifdef USE_AREA_DAT
 	cleanup_area();
 #endif
+	zone_map_free(zones);
 	cleanup_dxcc();
 }
@@ -0,0 +1,463 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * miniglib.c - the little of glib that clu uses, for building without it
+ */
+
+#include <limits.h>
+
+#include "miniglib.h"
+
+static gpointer check(gpointer mem, gsize size)
+{
+	if (!mem && size) {
+		fprintf(stderr, "failed to allocate %zu bytes\n", size);
+		abort();
+	}
+	return mem;
+}
+
+gpointer g_malloc(gsize size)
+{
+	return size ? check(malloc(size), size) : NULL;
+}
+
+gpointer g_malloc0(gsize size)
+{
+	return size ? check(calloc(1, size), size) : NULL;
+}
+
+gpointer g_realloc(gpointer mem, gsize size)
+{
+	if (!size) {
+		free(mem);
+		return NULL;
+	}
+	return check(realloc(mem, size), size);
+}
+
+gchar* g_strdup(const gchar* str)
+{
+	return str ? g_strndup(str, strlen(str)) : NULL;
+}
+
+/* a copy of \a str, or of its first \a n characters if it's longer */
+gchar* g_strndup(const gchar* str, gsize n)
+{
+	gchar* ret;
+
+	if (!str)
+		return NULL;
+	ret = g_malloc(n + 1);
+	strncpy(ret, str, n);
+	ret[n] = '\0';
+	return ret;
+}
+
+gsize g_strlcpy(gchar* dest, const gchar* src, gsize dest_size)
+{
+	gsize len = strlen(src);
+
+	if (dest_size) {
+		gsize n = MIN(len, dest_size - 1);
+		memcpy(dest, src, n);
+		dest[n] = '\0';
+	}
+	return len;
+}
+
+/* compare, ignoring the case of ASCII letters regardless of the locale */
+gint g_ascii_strcasecmp(const gchar* s1, const gchar* s2)
+{
+	gint c1, c2;
+
+	do {
+		c1 = (guchar)*s1++;
+		c2 = (guchar)*s2++;
+		if (c1 >= 'A' && c1 <= 'Z')
+			c1 += 'a' - 'A';
+		if (c2 >= 'A' && c2 <= 'Z')
+			c2 += 'a' - 'A';
+	} while (c1 && c1 == c2);
+	return c1 - c2;
+}
+
+gchar* g_ascii_strup(const gchar* str, gssize len)
+{
+	gchar* ret;
+	gssize i;
+
+	if (len < 0)
+		len = strlen(str);
+	ret = g_strndup(str, len);
+	for (i = 0; i < len; ++i)
+		if (ret[i] >= 'a' && ret[i] <= 'z')
+			ret[i] -= 'a' - 'A';
+	return ret;
+}
+
+/* split \a string at \a delimiter into at most \a max_tokens pieces (unlimited if < 1) */
+gchar** g_strsplit(const gchar* string, const gchar* delimiter, gint max_tokens)
+{
+	GPtrArray* pieces = g_ptr_array_new();
+	gsize dlen = strlen(delimiter);
+	const gchar* next;
+
+	if (max_tokens < 1)
+		max_tokens = INT_MAX;
+	if (*string) {
+		while (--max_tokens && (next = strstr(string, delimiter))) {
+			g_ptr_array_add(pieces, g_strndup(string, next - string));
+			string = next + dlen;
+		}
+		g_ptr_array_add(pieces, g_strdup(string));
+	}
+	g_ptr_array_add(pieces, NULL);
+	return (gchar**)g_ptr_array_free(pieces, FALSE);
+}
+
+void g_strfreev(gchar** str_array)
+{
+	gchar** s;
+
+	if (!str_array)
+		return;
+	for (s = str_array; *s; ++s)
+		g_free(*s);
+	g_free(str_array);
+}
+
+/* read the whole file into a new NUL-terminated buffer */
+gboolean g_file_get_contents(const gchar* filename, gchar** contents, gsize* length, GError** error)
+{
+	GString* buf;
+	FILE* fp;
+	size_t n;
+
+	if (error)
+		*error = NULL;
+	if ((fp = fopen(filename, "rb")) == NULL)
+		return FALSE;
+	buf = g_string_new_len("", 0);
+	do {
+		if (buf->allocated_len - buf->len < 4096) {
+			buf->allocated_len = buf->allocated_len * 2 + 4096;
+			buf->str = g_realloc(buf->str, buf->allocated_len);
+		}
+		n = fread(buf->str + buf->len, 1, buf->allocated_len - buf->len - 1, fp);
+		buf->len += n;
+	} while (n > 0);
+	buf->str[buf->len] = '\0';
+	fclose(fp);
+	if (length)
+		*length = buf->len;
+	*contents = g_string_free(buf, FALSE);
+	return TRUE;
+}
+
+GString* g_string_new_len(const gchar* init, gssize len)
+{
+	GString* string = g_new0(GString, 1);
+
+	string->allocated_len = 16;
+	string->str = g_malloc(string->allocated_len);
+	string->str[0] = '\0';
+	return g_string_append_len(string, init, len < 0 ? (gssize)strlen(init) : len);
+}
+
+GString* g_string_append_len(GString* string, const gchar* val, gssize len)
+{
+	if (string->len + len + 1 > string->allocated_len) {
+		while (string->len + len + 1 > string->allocated_len)
+			string->allocated_len *= 2;
+		string->str = g_realloc(string->str, string->allocated_len);
+	}
+	memcpy(string->str + string->len, val, len);
+	string->len += len;
+	string->str[string->len] = '\0';
+	return string;
+}
+
+gchar* g_string_free(GString* string, gboolean free_segment)
+{
+	gchar* ret = free_segment ? NULL : string->str;
+
+	if (free_segment)
+		g_free(string->str);
+	g_free(string);
+	return ret;
+}
+
+GArray* g_array_new(gboolean zero_terminated, gboolean clear, guint element_size)
+{
+	GArray* array = g_new0(GArray, 1);
+
+	array->elt_size = element_size;
+	array->zero_terminated = zero_terminated;
+	array->clear = clear;
+	return array;
+}
+
+/* make room for \a length elements, and the terminator if any */
+static void array_reserve(GArray* array, guint length)
+{
+	guint want = length + (array->zero_terminated ? 1 : 0);
+
+	if (want <= array->allocated)
+		return;
+	array->allocated = MAX(want, MAX(array->allocated * 2, 16));
+	array->data = g_realloc(array->data, (gsize)array->allocated * array->elt_size);
+}
+
+static void array_terminate(GArray* array)
+{
+	if (array->zero_terminated)
+		memset(array->data + (gsize)array->len * array->elt_size, 0, array->elt_size);
+}
+
+GArray* g_array_set_size(GArray* array, guint length)
+{
+	array_reserve(array, length);
+	if (length > array->len && array->clear)
+		memset(array->data + (gsize)array->len * array->elt_size, 0,
+		    (gsize)(length - array->len) * array->elt_size);
+	array->len = length;
+	array_terminate(array);
+	return array;
+}
+
+GArray* g_array_append_vals(GArray* array, gconstpointer data, guint len)
+{
+	array_reserve(array, array->len + len);
+	memcpy(array->data + (gsize)array->len * array->elt_size, data, (gsize)len * array->elt_size);
+	array->len += len;
+	array_terminate(array);
+	return array;
+}
+
+gchar* g_array_free(GArray* array, gboolean free_segment)
+{
+	gchar* ret = free_segment ? NULL : array->data;
+
+	if (free_segment)
+		g_free(array->data);
+	g_free(array);
+	return ret;
+}
+
+GPtrArray* g_ptr_array_new(void)
+{
+	return g_new0(GPtrArray, 1);
+}
+
+void g_ptr_array_add(GPtrArray* array, gpointer data)
+{
+	if (array->len == array->allocated) {
+		array->allocated = MAX(array->allocated * 2, 16);
+		array->pdata = g_realloc(array->pdata, array->allocated * sizeof(gpointer));
+	}
+	array->pdata[array->len++] = data;
+}
+
+gpointer* g_ptr_array_free(GPtrArray* array, gboolean free_segment)
+{
+	gpointer* ret = free_segment ? NULL : array->pdata;
+
+	if (free_segment)
+		g_free(array->pdata);
+	g_free(array);
+	return ret;
+}
+
+/*
+   The hash table is one array of slots, searched linearly from the key's
+   hash. A slot's hash is EMPTY or REMOVED, or else the key's hash, kept
+   from clashing with those; so most mismatches are found without calling
+   the equal function. It grows so as to stay no more than half full.
+ */
+#define EMPTY 0
+#define REMOVED 1
+
+typedef struct
+{
+	gpointer key;
+	gpointer value;
+	guint hash;
+} hash_slot;
+
+struct _GHashTable
+{
+	GHashFunc hash_func;
+	GEqualFunc key_equal_func;
+	GDestroyNotify key_destroy_func;
+	GDestroyNotify value_destroy_func;
+	hash_slot* slots;
+	guint size;      /* a power of 2 */
+	guint nnodes;    /* keys in the table */
+	guint noccupied; /* keys and REMOVED slots */
+};
+
+/* the djb hash, as glib uses */
+guint g_str_hash(gconstpointer v)
+{
+	const guchar* p;
+	guint32 h = 5381;
+
+	for (p = v; *p; ++p)
+		h = (h << 5) + h + *p;
+	return h;
+}
+
+gboolean g_str_equal(gconstpointer v1, gconstpointer v2)
+{
+	return strcmp(v1, v2) == 0;
+}
+
+GHashTable* g_hash_table_new(GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+	return g_hash_table_new_full(hash_func, key_equal_func, NULL, NULL);
+}
+
+GHashTable* g_hash_table_new_full(GHashFunc hash_func, GEqualFunc key_equal_func,
+    GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func)
+{
+	GHashTable* table = g_new0(GHashTable, 1);
+
+	table->hash_func = hash_func;
+	table->key_equal_func = key_equal_func;
+	table->key_destroy_func = key_destroy_func;
+	table->value_destroy_func = value_destroy_func;
+	table->size = 8;
+	table->slots = g_new0(hash_slot, table->size);
+	return table;
+}
+
+static guint slot_hash(GHashTable* table, gconstpointer key)
+{
+	guint hash = table->hash_func(key);
+
+	return hash > REMOVED ? hash : hash + 2;
+}
+
+static hash_slot* find_slot(GHashTable* table, gconstpointer key, guint hash)
+{
+	guint mask = table->size - 1, i;
+
+	for (i = hash & mask; table->slots[i].hash != EMPTY; i = (i + 1) & mask)
+		if (table->slots[i].hash == hash && table->key_equal_func(table->slots[i].key, key))
+			return &table->slots[i];
+	return NULL;
+}
+
+/* rebuild the table with room for one more key, dropping the REMOVED slots */
+static void resize(GHashTable* table)
+{
+	hash_slot* old = table->slots;
+	guint oldsize = table->size, i, j;
+
+	while (table->size > 8 && (table->nnodes + 1) * 4 < table->size)
+		table->size >>= 1;
+	while ((table->nnodes + 1) * 2 > table->size)
+		table->size <<= 1;
+	table->slots = g_new0(hash_slot, table->size);
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i].hash <= REMOVED)
+			continue;
+		for (j = old[i].hash & (table->size - 1); table->slots[j].hash != EMPTY; j = (j + 1) & (table->size - 1))
+			;
+		table->slots[j] = old[i];
+	}
+	table->noccupied = table->nnodes;
+	g_free(old);
+}
+
+/*!
+    Insert \a value for \a key. If the key is already there, its value is
+    replaced, and the new key is freed with the key destroy function.
+    Returns TRUE if the key was not there before.
+ */
+gboolean g_hash_table_insert(GHashTable* hash_table, gpointer key, gpointer value)
+{
+	guint hash = slot_hash(hash_table, key), mask, i;
+	hash_slot* slot = find_slot(hash_table, key, hash);
+
+	if (slot) {
+		if (hash_table->key_destroy_func)
+			hash_table->key_destroy_func(key);
+		if (hash_table->value_destroy_func)
+			hash_table->value_destroy_func(slot->value);
+		slot->value = value;
+		return FALSE;
+	}
+	if ((hash_table->noccupied + 1) * 2 > hash_table->size)
+		resize(hash_table);
+	mask = hash_table->size - 1;
+	for (i = hash & mask; hash_table->slots[i].hash > REMOVED; i = (i + 1) & mask)
+		;
+	if (hash_table->slots[i].hash == EMPTY)
+		hash_table->noccupied++;
+	hash_table->slots[i].key = key;
+	hash_table->slots[i].value = value;
+	hash_table->slots[i].hash = hash;
+	hash_table->nnodes++;
+	return TRUE;
+}
+
+gpointer g_hash_table_lookup(GHashTable* hash_table, gconstpointer key)
+{
+	hash_slot* slot = find_slot(hash_table, key, slot_hash(hash_table, key));
+
+	return slot ? slot->value : NULL;
+}
+
+gboolean g_hash_table_remove(GHashTable* hash_table, gconstpointer key)
+{
+	hash_slot* slot = find_slot(hash_table, key, slot_hash(hash_table, key));
+
+	if (!slot)
+		return FALSE;
+	if (hash_table->key_destroy_func)
+		hash_table->key_destroy_func(slot->key);
+	if (hash_table->value_destroy_func)
+		hash_table->value_destroy_func(slot->value);
+	slot->key = slot->value = NULL;
+	slot->hash = REMOVED;
+	hash_table->nnodes--;
+	return TRUE;
+}
+
+guint g_hash_table_size(GHashTable* hash_table)
+{
+	return hash_table->nnodes;
+}
+
+void g_hash_table_foreach(GHashTable* hash_table, GHFunc func, gpointer user_data)
+{
+	guint i;
+
+	for (i = 0; i < hash_table->size; ++i)
+		if (hash_table->slots[i].hash > REMOVED)
+			func(hash_table->slots[i].key, hash_table->slots[i].value, user_data);
+}
+
+void g_hash_table_destroy(GHashTable* hash_table)
+{
+	guint i;
+
+	if (!hash_table)
+		return;
+	for (i = 0; i < hash_table->size; ++i) {
+		if (hash_table->slots[i].hash <= REMOVED)
+			continue;
+		if (hash_table->key_destroy_func)
+			hash_table->key_destroy_func(hash_table->slots[i].key);
+		if (hash_table->value_destroy_func)
+			hash_table->value_destroy_func(hash_table->slots[i].value);
+	}
+	g_free(hash_table->slots);
+	g_free(hash_table);
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * miniglib.h - the little of glib that clu uses, for building without it
+ *
+ * With make NO_GLIB=1, CLU_NO_GLIB is defined and this is included instead
+ * of <glib.h>. Only what clu needs is here, with the same names and
+ * behaviour as in glib, so the rest of the code doesn't know the difference;
+ * but the containers are simpler: GHashTable is open addressing in one
+ * array, and GArray and GString are just growable buffers.
+ */
+#ifndef MINIGLIB_H
+#define MINIGLIB_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef char gchar;
+typedef unsigned char guchar;
+typedef int gint;
+typedef unsigned int guint;
+typedef int gboolean;
+typedef size_t gsize;
+typedef ssize_t gssize;
+typedef int8_t gint8;
+typedef uint8_t guint8;
+typedef int16_t gint16;
+typedef uint16_t guint16;
+typedef int32_t gint32;
+typedef uint32_t guint32;
+typedef int64_t gint64;
+typedef uint64_t guint64;
+typedef void* gpointer;
+typedef const void* gconstpointer;
+
+#define TRUE 1
+#define FALSE 0
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#define G_N_ELEMENTS(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define GPOINTER_TO_INT(p) ((gint)(intptr_t)(p))
+#define GPOINTER_TO_UINT(p) ((guint)(uintptr_t)(p))
+#define GINT_TO_POINTER(i) ((gpointer)(intptr_t)(i))
+#define GUINT_TO_POINTER(u) ((gpointer)(uintptr_t)(u))
+
+typedef guint (*GHashFunc)(gconstpointer key);
+typedef gboolean (*GEqualFunc)(gconstpointer a, gconstpointer b);
+typedef void (*GDestroyNotify)(gpointer data);
+typedef void (*GHFunc)(gpointer key, gpointer value, gpointer user_data);
+
+/* memory: like glib, running out of it aborts */
+gpointer g_malloc(gsize size);
+gpointer g_malloc0(gsize size);
+gpointer g_realloc(gpointer mem, gsize size);
+#define g_free free
+#define g_new(type, n) ((type*)g_malloc(sizeof(type) * (n)))
+#define g_new0(type, n) ((type*)g_malloc0(sizeof(type) * (n)))
+
+/* strings */
+#define g_fopen fopen
+gchar* g_strdup(const gchar* str);
+gchar* g_strndup(const gchar* str, gsize n);
+gsize g_strlcpy(gchar* dest, const gchar* src, gsize dest_size);
+gint g_ascii_strcasecmp(const gchar* s1, const gchar* s2);
+gchar* g_ascii_strup(const gchar* str, gssize len);
+gchar** g_strsplit(const gchar* string, const gchar* delimiter, gint max_tokens);
+void g_strfreev(gchar** str_array);
+typedef struct _GError GError; /* never set */
+gboolean g_file_get_contents(const gchar* filename, gchar** contents, gsize* length, GError** error);
+
+typedef struct
+{
+	gchar* str;
+	gsize len;
+	gsize allocated_len;
+} GString;
+
+GString* g_string_new_len(const gchar* init, gssize len);
+GString* g_string_append_len(GString* string, const gchar* val, gssize len);
+gchar* g_string_free(GString* string, gboolean free_segment);
+
+typedef struct
+{
+	gchar* data;
+	guint len;
+	/* private */
+	guint elt_size, allocated;
+	gboolean zero_terminated, clear;
+} GArray;
+
+GArray* g_array_new(gboolean zero_terminated, gboolean clear, guint element_size);
+GArray* g_array_set_size(GArray* array, guint length);
+GArray* g_array_append_vals(GArray* array, gconstpointer data, guint len);
+gchar* g_array_free(GArray* array, gboolean free_segment);
+#define g_array_append_val(a, v) g_array_append_vals(a, &(v), 1)
+#define g_array_index(a, t, i) (((t*)(void*)(a)->data)[(i)])
+
+typedef struct
+{
+	gpointer* pdata;
+	guint len;
+	guint allocated; /* private */
+} GPtrArray;
+
+GPtrArray* g_ptr_array_new(void);
+void g_ptr_array_add(GPtrArray* array, gpointer data);
+gpointer* g_ptr_array_free(GPtrArray* array, gboolean free_segment);
+#define g_ptr_array_index(array, i) ((array)->pdata[(i)])
+
+typedef struct _GHashTable GHashTable;
+
+guint g_str_hash(gconstpointer v);
+gboolean g_str_equal(gconstpointer v1, gconstpointer v2);
+GHashTable* g_hash_table_new(GHashFunc hash_func, GEqualFunc key_equal_func);
+GHashTable* g_hash_table_new_full(GHashFunc hash_func, GEqualFunc key_equal_func,
+    GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func);
+gboolean g_hash_table_insert(GHashTable* hash_table, gpointer key, gpointer value);
+gpointer g_hash_table_lookup(GHashTable* hash_table, gconstpointer key);
+gboolean g_hash_table_remove(GHashTable* hash_table, gconstpointer key);
+guint g_hash_table_size(GHashTable* hash_table);
+void g_hash_table_foreach(GHashTable* hash_table, GHFunc func, gpointer user_data);
+void g_hash_table_destroy(GHashTable* hash_table);
+
+#endif /* MINIGLIB_H */
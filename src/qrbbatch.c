@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrbbatch.c - qrb() for whole arrays of coordinates at once
+ *
+ * The arithmetic is in qrblanes.h, on as many doubles at once as the
+ * target's SIMD registers hold. On x86-64, unless the library is compiled
+ * for AVX already, it's compiled a second time, for AVX2, in
+ * qrbbatch_avx2.c, and qrb_batch() and qrb_from_home_float() use that
+ * where the CPU has AVX2: 4 lanes instead of SSE2's 2.
+ *
+ * The formula differs from qrb(): the arc comes from
+ * atan2(|cross|, dot), rather than acos(dot), which is more accurate for
+ * short distances, and the azimuth from atan2 of the same two terms.
+ *
+ * When the first point is always our own location, a qrb_home keeps its
+ * sine and cosine, for qrb_from_home(), which is otherwise qrb(), and for
+ * qrb_from_home_float(), which does the same in single precision with
+ * twice as many lanes.
+ */
+
+#include "qrbbatch.h"
+
+#define KERNEL(name) name##_default
+#include "qrblanes.h"
+
+/*!
+    Compute qrb() for \a count pairs of points, given as separate arrays of
+    longitudes and latitudes: from (\a lon1[i], \a lat1[i]) to (\a lon2[i],
+    \a lat2[i]), into \a distance[i] (km) and \a azimuth[i] (degrees,
+    rounded to the nearest whole degree, as by qrb()). For a pair out of
+    range, both are NaN. Returns the number of pairs out of range.
+
+    Compared with qrb(), on the same inputs: the distance differs by less
+    than 1 m (less than 0.1 m, except below about 100 m, where qrb()'s acos
+    loses precision); the azimuth is the same, except that when the exact
+    azimuth is within about 1e-9 degree of a half degree, it may round the
+    other way. Where qrb() decides that two points coincide or are
+    antipodal, so does this, except within a similar margin of its
+    thresholds.
+ */
+int qrb_batch(const double* lon1, const double* lat1, const double* lon2, const double* lat2,
+    double* distance, double* azimuth, size_t count)
+{
+#ifdef QRB_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return qrb_batch_avx2(lon1, lat1, lon2, lat2, distance, azimuth, count);
+#endif
+	return qrb_batch_default(lon1, lat1, lon2, lat2, distance, azimuth, count);
+}
+
+/*!
+    Set up \a home for qrb_from_home() and qrb_from_home_float(), at
+    \a longitude and \a latitude in degrees. Returns 0, or -RIG_EINVAL if
+    either is out of range, as qrb() would.
+ */
+int qrb_home_init(qrb_home* home, double longitude, double latitude)
+{
+	if (!home || !(latitude >= -90.0 && latitude <= 90.0) || !(longitude >= -180.0 && longitude <= 180.0))
+		return -RIG_EINVAL;
+	home->longitude = longitude;
+	home->latitude = latitude;
+	latitude = fmin(fmax(latitude, -MAX_LAT), MAX_LAT);
+	home->lon_rad = longitude / RADIAN;
+	home->sin_lat = sin(latitude / RADIAN);
+	home->cos_lat = cos(latitude / RADIAN);
+	return RIG_OK;
+}
+
+/*!
+    qrb() from \a home to \a longitude, \a latitude, with the same result
+    (unless the compiler contracts one of them to FMA and not the other),
+    but without range-checking the home location or computing its sine and
+    cosine again.
+ */
+int qrb_from_home(const qrb_home* home, double longitude, double latitude, double* distance, double* azimuth)
+{
+	double lat2, delta_long, slat2, clat2, cdlon, tmp, az;
+
+	if (!home || !distance || !azimuth)
+		return -RIG_EINVAL;
+	if (latitude > 90.0 || latitude < -90.0 || longitude > 180.0 || longitude < -180.0)
+		return -RIG_EINVAL;
+
+	lat2 = fmin(fmax(latitude, -MAX_LAT), MAX_LAT) / RADIAN;
+	delta_long = longitude / RADIAN - home->lon_rad;
+	slat2 = sin(lat2);
+	clat2 = cos(lat2);
+	cdlon = cos(delta_long);
+	tmp = home->sin_lat * slat2 + home->cos_lat * clat2 * cdlon;
+	if (tmp > .999999999999999) {
+		*distance = 0.0;
+		*azimuth = 0.0;
+		return RIG_OK;
+	}
+	if (tmp < -.999999) {
+		*distance = 180.0 * ARC_IN_KM;
+		*azimuth = 0.0;
+		return RIG_OK;
+	}
+	*distance = ARC_IN_KM * RADIAN * acos(tmp);
+
+	az = RADIAN * atan2(sin(delta_long) * clat2, home->cos_lat * slat2 - home->sin_lat * clat2 * cdlon);
+	az = fmod(360.0 + az, 360.0);
+	if (az < 0.0)
+		az += 360.0;
+	else if (az >= 360.0)
+		az -= 360.0;
+	*azimuth = floor(az + 0.5);
+	return RIG_OK;
+}
+
+/*!
+    Compute qrb() in single precision from \a home to each of \a count
+    points, (\a longitude[i], \a latitude[i]), into \a distance[i] and
+    \a azimuth[i], rounded to whole degrees as by qrb(). For a point out of
+    range, both are NaN. Returns the number of points out of range.
+
+    Compared with qrb(): the distance differs by less than 5 m. The
+    azimuth is the same, except where it may round the other way: within
+    about 1e-3 degree of a half degree (about 1 point in 2000), or, closer
+    than 100 km to home or to its antipode, within 0.1 degree divided by
+    that distance in km, since the resolution of a float, about half a
+    metre, is too coarse for the direction there. Less than 1 km from home
+    and at the poles it may be anything. Points less than about 1.5 m from
+    home are taken to coincide with it (by qrb(), 0.3 m), with distance and
+    azimuth 0.
+ */
+int qrb_from_home_float(const qrb_home* home, const float* longitude, const float* latitude,
+    float* distance, float* azimuth, size_t count)
+{
+	if (!home)
+		return -RIG_EINVAL;
+#ifdef QRB_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return qrb_from_home_float_avx2(home, longitude, latitude, distance, azimuth, count);
+#endif
+	return qrb_from_home_float_default(home, longitude, latitude, distance, azimuth, count);
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrbbatch.h - what qrbbatch.c and qrbbatch_avx2.c share
+ */
+#ifndef QRBBATCH_H
+#define QRBBATCH_H
+
+#include <stddef.h>
+
+#include "clu.h"
+
+/* the kernels for the target the library is compiled for */
+int qrb_batch_default(const double* lon1, const double* lat1, const double* lon2, const double* lat2,
+    double* distance, double* azimuth, size_t count);
+int qrb_from_home_float_default(const qrb_home* home, const float* longitude, const float* latitude,
+    float* distance, float* azimuth, size_t count);
+
+/*
+   On x86-64, unless the library is compiled for AVX already, the batch
+   functions are compiled a second time for AVX2, and chosen at run time.
+   (That takes #pragma GCC target, which clang doesn't have.)
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && !defined(__AVX__)
+#define QRB_AVX2
+
+int qrb_batch_avx2(const double* lon1, const double* lat1, const double* lon2, const double* lat2,
+    double* distance, double* azimuth, size_t count);
+int qrb_from_home_float_avx2(const qrb_home* home, const float* longitude, const float* latitude,
+    float* distance, float* azimuth, size_t count);
+#endif
+
+#endif /* QRBBATCH_H */
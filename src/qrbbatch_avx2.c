@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrbbatch_avx2.c - qrblanes.h again, compiled for AVX2
+ *
+ * qrb_batch() and qrb_from_home_float() call these instead of their own
+ * copies when the CPU has AVX2, so a library built for plain x86-64 still
+ * works on 4 doubles (or 8 floats) at a time. Only the functions here are
+ * compiled for AVX2, so nothing else can use it by accident on a CPU
+ * without it. FMA is left out, so the results are the same either way.
+ */
+
+#include "qrbbatch.h"
+
+#ifdef QRB_AVX2
+#pragma GCC target("avx2")
+#define KERNEL(name) name##_avx2
+#include "qrblanes.h"
+#endif
@@ -0,0 +1,436 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrblanes.h - the vector arithmetic behind qrbbatch.c
+ *
+ * The arithmetic is done on vectors of doubles with GCC's vector
+ * extensions, so the compiler uses whatever SIMD the target has: SSE2 by
+ * default on x86-64 (2 lanes), AVX2 (4 lanes), NEON on aarch64 (2 lanes).
+ * Instead of libm, sin and cos come from the Cephes polynomials, and atan
+ * from a polynomial fit, with no branches, so that every lane takes the
+ * same path.
+ *
+ * This is included once in qrbbatch.c, for the target the library is
+ * compiled for, and once more in qrbbatch_avx2.c, compiled for AVX2, so
+ * the vectors are as wide as the CPU it runs on allows. Each defines
+ * KERNEL(name) first, to give the two functions here their names there.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "clu.h"
+#include "locator.h"
+
+/* as many doubles as the target's SIMD registers hold */
+#ifdef __AVX__
+#define LANES 4
+#else
+#define LANES 2
+#endif
+
+/* the vectors are only passed between static inline functions here */
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef double vdouble __attribute__((vector_size(LANES * sizeof(double))));
+typedef long long vlong __attribute__((vector_size(LANES * sizeof(long long))));
+
+#define RADIAN (180.0 / M_PI)
+#define ARC_IN_KM 111.2 /* as in locator.c */
+#define MAX_LAT 89.999999999 /* qrb() moves the poles here */
+
+#define SIGN_BIT (-0x7fffffffffffffffLL - 1)
+
+/* x in every lane */
+#define SPLAT(x) ((vdouble){ 0 } + (x))
+
+static inline vdouble vselect(vlong mask, vdouble a, vdouble b)
+{
+	return (vdouble)((vlong)b ^ (((vlong)a ^ (vlong)b) & mask));
+}
+
+static inline vdouble vabs(vdouble x)
+{
+	return (vdouble)((vlong)x & ~SIGN_BIT);
+}
+
+static inline vdouble vmin(vdouble a, vdouble b)
+{
+	return vselect(a < b, a, b);
+}
+
+static inline vdouble vmax(vdouble a, vdouble b)
+{
+	return vselect(a > b, a, b);
+}
+
+/* there's no generic vector sqrt, so use the target's */
+static inline vdouble vsqrt(vdouble x)
+{
+#if defined(__AVX__)
+	return (vdouble)_mm256_sqrt_pd((__m256d)x);
+#elif defined(__SSE2__)
+	return (vdouble)_mm_sqrt_pd((__m128d)x);
+#elif defined(__aarch64__)
+	return (vdouble)vsqrtq_f64((float64x2_t)x);
+#else
+	for (int i = 0; i < LANES; ++i)
+		x[i] = sqrt(x[i]);
+	return x;
+#endif
+}
+
+/* adding this rounds a double below 2^51 to an integer, which is then in its low bits */
+#define ROUNDER 0x1.8p52
+
+/* sine and cosine of x, for |x| up to a few thousand */
+static inline void vsincos(vdouble x, vdouble* s, vdouble* c)
+{
+	const vdouble DP1 = SPLAT(2 * 7.85398125648498535156E-1);
+	const vdouble DP2 = SPLAT(2 * 3.77489470793079817668E-8);
+	const vdouble DP3 = SPLAT(2 * 2.69515142907905952645E-15);
+	vdouble ax = vabs(x), k, z, zz, ps, pc;
+	vlong quadrant, swap;
+
+	/* reduce to [-pi/4, pi/4] around the nearest multiple k of pi/2 */
+	k = ax * M_2_PI + ROUNDER;
+	quadrant = (vlong)k;
+	k -= ROUNDER;
+	z = ((ax - k * DP1) - k * DP2) - k * DP3;
+	zz = z * z;
+
+	ps = SPLAT(1.58962301576546568060E-10);
+	ps = ps * zz - 2.50507477628578072866E-8;
+	ps = ps * zz + 2.75573136213857245213E-6;
+	ps = ps * zz - 1.98412698295895385996E-4;
+	ps = ps * zz + 8.33333333332211858878E-3;
+	ps = ps * zz - 1.66666666666666307295E-1;
+	ps = z + z * zz * ps;
+
+	pc = SPLAT(-1.13585365213876817300E-11);
+	pc = pc * zz + 2.08757008419747316778E-9;
+	pc = pc * zz - 2.75573141792967388112E-7;
+	pc = pc * zz + 2.48015872888517045348E-5;
+	pc = pc * zz - 1.38888888888730564116E-3;
+	pc = pc * zz + 4.16666666666665929218E-2;
+	pc = 1.0 - 0.5 * zz + zz * zz * pc;
+
+	/* in odd quadrants sin and cos trade places; then the signs are from bit 1 */
+	swap = (vdouble)((quadrant & 1) | (vlong)SPLAT(1)) > 1; /* without 64-bit integer compares */
+	*s = vselect(swap, pc, ps);
+	*c = vselect(swap, ps, pc);
+	*s = (vdouble)((vlong)*s ^ ((quadrant << 62) & SIGN_BIT) ^ ((vlong)x & SIGN_BIT));
+	*c = (vdouble)((vlong)*c ^ (((quadrant + 1) << 62) & SIGN_BIT));
+}
+
+/* atan2(y, x) in [-pi, pi] */
+static inline vdouble vatan2(vdouble y, vdouble x)
+{
+	vdouble ax = vabs(x), ay = vabs(y), mx, mn, t, z, p, r;
+	vlong big;
+
+	/* atan of t = min / max in [0, 1]; above tan(pi/8), as pi/4 + atan((t - 1) / (t + 1)) */
+	mx = vmax(ax, ay);
+	mn = vmin(ax, ay);
+	big = mn > 0.41421356237309503 * mx;
+	t = vselect(big, mn - mx, mn) / vselect(big, mn + mx, vselect(mx == 0, SPLAT(1), mx));
+	z = t * t;
+
+	/* a Chebyshev fit of atan on [-tan(pi/8), tan(pi/8)], good to 1 ulp */
+	p = SPLAT(2.11362001797983264e-02);
+	p = p * z - 4.34811354837353891e-02;
+	p = p * z + 5.68836845993835433e-02;
+	p = p * z - 6.64023730809807857e-02;
+	p = p * z + 7.68995387126955122e-02;
+	p = p * z - 9.09077310311926652e-02;
+	p = p * z + 1.11111061819408845e-01;
+	p = p * z - 1.42857141810267360e-01;
+	p = p * z + 1.99999999988560190e-01;
+	p = p * z - 3.33333333333284452e-01;
+	r = t + t * z * p;
+	r += vselect(big, SPLAT(M_PI_4), SPLAT(0));
+
+	/* then to the right octant and quadrant */
+	r = vselect(ay > ax, M_PI_2 - r, r);
+	r = vselect(x < 0, M_PI - r, r);
+	return (vdouble)((vlong)r ^ ((vlong)y & SIGN_BIT));
+}
+
+/* qrb() on LANES pairs; returns a mask of the pairs out of range */
+static inline vlong qrb_lanes(vdouble lon1, vdouble lat1, vdouble lon2, vdouble lat2,
+    vdouble* distance, vdouble* azimuth)
+{
+	vdouble slat1, clat1, slat2, clat2, sdlon, cdlon, x, y, dot, arc, az, rounded;
+	vlong bad, same, opposite;
+
+	bad = (vabs(lat1) > 90.0) | (vabs(lat2) > 90.0) | (vabs(lon1) > 180.0) | (vabs(lon2) > 180.0)
+	    | (lat1 != lat1) | (lat2 != lat2) | (lon1 != lon1) | (lon2 != lon2);
+	lat1 = vmax(vmin(lat1, SPLAT(MAX_LAT)), SPLAT(-MAX_LAT));
+	lat2 = vmax(vmin(lat2, SPLAT(MAX_LAT)), SPLAT(-MAX_LAT));
+
+	vsincos(lat1 * (1 / RADIAN), &slat1, &clat1);
+	vsincos(lat2 * (1 / RADIAN), &slat2, &clat2);
+	vsincos((lon2 - lon1) * (1 / RADIAN), &sdlon, &cdlon);
+
+	/* components of the direction to point 2, east and north of point 1 */
+	x = sdlon * clat2;
+	y = clat1 * slat2 - slat1 * clat2 * cdlon;
+	dot = slat1 * slat2 + clat1 * clat2 * cdlon;
+
+	arc = vatan2(vsqrt(x * x + y * y), dot);
+	az = vatan2(x, y) * RADIAN;
+	az = vselect(az < 0, az + 360.0, az);
+	/* round to whole degrees as qrb() does, with floor(az + 0.5) */
+	az += 0.5;
+	rounded = (az + ROUNDER) - ROUNDER;
+	az = vselect(rounded > az, rounded - 1, rounded);
+
+	/* the special cases of qrb(): the same point, and antipodes */
+	same = dot > .999999999999999;
+	opposite = dot < -.999999;
+	*distance = vselect(opposite, SPLAT(180.0 * ARC_IN_KM), ARC_IN_KM * RADIAN * arc);
+	*distance = (vdouble)((vlong)*distance & ~same);
+	*azimuth = (vdouble)((vlong)az & ~(same | opposite));
+	/* NaN where out of range */
+	*distance += (vdouble)(bad & (vlong)SPLAT(NAN));
+	*azimuth += (vdouble)(bad & (vlong)SPLAT(NAN));
+	return bad;
+}
+
+/* copy the \a n (< LANES) items at \a p into a vector, the rest zero */
+static inline vdouble load_partial(const double* p, size_t n)
+{
+	vdouble v = { 0 };
+
+	memcpy(&v, p, n * sizeof(double));
+	return v;
+}
+
+/* qrb_batch(), LANES pairs at a time */
+int KERNEL(qrb_batch)(const double* lon1, const double* lat1, const double* lon2, const double* lat2,
+    double* distance, double* azimuth, size_t count)
+{
+	vdouble vlon1, vlat1, vlon2, vlat2, d, a;
+	vlong bad, nbad = { 0 };
+	size_t i, n;
+	int ret = 0;
+
+	for (i = 0; i < count; i += LANES) {
+		n = count - i < LANES ? count - i : LANES;
+		if (n == LANES) {
+			memcpy(&vlon1, lon1 + i, sizeof(vdouble));
+			memcpy(&vlat1, lat1 + i, sizeof(vdouble));
+			memcpy(&vlon2, lon2 + i, sizeof(vdouble));
+			memcpy(&vlat2, lat2 + i, sizeof(vdouble));
+		} else {
+			vlon1 = load_partial(lon1 + i, n);
+			vlat1 = load_partial(lat1 + i, n);
+			vlon2 = load_partial(lon2 + i, n);
+			vlat2 = load_partial(lat2 + i, n);
+		}
+		bad = qrb_lanes(vlon1, vlat1, vlon2, vlat2, &d, &a);
+		nbad -= bad;
+		memcpy(distance + i, &d, n * sizeof(double));
+		memcpy(azimuth + i, &a, n * sizeof(double));
+	}
+	for (i = 0; i < LANES; ++i)
+		ret += nbad[i];
+	return ret;
+}
+
+/* the same again in single precision, with twice as many lanes */
+#define FLANES (2 * LANES)
+
+typedef float vfloat __attribute__((vector_size(FLANES * sizeof(float))));
+typedef int vint __attribute__((vector_size(FLANES * sizeof(int))));
+
+#define SIGN_BIT_F (-0x7fffffff - 1)
+#define SPLATF(x) ((vfloat){ 0 } + (x))
+#define ROUNDER_F 0x1.8p23f
+
+static inline vfloat vselectf(vint mask, vfloat a, vfloat b)
+{
+	return (vfloat)((vint)b ^ (((vint)a ^ (vint)b) & mask));
+}
+
+static inline vfloat vabsf(vfloat x)
+{
+	return (vfloat)((vint)x & ~SIGN_BIT_F);
+}
+
+static inline vfloat vminf(vfloat a, vfloat b)
+{
+	return vselectf(a < b, a, b);
+}
+
+static inline vfloat vmaxf(vfloat a, vfloat b)
+{
+	return vselectf(a > b, a, b);
+}
+
+static inline vfloat vsqrtf(vfloat x)
+{
+#if defined(__AVX__)
+	return (vfloat)_mm256_sqrt_ps((__m256)x);
+#elif defined(__SSE2__)
+	return (vfloat)_mm_sqrt_ps((__m128)x);
+#elif defined(__aarch64__)
+	return (vfloat)vsqrtq_f32((float32x4_t)x);
+#else
+	for (int i = 0; i < FLANES; ++i)
+		x[i] = sqrtf(x[i]);
+	return x;
+#endif
+}
+
+/* vsincos() with the Cephes sinf and cosf polynomials, for |x| up to about 2 pi */
+static inline void vsincosf(vfloat x, vfloat* s, vfloat* c)
+{
+	const vfloat DP1 = SPLATF(2 * 0.78515625f);
+	const vfloat DP2 = SPLATF(2 * 2.4187564849853515625e-4f);
+	const vfloat DP3 = SPLATF(2 * 3.77489497744594108e-8f);
+	vfloat ax = vabsf(x), k, z, zz, ps, pc;
+	vint quadrant, swap;
+
+	k = ax * (float)M_2_PI + ROUNDER_F;
+	quadrant = (vint)k;
+	k -= ROUNDER_F;
+	z = ((ax - k * DP1) - k * DP2) - k * DP3;
+	zz = z * z;
+
+	ps = SPLATF(-1.9515295891e-4f);
+	ps = ps * zz + 8.3321608736e-3f;
+	ps = ps * zz - 1.6666654611e-1f;
+	ps = z + z * zz * ps;
+
+	pc = SPLATF(2.443315711809948e-5f);
+	pc = pc * zz - 1.388731625493765e-3f;
+	pc = pc * zz + 4.166664568298827e-2f;
+	pc = 1.0f - 0.5f * zz + zz * zz * pc;
+
+	swap = (quadrant & 1) != 0;
+	*s = vselectf(swap, pc, ps);
+	*c = vselectf(swap, ps, pc);
+	*s = (vfloat)((vint)*s ^ ((quadrant << 30) & SIGN_BIT_F) ^ ((vint)x & SIGN_BIT_F));
+	*c = (vfloat)((vint)*c ^ (((quadrant + 1) << 30) & SIGN_BIT_F));
+}
+
+/* vatan2() with the Cephes atanf polynomial */
+static inline vfloat vatan2f(vfloat y, vfloat x)
+{
+	vfloat ax = vabsf(x), ay = vabsf(y), mx, mn, t, z, p, r;
+	vint big;
+
+	mx = vmaxf(ax, ay);
+	mn = vminf(ax, ay);
+	big = mn > 0.414213562f * mx;
+	t = vselectf(big, mn - mx, mn) / vselectf(big, mn + mx, vselectf(mx == 0, SPLATF(1), mx));
+	z = t * t;
+
+	p = SPLATF(8.05374449538e-2f);
+	p = p * z - 1.38776856032e-1f;
+	p = p * z + 1.99777106478e-1f;
+	p = p * z - 3.33329491539e-1f;
+	r = t + t * z * p;
+	r += vselectf(big, SPLATF((float)M_PI_4), SPLATF(0));
+
+	r = vselectf(ay > ax, (float)M_PI_2 - r, r);
+	r = vselectf(x < 0, (float)M_PI - r, r);
+	return (vfloat)((vint)r ^ ((vint)y & SIGN_BIT_F));
+}
+
+/* qrb_from_home() on FLANES points; returns a mask of the points out of range */
+static inline vint qrb_home_lanes(vfloat home_lon, vfloat home_lon_lo, vfloat home_sin, vfloat home_cos,
+    vfloat lon, vfloat lat, vfloat* distance, vfloat* azimuth)
+{
+	vfloat slat, clat, dlon, t, err, sdlon, cdlon, x, y, dot, cross, az, rounded;
+	vint bad, same, opposite;
+
+	bad = (vabsf(lat) > 90.0f) | (vabsf(lon) > 180.0f) | (lat != lat) | (lon != lon);
+
+	vsincosf(lat * (float)(1 / RADIAN), &slat, &clat);
+	/*
+	 * The difference in longitude to within a float of the true one, even
+	 * across the 180th meridian: keep what rounding the subtraction loses
+	 * (as in Knuth's two-sum), bring it within +-180 (exactly, as it's
+	 * within a factor of 2 of 360), then take off the error in home_lon.
+	 */
+	dlon = lon - home_lon;
+	t = dlon - lon;
+	err = (lon - (dlon - t)) - (home_lon + t);
+	dlon = vselectf(dlon > 180.0f, dlon - 360.0f, vselectf(dlon < -180.0f, dlon + 360.0f, dlon));
+	dlon += err - home_lon_lo;
+	vsincosf(dlon * (float)(1 / RADIAN), &sdlon, &cdlon);
+
+	x = sdlon * clat;
+	y = home_cos * slat - home_sin * clat * cdlon;
+	dot = home_sin * slat + home_cos * clat * cdlon;
+	cross = vsqrtf(x * x + y * y);
+
+	az = vatan2f(x, y) * (float)RADIAN;
+	az = vselectf(az < 0, az + 360.0f, az);
+	az += 0.5f;
+	rounded = (az + ROUNDER_F) - ROUNDER_F;
+	az = vselectf(rounded > az, rounded - 1, rounded);
+
+	/* dot is too coarse here to find the special cases, so use the cross product */
+	same = (cross < 2.4e-7f) & (dot > 0);
+	opposite = (cross < 1.414e-3f) & (dot < 0);
+	*distance = vselectf(opposite, SPLATF((float)(180.0 * ARC_IN_KM)),
+	    (float)(ARC_IN_KM * RADIAN) * vatan2f(cross, dot));
+	*distance = (vfloat)((vint)*distance & ~same);
+	*azimuth = (vfloat)((vint)az & ~(same | opposite));
+	*distance += (vfloat)(bad & (vint)SPLATF(NAN));
+	*azimuth += (vfloat)(bad & (vint)SPLATF(NAN));
+	return bad;
+}
+
+static inline vfloat load_partialf(const float* p, size_t n)
+{
+	vfloat v = { 0 };
+
+	memcpy(&v, p, n * sizeof(float));
+	return v;
+}
+
+/* qrb_from_home_float(), FLANES points at a time */
+int KERNEL(qrb_from_home_float)(const qrb_home* home, const float* longitude, const float* latitude,
+    float* distance, float* azimuth, size_t count)
+{
+	vfloat home_lon, home_lon_lo, home_sin, home_cos, lon, lat, d, a;
+	vint nbad = { 0 };
+	size_t i, n;
+	int ret = 0;
+
+	home_lon = SPLATF((float)home->longitude);
+	home_lon_lo = SPLATF((float)(home->longitude - (float)home->longitude));
+	home_sin = SPLATF((float)home->sin_lat);
+	home_cos = SPLATF((float)home->cos_lat);
+	for (i = 0; i < count; i += FLANES) {
+		n = count - i < FLANES ? count - i : FLANES;
+		if (n == FLANES) {
+			memcpy(&lon, longitude + i, sizeof(vfloat));
+			memcpy(&lat, latitude + i, sizeof(vfloat));
+		} else {
+			lon = load_partialf(longitude + i, n);
+			lat = load_partialf(latitude + i, n);
+		}
+		nbad -= qrb_home_lanes(home_lon, home_lon_lo, home_sin, home_cos, lon, lat, &d, &a);
+		memcpy(distance + i, &d, n * sizeof(float));
+		memcpy(azimuth + i, &a, n * sizeof(float));
+	}
+	for (i = 0; i < FLANES; ++i)
+		ret += nbad[i];
+	return ret;
+}
+
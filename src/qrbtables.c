@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrbtables.c - distance and azimuth from home to everywhere, in advance
+ *
+ * Most stations we hear send a 4-character grid, or nothing but a callsign,
+ * for which the best we have is the entity's location from cty.dat. There
+ * are only 18 * 18 * 10 * 10 = 32400 such grids and a few hundred entities,
+ * so with a fixed home it's cheaper to compute the paths to all of them once
+ * than to call locator2longlat() and qrb() for each station heard. The
+ * tables are built again only when the home locator, or the loaded
+ * entities, change.
+ */
+
+#include <string.h>
+
+#include "dxcc.h"
+#include "locator.h"
+
+#define GRID_SQUARES 180 /* each way: 18 fields of 10 squares */
+#define GRID_COUNT (GRID_SQUARES * GRID_SQUARES)
+#define MAX_HOME_LOCATOR 12 /* as much as locator2longlat() takes */
+
+struct qrb_tables
+{
+	char home[MAX_HOME_LOCATOR + 1]; /* what the tables were built for */
+	uint serial;      /* of the context the entities came from */
+	qrb_path* entities;
+	int nentities;
+	qrb_path grids[GRID_COUNT]; /* by longitude square, then latitude square */
+};
+
+qrb_tables* qrb_tables_new(void)
+{
+	return g_new0(qrb_tables, 1);
+}
+
+void qrb_tables_free(qrb_tables* tables)
+{
+	if (!tables)
+		return;
+	g_free(tables->entities);
+	g_free(tables);
+}
+
+static void set_path(qrb_path* path, const qrb_home* home, double longitude, double latitude)
+{
+	double distance = 0, azimuth = 0;
+
+	qrb_from_home(home, longitude, latitude, &distance, &azimuth);
+	path->distance = distance;
+	path->azimuth = azimuth;
+	path->long_distance = distance_long_path(distance);
+	path->long_azimuth = azimuth_long_path(azimuth);
+}
+
+static void build_grids(qrb_tables* tables, const qrb_home* home)
+{
+	char grid[5] = { 0 };
+	double longitude, latitude;
+
+	for (int x = 0; x < GRID_SQUARES; ++x) {
+		for (int y = 0; y < GRID_SQUARES; ++y) {
+			grid[0] = 'A' + x / 10;
+			grid[1] = 'A' + y / 10;
+			grid[2] = '0' + x % 10;
+			grid[3] = '0' + y % 10;
+			/* the same centre that a lookup of the grid would have */
+			locator2longlat(&longitude, &latitude, grid);
+			set_path(&tables->grids[x * GRID_SQUARES + y], home, longitude, latitude);
+		}
+	}
+}
+
+static void build_entities(qrb_tables* tables, const qrb_home* home, const dxcc_context* ctx)
+{
+	dxcc_data entity;
+
+	g_free(tables->entities);
+	tables->nentities = dxcc_context_entities(ctx);
+	tables->entities = g_new0(qrb_path, tables->nentities ? tables->nentities : 1);
+	for (int i = 0; i < tables->nentities; ++i)
+		if (dxcc_entity(ctx, i, &entity))
+			set_path(&tables->entities[i], home, entity.longitude, entity.latitude);
+	tables->serial = dxcc_context_serial(ctx);
+}
+
+/*!
+    Make \a tables hold the paths from the centre of \a locator to every
+    4-character grid and to every entity of \a ctx (which may be NULL for
+    none). Only what has changed since the last call is built again: the
+    grids if \a locator is different, and the entities then or if \a ctx
+    is another context (by dxcc_context_serial(), so even one at the same
+    address as a freed one counts); so call it again with the new context
+    after reloading cty.dat.
+    Returns 1 if anything was built, 0 if not, or -RIG_EINVAL if \a locator
+    is not a grid, leaving \a tables as they were.
+
+    Building takes a few milliseconds. Don't look anything up in
+    \a tables from other threads meanwhile.
+ */
+int qrb_tables_set_home(qrb_tables* tables, const char* locator, const dxcc_context* ctx)
+{
+	double longitude, latitude;
+	qrb_home home;
+	bool moved;
+
+	if (!tables || !locator || strlen(locator) > MAX_HOME_LOCATOR)
+		return -RIG_EINVAL;
+	moved = g_ascii_strcasecmp(locator, tables->home) != 0;
+	if (!moved && dxcc_context_serial(ctx) == tables->serial)
+		return 0;
+	if (locator2longlat(&longitude, &latitude, locator) != RIG_OK
+	    || qrb_home_init(&home, longitude, latitude) != RIG_OK)
+		return -RIG_EINVAL;
+
+	if (moved) {
+		build_grids(tables, &home);
+		g_strlcpy(tables->home, locator, sizeof(tables->home));
+	}
+	build_entities(tables, &home, ctx);
+	return 1;
+}
+
+static int field(char c)
+{
+	if (c >= 'A' && c <= 'R')
+		return c - 'A';
+	if (c >= 'a' && c <= 'r')
+		return c - 'a';
+	return -1;
+}
+
+/*!
+    The path from home to the 4-character square of \a grid, which may be
+    longer, as qrb() from the centre of the home locator to the centre of
+    the square would give it; or NULL if \a grid doesn't start with a
+    square, or there's no home yet.
+ */
+const qrb_path* qrb_tables_grid(const qrb_tables* tables, const char* grid)
+{
+	int lon_field, lat_field;
+
+	if (!tables || !grid || !tables->home[0])
+		return NULL;
+	lon_field = field(grid[0]);
+	lat_field = lon_field < 0 ? -1 : field(grid[1]);
+	if (lat_field < 0 || grid[2] < '0' || grid[2] > '9' || grid[3] < '0' || grid[3] > '9')
+		return NULL;
+	return &tables->grids[(lon_field * 10 + grid[2] - '0') * GRID_SQUARES + lat_field * 10 + grid[3] - '0'];
+}
+
+/*!
+    The path from home to the location given in cty.dat for entity number
+    \a country (as returned by dxcc_lookup()), or NULL if there's no such
+    entity in the context given to qrb_tables_set_home().
+ */
+const qrb_path* qrb_tables_entity(const qrb_tables* tables, int country)
+{
+	if (!tables || country < 0 || country >= tables->nentities)
+		return NULL;
+	return &tables->entities[country];
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * rcu.c - wait until readers are done with data that was replaced
+ *
+ * A reader brackets its use of shared data, which it gets through an
+ * atomic pointer, with rcu_read_lock() and rcu_read_unlock(); these never
+ * block. A writer swaps in the new data, then calls rcu_synchronize(),
+ * which returns once every reader that could still see the old data has
+ * finished, so that it can be freed.
+ *
+ * Readers are counted in one of two phases. rcu_synchronize() flips the
+ * phase that new readers join, and waits for the count of the old phase to
+ * drop to zero; twice, because a reader may have read the phase just
+ * before a flip and joined it just after. The counts are spread over
+ * cache lines, one per group of threads, so readers on different CPUs
+ * don't contend.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+
+#include "rcu.h"
+
+#define STRIPES 16
+
+typedef struct
+{
+	alignas(64) atomic_uint count;
+} reader_count;
+
+static reader_count readers[2][STRIPES];
+static atomic_uint phase;
+static atomic_uint next_stripe;
+static _Thread_local int stripe = -1;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* start reading; pass the result to rcu_read_unlock() when done */
+rcu_reader rcu_read_lock(void)
+{
+	rcu_reader reader;
+
+	if (stripe < 0)
+		stripe = atomic_fetch_add(&next_stripe, 1) % STRIPES;
+	reader = &readers[atomic_load(&phase) & 1][stripe].count;
+	atomic_fetch_add(reader, 1);
+	return reader;
+}
+
+void rcu_read_unlock(rcu_reader reader)
+{
+	atomic_fetch_sub(reader, 1);
+}
+
+/* wait for all readers that started before this call to finish */
+void rcu_synchronize(void)
+{
+	int flip, i;
+	unsigned int old;
+
+	pthread_mutex_lock(&writer_lock);
+	for (flip = 0; flip < 2; ++flip) {
+		old = atomic_fetch_xor(&phase, 1) & 1;
+		for (i = 0; i < STRIPES; ++i)
+			while (atomic_load(&readers[old][i].count))
+				sched_yield();
+	}
+	pthread_mutex_unlock(&writer_lock);
+}
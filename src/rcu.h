@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * rcu.h - wait until readers are done with data that was replaced
+ */
+#ifndef RCU_H
+#define RCU_H
+
+#include <stdatomic.h>
+
+typedef atomic_uint* rcu_reader;
+
+rcu_reader rcu_read_lock(void);
+void rcu_read_unlock(rcu_reader reader);
+void rcu_synchronize(void);
+
+#endif /* RCU_H */
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * spotindex.c - find the stations near a point, without trying them all
+ *
+ * Spots are kept in buckets by 4-character grid square (2 degrees of
+ * longitude by 1 of latitude), so a search only visits the squares that the
+ * circle around the point can reach, and measures the spots in them with
+ * qrb(). Finding the k nearest searches circles of growing radius until one
+ * holds at least k spots.
+ *
+ * Each bucket is an array of spot numbers, and each spot remembers its
+ * bucket and its place in it, so that adding and removing a spot are O(1).
+ * Free spot numbers are chained through the bucket field.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "dxcc.h"
+#include "locator.h"
+
+#define RADIAN (180.0 / M_PI)
+#define ARC_IN_KM 111.2 /* as in locator.c */
+#define SQUARES_X 180 /* 2 degrees of longitude each */
+#define SQUARES_Y 180 /* 1 degree of latitude each */
+#define NONE ((guint)-1)
+#define FIRST_RADIUS 500.0 /* km, for spot_index_nearest() */
+
+typedef struct
+{
+	double longitude, latitude;
+	unsigned int id;
+	guint bucket; /* or the next free spot */
+	guint slot;   /* in the bucket, or NONE if free */
+} spot;
+
+typedef struct
+{
+	guint* spots;
+	guint count, allocated;
+} bucket;
+
+struct spot_index
+{
+	spot* spots;
+	guint count, allocated;
+	guint free;
+	guint size; /* spots in use */
+	bucket buckets[SQUARES_X * SQUARES_Y];
+};
+
+static int square_x(double longitude)
+{
+	int x = (int)floor((longitude + 180.0) / 2.0);
+
+	return x < 0 ? 0 : x >= SQUARES_X ? SQUARES_X - 1 : x;
+}
+
+static int square_y(double latitude)
+{
+	int y = (int)floor(latitude + 90.0);
+
+	return y < 0 ? 0 : y >= SQUARES_Y ? SQUARES_Y - 1 : y;
+}
+
+spot_index* spot_index_new(void)
+{
+	spot_index* index = g_new0(spot_index, 1);
+
+	index->free = NONE;
+	return index;
+}
+
+void spot_index_free(spot_index* index)
+{
+	if (!index)
+		return;
+	for (int i = 0; i < SQUARES_X * SQUARES_Y; ++i)
+		g_free(index->buckets[i].spots);
+	g_free(index->spots);
+	g_free(index);
+}
+
+/* the number of spots in \a index */
+unsigned int spot_index_size(const spot_index* index)
+{
+	return index ? index->size : 0;
+}
+
+/*!
+    Add a spot at \a longitude, \a latitude, with \a id to tell it by in
+    the results of queries. Returns a handle for spot_index_remove(), or -1
+    if the location is out of range.
+ */
+int spot_index_add(spot_index* index, unsigned int id, double longitude, double latitude)
+{
+	guint n;
+	spot* s;
+	bucket* b;
+
+	if (!index || !(latitude >= -90.0 && latitude <= 90.0) || !(longitude >= -180.0 && longitude <= 180.0))
+		return -1;
+	if (index->free != NONE) {
+		n = index->free;
+		index->free = index->spots[n].bucket;
+	} else {
+		if (index->count == index->allocated) {
+			index->allocated = index->allocated ? index->allocated * 2 : 256;
+			index->spots = g_realloc(index->spots, index->allocated * sizeof(spot));
+		}
+		n = index->count++;
+	}
+	s = &index->spots[n];
+	s->longitude = longitude;
+	s->latitude = latitude;
+	s->id = id;
+	s->bucket = square_x(longitude) * SQUARES_Y + square_y(latitude);
+	b = &index->buckets[s->bucket];
+	if (b->count == b->allocated) {
+		b->allocated = b->allocated ? b->allocated * 2 : 4;
+		b->spots = g_realloc(b->spots, b->allocated * sizeof(guint));
+	}
+	s->slot = b->count;
+	b->spots[b->count++] = n;
+	++index->size;
+	return n;
+}
+
+/* remove the spot with \a handle from spot_index_add(); returns false if there's none */
+bool spot_index_remove(spot_index* index, int handle)
+{
+	spot* s;
+	bucket* b;
+	guint last;
+
+	if (!index || handle < 0 || (guint)handle >= index->count || index->spots[handle].slot == NONE)
+		return false;
+	s = &index->spots[handle];
+	b = &index->buckets[s->bucket];
+	/* move the bucket's last spot into its place */
+	last = b->spots[--b->count];
+	b->spots[s->slot] = last;
+	index->spots[last].slot = s->slot;
+	s->slot = NONE;
+	s->bucket = index->free;
+	index->free = handle;
+	--index->size;
+	return true;
+}
+
+/* keep the \a k nearest in a max-heap of \a count hits, by distance */
+static void heap_push(spot_hit* heap, size_t* count, size_t k, const spot_hit* hit)
+{
+	size_t i, parent, child;
+
+	if (*count < k) {
+		for (i = (*count)++; i > 0 && heap[parent = (i - 1) / 2].distance < hit->distance; i = parent)
+			heap[i] = heap[parent];
+		heap[i] = *hit;
+		return;
+	}
+	if (hit->distance >= heap[0].distance)
+		return;
+	for (i = 0; (child = 2 * i + 1) < *count; i = child) {
+		if (child + 1 < *count && heap[child + 1].distance > heap[child].distance)
+			++child;
+		if (heap[child].distance <= hit->distance)
+			break;
+		heap[i] = heap[child];
+	}
+	heap[i] = *hit;
+}
+
+/*
+   Measure every spot in the squares that might be within \a radius km of
+   \a home, and pass those that are to heap_push() if \a k > 0, or else put
+   them in \a hits, up to \a max. Returns how many were within \a radius.
+ */
+static size_t search(const spot_index* index, const qrb_home* home, double radius,
+    spot_hit* hits, size_t max, size_t k)
+{
+	double arc = radius / ARC_IN_KM + 1e-6; /* degrees, and a little more */
+	double lat_lo = home->latitude - arc, lat_hi = home->latitude + arc, dlon = 180.0, sine;
+	int x0 = 0, columns = SQUARES_X, y0, y1;
+	size_t found = 0, heaped = 0;
+
+	/* unless the circle takes in a pole, it spans asin(sin(arc) / cos(lat)) of longitude */
+	if (lat_lo > -90.0 && lat_hi < 90.0 && arc < 90.0) {
+		sine = sin(arc / RADIAN) / cos(home->latitude / RADIAN);
+		if (sine < 1.0)
+			dlon = asin(sine) * RADIAN + 1e-6;
+	}
+	if (dlon < 180.0) {
+		x0 = (int)floor((home->longitude - dlon + 180.0) / 2.0);
+		columns = (int)floor((home->longitude + dlon + 180.0) / 2.0) - x0 + 1;
+		if (columns > SQUARES_X)
+			columns = SQUARES_X;
+	}
+	y0 = square_y(lat_lo);
+	y1 = square_y(lat_hi);
+
+	for (int c = 0; c < columns; ++c) {
+		int x = ((x0 + c) % SQUARES_X + SQUARES_X) % SQUARES_X;
+
+		for (int y = y0; y <= y1; ++y) {
+			const bucket* b = &index->buckets[x * SQUARES_Y + y];
+
+			for (guint i = 0; i < b->count; ++i) {
+				const spot* s = &index->spots[b->spots[i]];
+				spot_hit hit;
+
+				qrb_from_home(home, s->longitude, s->latitude, &hit.distance, &hit.azimuth);
+				if (hit.distance > radius)
+					continue;
+				hit.id = s->id;
+				if (k)
+					heap_push(hits, &heaped, k, &hit);
+				else if (found < max)
+					hits[found] = hit;
+				++found;
+			}
+		}
+	}
+	return found;
+}
+
+/*!
+    Find the spots within \a radius km of \a longitude, \a latitude, by
+    qrb() from there, and put up to \a max of them into \a hits, in no
+    particular order. Returns how many there are, which may be more than
+    \a max, or 0 if the location is out of range.
+ */
+size_t spot_index_within(const spot_index* index, double longitude, double latitude, double radius,
+    spot_hit* hits, size_t max)
+{
+	qrb_home home;
+
+	if (!index || qrb_home_init(&home, longitude, latitude) != RIG_OK)
+		return 0;
+	return search(index, &home, radius, hits, max, 0);
+}
+
+static int compare_hits(const void* a, const void* b)
+{
+	double da = ((const spot_hit*)a)->distance, db = ((const spot_hit*)b)->distance;
+
+	return da < db ? -1 : da > db;
+}
+
+/*!
+    Find the \a k spots nearest to \a longitude, \a latitude, by qrb() from
+    there, and put them into \a hits, nearest first. Returns how many were
+    found: \a k, unless there are fewer spots.
+ */
+size_t spot_index_nearest(const spot_index* index, double longitude, double latitude,
+    size_t k, spot_hit* hits)
+{
+	double radius = FIRST_RADIUS;
+	size_t found;
+	qrb_home home;
+
+	if (!index || !k || qrb_home_init(&home, longitude, latitude) != RIG_OK)
+		return 0;
+	/* once a circle holds k spots, none outside it can be nearer */
+	for (;;) {
+		found = search(index, &home, radius, hits, 0, k);
+		if (found >= k || radius >= 180.0 * ARC_IN_KM)
+			break;
+		radius *= 2;
+	}
+	if (found > k)
+		found = k;
+	qsort(hits, found, sizeof(spot_hit), compare_hits);
+	return found;
+}
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * adif.c - adif_read() must count up what's in a log as counting each QSO
+ * by itself does
+ *
+ * A log is written to a temporary file, and what it holds is counted here
+ * as it's written: QSOs of known and unknown callsigns, in upper and lower
+ * case, with BAND or only FREQ or neither, with valid and invalid grids,
+ * some confirmed by QSL_RCVD or LOTW_QSL_RCVD, and some with a logged CQZ,
+ * valid or not. Between the fields are others adif_read() doesn't want,
+ * among them comments holding "<EOR>" and "<CALL:5>", which must be
+ * skipped by their lengths. A short log is read by one thread, and a long
+ * one, with a header, by several. Last, a few QSOs whose zones are all
+ * logged out of range must count the zones cty.dat gives them instead.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "clu.h"
+#include "awards_enum.h"
+#include "check.h"
+
+#define LONG_LOG 20000 /* QSOs, many ADIF chunks */
+#define SHORT_LOG 100 /* QSOs, less than one */
+#define MAX_ENTITIES 64
+
+static const char* const calls[] = {
+	"K7IHZ", "W1AW", "K0AR", "n6abc", "VE3ABC", "VO1AA", "ve2im", "DL1ABC", "F5XYZ", "TM2025", "G4ABC",
+	"JA1XYZ", "VK6AB", "KH6XX", "UA9AA", "R0AA", "kl7aa", "ZL2AB", "XX9XX", "Q1ZZ",
+};
+static const char* const bands[] = { "20m", "40M", "2m", "160m", "11m" };
+static const char* const freqs[] = { "14.074", "7.030", "144.300", "27.185" };
+static const char* const modes[] = { "CW", "SSB", "FT8", "RTTY", "XYZ" };
+static const char* const grids[] = { "DM43", "FN31pr", "JO59", "PM95ab", "RE78", "ZZ99", "AS00" };
+static const char* const bad_zones[] = { "0", "41", "99", "-3", "abc" };
+
+/* what the log holds, counted as it's written */
+typedef struct
+{
+	unsigned int qsos, unknown, located, confirmed;
+	unsigned int entity_qsos[MAX_ENTITIES];
+	unsigned int band_qsos[AWARD_BANDS], mode_qsos[AWARD_MODES];
+	bool entity[MAX_ENTITIES][2], entity_band[MAX_ENTITIES][AWARD_BANDS];
+	bool zone[MAX_ZONES + 1][2], grid[sizeof(grids) / sizeof(grids[0])][2];
+} totals;
+
+static unsigned int seed = 3;
+
+/* the same sequence on every run, whatever the C library */
+static unsigned int next_random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) & 0x7fff;
+}
+
+#define PICK(array) (array)[next_random() % (sizeof(array) / sizeof((array)[0]))]
+
+static void field(FILE* f, const char* name, const char* value)
+{
+	fprintf(f, next_random() % 4 ? "<%s:%zu>%s " : "<%s:%zu:S>%s\n", name, strlen(value), value);
+}
+
+/* write one QSO to \a f, and count it into \a t */
+static void write_qso(FILE* f, const dxcc_context* ctx, totals* t)
+{
+	const char *call = PICK(calls), *grid = next_random() % 4 ? PICK(grids) : NULL, *zone = NULL;
+	char upper[DXCC_MAX_CALLSIGN + 1], cqz[8];
+	int band = -1, mode = -1, country, g = -1;
+	bool confirmed = false;
+	dxcc_scratch scratch;
+	dxcc_data info;
+
+	fprintf(f, "<QSO_DATE:8:D>20250101 ");
+	field(f, "CALL", call);
+	if (next_random() % 3) {
+		const char* b = PICK(bands);
+
+		field(f, "BAND", b);
+		band = awards_band(b);
+	} else if (next_random() % 2) {
+		const char* fr = PICK(freqs);
+
+		field(f, "FREQ", fr);
+		band = awards_band_from_freq(atof(fr));
+	}
+	if (next_random() % 5) {
+		const char* m = PICK(modes);
+
+		field(f, "MODE", m);
+		mode = awards_mode(m);
+	}
+	if (grid) {
+		field(f, "GRIDSQUARE", grid);
+		for (g = 0; strcmp(grids[g], grid); ++g)
+			;
+	}
+	if (next_random() % 4 == 0)
+		field(f, "COMMENT", next_random() % 2 ? "has <EOR> in it" : "<CALL:5>W1AW ");
+	switch (next_random() % 6) {
+	case 0:
+		field(f, "QSL_RCVD", "Y");
+		confirmed = true;
+		break;
+	case 1:
+		field(f, "LOTW_QSL_RCVD", "y");
+		confirmed = true;
+		break;
+	case 2:
+		field(f, "QSL_RCVD", "N");
+		break;
+	}
+	switch (next_random() % 4) {
+	case 0:
+		snprintf(cqz, sizeof(cqz), "%d", 1 + next_random() % MAX_ZONES);
+		field(f, "CQZ", zone = cqz);
+		break;
+	case 1:
+		field(f, "CQZ", zone = PICK(bad_zones));
+		break;
+	}
+	fprintf(f, next_random() % 2 ? "<EOR>\n" : "<eor>\n");
+
+	++t->qsos;
+	for (int i = 0; (upper[i] = toupper((unsigned char)call[i])); ++i)
+		;
+	country = dxcc_lookup(ctx, upper, &info, &scratch);
+	if (country <= 0) {
+		++t->unknown;
+		return;
+	}
+	CHECK(country < MAX_ENTITIES, "%s is entity %d", call, country);
+	if (country >= MAX_ENTITIES)
+		return;
+	++t->entity_qsos[country];
+	if (band >= 0)
+		++t->band_qsos[band];
+	if (mode >= 0)
+		++t->mode_qsos[mode];
+	t->confirmed += confirmed;
+	if (zone && atoi(zone) >= 1 && atoi(zone) <= MAX_ZONES)
+		info.cq = atoi(zone);
+	for (int c = 0; c <= confirmed; ++c) {
+		t->entity[country][c] = true;
+		if (info.cq >= 1 && info.cq <= MAX_ZONES)
+			t->zone[info.cq][c] = true;
+		/* the last two grids aren't valid */
+		if (g >= 0 && g < (int)(sizeof(grids) / sizeof(grids[0])) - 2)
+			t->grid[g][c] = true;
+	}
+	if (band >= 0)
+		t->entity_band[country][band] = true;
+	if (g >= 0 && g < (int)(sizeof(grids) / sizeof(grids[0])) - 2)
+		++t->located;
+}
+
+/* write a log of \a qsos QSOs, with a header if \a header, counting it into \a t */
+static bool write_log(char* path, const dxcc_context* ctx, int qsos, bool header, totals* t)
+{
+	int fd = mkstemp(path);
+	FILE* f = fd >= 0 ? fdopen(fd, "w") : NULL;
+
+	if (!f)
+		return false;
+	memset(t, 0, sizeof(*t));
+	if (header)
+		fprintf(f, "Made for clu's tests <ADIF_VER:5>3.1.4 <PROGRAMID:3>clu\n<EOH>\n");
+	for (int i = 0; i < qsos; ++i)
+		write_qso(f, ctx, t);
+	fclose(f);
+	return true;
+}
+
+static unsigned int count_true(const bool* flags, size_t n, size_t stride)
+{
+	unsigned int count = 0;
+
+	for (size_t i = 0; i < n; ++i)
+		count += flags[i * stride];
+	return count;
+}
+
+/* read the log at \a path, and compare what was counted with \a t */
+static void check_log(const char* path, const dxcc_context* ctx, const totals* t, const char* name)
+{
+	adif_stats* stats = adif_stats_new(ctx);
+	unsigned int n;
+
+	CHECK(adif_read(path, ctx, NULL, stats) == 0, "%s: can't read %s", name, path);
+	CHECK(stats->qsos == t->qsos && stats->unknown == t->unknown && stats->located == t->located
+	    && stats->confirmed == t->confirmed, "%s: %u QSOs, %u unknown, %u located, %u confirmed, not %u %u %u %u",
+	    name, stats->qsos, stats->unknown, stats->located, stats->confirmed, t->qsos, t->unknown, t->located,
+	    t->confirmed);
+	for (unsigned int i = 0; i < stats->nentities && i < MAX_ENTITIES; ++i)
+		CHECK(stats->entity_qsos[i] == t->entity_qsos[i], "%s: entity %u has %u QSOs, not %u", name, i,
+		    stats->entity_qsos[i], t->entity_qsos[i]);
+	for (int b = 0; b < AWARD_BANDS; ++b)
+		CHECK(stats->band_qsos[b] == t->band_qsos[b], "%s: %s has %u QSOs, not %u", name, awards_band_name(b),
+		    stats->band_qsos[b], t->band_qsos[b]);
+	for (int m = 0; m < AWARD_MODES; ++m)
+		CHECK(stats->mode_qsos[m] == t->mode_qsos[m], "%s: mode %d has %u QSOs, not %u", name, m,
+		    stats->mode_qsos[m], t->mode_qsos[m]);
+
+	for (int c = 0; c < 2; ++c) {
+		const char* what = c ? " confirmed" : "";
+
+		n = count_true(&t->entity[0][c], MAX_ENTITIES, 2);
+		CHECK(awards_count(stats->awards, AWARD_DXCC, AWARDS_ANY, AWARDS_ANY, c) == n,
+		    "%s: %u entities%s, not %u", name, awards_count(stats->awards, AWARD_DXCC, AWARDS_ANY, AWARDS_ANY, c),
+		    what, n);
+		n = count_true(&t->zone[0][c], MAX_ZONES + 1, 2);
+		CHECK(awards_count(stats->awards, AWARD_WAZ, AWARDS_ANY, AWARDS_ANY, c) == n,
+		    "%s: %u zones%s, not %u", name, awards_count(stats->awards, AWARD_WAZ, AWARDS_ANY, AWARDS_ANY, c),
+		    what, n);
+		n = count_true(&t->grid[0][c], sizeof(grids) / sizeof(grids[0]), 2);
+		CHECK(awards_count(stats->awards, AWARD_LOCATOR, AWARDS_ANY, AWARDS_ANY, c) == n,
+		    "%s: %u grids%s, not %u", name, awards_count(stats->awards, AWARD_LOCATOR, AWARDS_ANY, AWARDS_ANY, c),
+		    what, n);
+	}
+	for (int b = 0; b < AWARD_BANDS; ++b) {
+		n = count_true(&t->entity_band[0][b], MAX_ENTITIES, AWARD_BANDS);
+		CHECK(awards_count(stats->awards, AWARD_DXCC, b, AWARDS_ANY, false) == n, "%s: %u entities on %s, not %u",
+		    name, awards_count(stats->awards, AWARD_DXCC, b, AWARDS_ANY, false), awards_band_name(b), n);
+	}
+	adif_stats_free(stats);
+}
+
+int main(void)
+{
+	/* text with a "<>" that isn't a tag, and a value cut short by the end */
+	static const char sample[] = "x <> y <CALL:5>K7IHZ<EOR><BAND:3>20";
+	/* each zone logged out of range, so only the zones cty.dat gives (29 and 5) and 14 count */
+	static const char zones_log[] = "<CALL:5>VK6AB<CQZ:2>99<EOR> <CALL:5>VK6AB<CQZ:2>41<EOR>\n"
+		"<CALL:4>W1AW<CQZ:1>0<EOR> <CALL:4>W1AW<CQZ:2>-3<EOR> <CALL:4>W1AW<CQZ:3>abc<EOR>\n"
+		"<CALL:6>DL1ABC<CQZ:2>14<EOR>\n";
+	char long_path[] = "/tmp/clu-adif-XXXXXX", short_path[] = "/tmp/clu-adif-XXXXXX";
+	char zones_path[] = "/tmp/clu-adif-XXXXXX";
+	int fd;
+	static totals long_totals, short_totals;
+	dxcc_context* ctx;
+	adif_stats* stats;
+	adif_field f;
+	size_t offset;
+
+	/* the thread pool starts once, so this must come first */
+	setenv("CLU_THREADS", "4", 1);
+
+	offset = adif_next_field(sample, sizeof(sample) - 1, 0, &f);
+	CHECK(f.name_length == 4 && !strncmp(f.name, "CALL", 4) && f.length == 5 && !strncmp(f.value, "K7IHZ", 5)
+	    && offset == 20, "the first field of \"%s\" is wrong", sample);
+	offset = adif_next_field(sample, sizeof(sample) - 1, offset, &f);
+	CHECK(f.name_length == 3 && !f.value && offset == 25, "<EOR> is wrong");
+	offset = adif_next_field(sample, sizeof(sample) - 1, offset, &f);
+	CHECK(f.length == 2 && !strncmp(f.value, "20", 2) && offset == sizeof(sample) - 1, "a short last value is wrong");
+
+	ctx = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx, "can't load %s", TEST_CTY_DAT);
+	if (!ctx)
+		return check_result("adif");
+	CHECK(dxcc_context_entities(ctx) <= MAX_ENTITIES, "%d entities", dxcc_context_entities(ctx));
+
+	CHECK(write_log(long_path, ctx, LONG_LOG, true, &long_totals)
+	    && write_log(short_path, ctx, SHORT_LOG, false, &short_totals), "can't write a log");
+	check_log(long_path, ctx, &long_totals, "long log");
+	check_log(short_path, ctx, &short_totals, "short log");
+	unlink(long_path);
+	unlink(short_path);
+
+	fd = mkstemp(zones_path);
+	CHECK(fd >= 0 && write(fd, zones_log, sizeof(zones_log) - 1) == sizeof(zones_log) - 1, "can't write a log");
+	close(fd);
+	stats = adif_stats_new(ctx);
+	CHECK(adif_read(zones_path, ctx, NULL, stats) == 0 && stats->qsos == 6
+	    && awards_count(stats->awards, AWARD_WAZ, AWARDS_ANY, AWARDS_ANY, false) == 3
+	    && awards_check(stats->awards, AWARD_WAZ, 29, AWARDS_ANY, AWARDS_ANY, false) == 0
+	    && awards_check(stats->awards, AWARD_WAZ, 5, AWARDS_ANY, AWARDS_ANY, false) == 0,
+	    "zones logged out of range: %u zones, not 3", awards_count(stats->awards, AWARD_WAZ, AWARDS_ANY,
+	    AWARDS_ANY, false));
+	adif_stats_free(stats);
+	unlink(zones_path);
+
+	stats = adif_stats_new(ctx);
+	CHECK(adif_read("/nonexistent/log.adi", ctx, NULL, stats) == 1 && stats->qsos == 0,
+	    "read a log that isn't there");
+	adif_stats_free(stats);
+	dxcc_context_free(ctx);
+	return check_result("adif");
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * alloc.c - lookups must never allocate
+ *
+ * malloc(), calloc() and realloc() are wrapped to count calls, and every
+ * kind of callsign is looked up, through both dxcc_lookup() and the global
+ * tables: plain calls, portables, call areas like K0AR/2, prefixes in
+ * front like DL/K7IHZ, full-call exceptions, unknown calls and calls too
+ * long to look up.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "dxcc.h"
+#include "check.h"
+
+static unsigned long allocations;
+
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+	++allocations;
+	return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+static const char* const calls[] = {
+	"K7IHZ", "W1AW", "JA1XYZ", "VK2AB", "LB2JK", "IT9ABC", "2E0ABC",
+	"K7IHZ/P", "DL1ABC/P", "W1AW/M", "JA1XYZ/QRP",
+	"K0AR/2", "W1AW/6", "UA9XX/1", "K7IHZ/KH6",
+	"DL/K7IHZ", "KH6/W1AW", "VP8/S", "F/G4ABC", "VE/K7IHZ/P",
+	"K0AR", "VE2IM", "KL7AA", "VK9XX", "GB13COL", "VP8THU", "DL0XX/LH", "VA2RAC/P",
+	"XX9XX", "Q", "", "/", "///", "K/", "/P",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", "K7IHZ/ABCDEFGHIJKLMNOPQRSTUVWXYZ01234",
+};
+
+int main(void)
+{
+	dxcc_context* ctx = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+	dxcc_scratch scratch;
+	dxcc_data result;
+	unsigned long before;
+
+	CHECK(ctx, "can't load %s", TEST_CTY_DAT);
+	if (!ctx || loadctydata(TEST_CTY_DAT, TEST_ABBREV_TSV))
+		return check_result("alloc");
+	CHECK(dxcc_lookup(ctx, "DL/K7IHZ", &result, &scratch) > 0 && !strcmp(result.countryname, "Germany"),
+	    "DL/K7IHZ isn't in Germany");
+	CHECK(strlen(calls[sizeof(calls) / sizeof(calls[0]) - 1]) > DXCC_MAX_CALLSIGN, "long call isn't");
+
+	for (size_t i = 0; i < sizeof(calls) / sizeof(calls[0]); ++i) {
+		before = allocations;
+		dxcc_lookup(ctx, calls[i], &result, &scratch);
+		CHECK(allocations == before, "dxcc_lookup(\"%s\") allocated %lu times", calls[i], allocations - before);
+		before = allocations;
+		lookupcountry_by_callsign_r(calls[i], &result, &scratch);
+		CHECK(allocations == before, "lookupcountry_by_callsign_r(\"%s\") allocated %lu times",
+		    calls[i], allocations - before);
+		before = allocations;
+		result = lookupcountry_by_callsign(calls[i]);
+		CHECK(allocations == before, "lookupcountry_by_callsign(\"%s\") allocated %lu times",
+		    calls[i], allocations - before);
+	}
+#ifndef __GLIBC__
+	printf("alloc: malloc isn't wrapped without glibc, so nothing was counted\n");
+#endif
+	dxcc_context_free(ctx);
+	cleanup_dxcc();
+	return check_result("alloc");
+}
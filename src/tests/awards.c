@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * awards.c - awards must agree with a plain record of every QSO added
+ *
+ * Random QSOs, for every award, on known and unknown bands and modes, some
+ * confirmed and some with keys out of range, are added to an awards and to
+ * a model here, which keeps a flag for each key on each band (or any) in
+ * each mode (or any), worked and confirmed. Between additions, what
+ * awards_check() and awards_needed() say is compared with the model; at
+ * the end, so are awards_count() and the result of merging two awards that
+ * were each given half of the QSOs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "clu.h"
+#include "awards_enum.h"
+#include "check.h"
+
+#define KEYS 1100 /* of each award, in the model */
+#define QSOS 200000
+
+/* the keys used for each award: the first valid, the rest out of range */
+static int keys[NB_AWARDS][KEYS];
+static int nkeys[NB_AWARDS], nvalid[NB_AWARDS];
+
+/* [award][key index][band, or AWARD_BANDS for any][mode, or AWARD_MODES for any][confirmed] */
+static bool worked[NB_AWARDS][KEYS][AWARD_BANDS + 1][AWARD_MODES + 1][2];
+
+static unsigned int seed = 2;
+
+/* the same sequence on every run, whatever the C library */
+static unsigned int next_random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 8) & 0xffffff;
+}
+
+static void add_key(int award, int key)
+{
+	for (int k = 0; k < nkeys[award]; ++k)
+		if (keys[award][k] == key)
+			return;
+	keys[award][nkeys[award]++] = key;
+}
+
+/* some of each award's keys, then some out of range */
+static void make_keys(void)
+{
+	for (int i = 0; i < 1024; ++i)
+		add_key(AWARD_DXCC, i);
+	for (int i = 1; i <= MAX_ZONES; ++i)
+		add_key(AWARD_WAZ, i);
+	for (int i = 0; i < MAX_CONTINENTS; ++i)
+		add_key(AWARD_WAC, i);
+	for (int i = 0; i < MAX_STATES; ++i)
+		add_key(AWARD_WAS, i);
+	for (int i = 0; i < 1000; ++i)
+		add_key(AWARD_IOTA, (i % MAX_IOTA_CONTINENTS) * 1000 + next_random() % 1000);
+	for (int i = 0; i < 1000; ++i) {
+		char square[5] = { 'A' + next_random() % 18, 'A' + next_random() % 18, '0' + next_random() % 10,
+			'0' + next_random() % 10, '\0' };
+
+		add_key(AWARD_LOCATOR, locator_to_num(square));
+	}
+	for (int a = 0; a < NB_AWARDS; ++a)
+		nvalid[a] = nkeys[a];
+	add_key(AWARD_DXCC, -1);
+	add_key(AWARD_DXCC, 1024);
+	add_key(AWARD_WAZ, 0);
+	add_key(AWARD_WAZ, MAX_ZONES + 1);
+	add_key(AWARD_WAC, MAX_CONTINENTS);
+	add_key(AWARD_WAS, -1);
+	add_key(AWARD_WAS, MAX_STATES);
+	add_key(AWARD_IOTA, MAX_IOTA_CONTINENTS * 1000);
+	add_key(AWARD_IOTA, NOT_AN_IOTA + MAX_IOTA_CONTINENTS * 1000);
+	add_key(AWARD_LOCATOR, NOT_A_LOCATOR);
+	add_key(AWARD_LOCATOR, 190100); /* field S */
+	add_key(AWARD_LOCATOR, 10000); /* second field 0 */
+}
+
+/* what awards_check() should say, from the model */
+static unsigned int model_check(int award, int k, int band, int mode, bool confirmed)
+{
+	int b = band == AWARDS_ANY ? AWARD_BANDS : band, m = mode == AWARDS_ANY ? AWARD_MODES : mode;
+
+	if (k >= nvalid[award])
+		return 0;
+	return !worked[award][k][AWARD_BANDS][AWARD_MODES][confirmed] * AWARD_NEW
+	    | !worked[award][k][b][AWARD_MODES][confirmed] * AWARD_NEW_BAND
+	    | !worked[award][k][AWARD_BANDS][m][confirmed] * AWARD_NEW_MODE
+	    | !worked[award][k][b][m][confirmed] * AWARD_NEW_SLOT;
+}
+
+static void model_add(int award, int k, int band, int mode, bool confirmed)
+{
+	int b = band == AWARDS_ANY ? AWARD_BANDS : band, m = mode == AWARDS_ANY ? AWARD_MODES : mode;
+
+	for (int c = 0; c <= confirmed; ++c) {
+		worked[award][k][b][m][c] = worked[award][k][AWARD_BANDS][m][c] = true;
+		worked[award][k][b][AWARD_MODES][c] = worked[award][k][AWARD_BANDS][AWARD_MODES][c] = true;
+	}
+}
+
+/* the index of \a key among the keys of \a award, or -1 */
+static int key_index(int award, int key)
+{
+	for (int k = 0; k < nvalid[award]; ++k)
+		if (keys[award][k] == key)
+			return k;
+	return -1;
+}
+
+/* what awards_needed() should say about a station in \a d with \a grid */
+static unsigned int model_needed(const dxcc_data* d, const char* grid, int band, int mode)
+{
+	unsigned int needed = 0;
+	int k;
+
+	if (d->country) {
+		if ((k = key_index(AWARD_DXCC, d->country)) >= 0)
+			needed |= !!(model_check(AWARD_DXCC, k, band, mode, false) & AWARD_NEW_SLOT) << AWARD_DXCC;
+		if ((k = key_index(AWARD_WAZ, d->cq)) >= 0)
+			needed |= !!(model_check(AWARD_WAZ, k, band, mode, false) & AWARD_NEW_SLOT) << AWARD_WAZ;
+		if ((k = key_index(AWARD_WAC, d->continent)) >= 0)
+			needed |= !!(model_check(AWARD_WAC, k, band, mode, false) & AWARD_NEW_SLOT) << AWARD_WAC;
+	}
+	if ((k = key_index(AWARD_LOCATOR, locator_to_num((char*)grid))) >= 0)
+		needed |= !!(model_check(AWARD_LOCATOR, k, band, mode, false) & AWARD_NEW_SLOT) << AWARD_LOCATOR;
+	return needed;
+}
+
+/* awards_count() of everything in \a a, against the model */
+static void check_counts(const awards* a, const char* name)
+{
+	for (int award = 0; award < NB_AWARDS; ++award) {
+		for (int band = AWARDS_ANY; band < AWARD_BANDS; ++band) {
+			for (int mode = AWARDS_ANY; mode < AWARD_MODES; ++mode) {
+				for (int c = 0; c < 2; ++c) {
+					int b = band == AWARDS_ANY ? AWARD_BANDS : band, m = mode == AWARDS_ANY ? AWARD_MODES : mode;
+					unsigned int want = 0;
+
+					for (int k = 0; k < nvalid[award]; ++k)
+						want += worked[award][k][b][m][c];
+					CHECK(awards_count(a, award, band, mode, c) == want,
+					    "%s: award %d band %d mode %d%s: counted %u, not %u", name, award, band, mode,
+					    c ? " confirmed" : "", awards_count(a, award, band, mode, c), want);
+				}
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	awards *a = awards_new(), *halves[2] = { awards_new(), awards_new() }, *merged = awards_new();
+
+	CHECK(awards_band("20M") == 8 && awards_band("submm") == AWARD_BANDS - 1 && awards_band("11m") == -1,
+	    "awards_band() is wrong");
+	CHECK(!strcmp(awards_band_name(awards_band_from_freq(14.074)), "20m")
+	    && !strcmp(awards_band_name(awards_band_from_freq(7.3)), "40m") && awards_band_from_freq(27.0) == -1,
+	    "awards_band_from_freq() is wrong");
+	CHECK(awards_mode("cw") == AWARD_MODE_CW && awards_mode("USB") == AWARD_MODE_PHONE
+	    && awards_mode("FT8") == AWARD_MODE_DATA && awards_mode("") == -1, "awards_mode() is wrong");
+	CHECK(!awards_add(a, NB_AWARDS, 0, 0, 0, false) && !awards_add(a, AWARD_DXCC, 1, AWARD_BANDS, 0, false)
+	    && !awards_add(a, AWARD_DXCC, 1, 0, AWARD_MODES, false) && !awards_add(NULL, AWARD_DXCC, 1, 0, 0, false),
+	    "out of range, but added");
+
+	make_keys();
+	for (int i = 0; i < QSOS; ++i) {
+		int award = next_random() % NB_AWARDS, k = next_random() % nkeys[award];
+		int band = (int)(next_random() % (AWARD_BANDS + 1)) - 1, mode = (int)(next_random() % (AWARD_MODES + 1)) - 1;
+		bool confirmed = next_random() % 3 == 0;
+
+		if (next_random() % 2) {
+			bool added = awards_add(a, award, keys[award][k], band, mode, confirmed);
+
+			CHECK(added == (k < nvalid[award]), "award %d key %d: added %d", award, keys[award][k], added);
+			awards_add(halves[i % 2], award, keys[award][k], band, mode, confirmed);
+			if (k < nvalid[award])
+				model_add(award, k, band, mode, confirmed);
+		} else {
+			unsigned int got = awards_check(a, award, keys[award][k], band, mode, confirmed);
+			unsigned int want = model_check(award, k, band, mode, confirmed);
+
+			CHECK(got == want, "award %d key %d band %d mode %d%s: %#x, not %#x", award, keys[award][k], band,
+			    mode, confirmed ? " confirmed" : "", got, want);
+		}
+		if (i % 4 == 0) {
+			dxcc_data d = { 0 };
+			char grid[LOCATOR_BUFSIZE] = "Sa00"; /* not a grid: field S */
+
+			/* a square of the locator keys, the second letter in lower case as it often is */
+			if ((k = next_random() % (nvalid[AWARD_LOCATOR] + 1)) < nvalid[AWARD_LOCATOR]) {
+				num_to_locator_r(keys[AWARD_LOCATOR][k], grid);
+				grid[1] |= 0x20;
+			}
+
+			d.country = next_random() % 1100;
+			d.cq = next_random() % 42;
+			d.continent = next_random() % (MAX_CONTINENTS + 1);
+			band = next_random() % AWARD_BANDS;
+			mode = next_random() % AWARD_MODES;
+			CHECK(awards_needed(a, &d, grid, band, mode) == model_needed(&d, grid, band, mode),
+			    "entity %d zone %d continent %d grid %s band %d mode %d: needed %#x, not %#x",
+			    d.country, d.cq, d.continent, grid, band, mode, awards_needed(a, &d, grid, band, mode),
+			    model_needed(&d, grid, band, mode));
+		}
+	}
+
+	check_counts(a, "added");
+	awards_merge(merged, halves[0]);
+	awards_merge(merged, halves[1]);
+	check_counts(merged, "merged");
+
+	awards_free(a);
+	awards_free(halves[0]);
+	awards_free(halves[1]);
+	awards_free(merged);
+	return check_result("awards");
+}
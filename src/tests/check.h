@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * check.h - what the programs run by make check share
+ *
+ * Each one is a main() that makes its checks with CHECK(), and returns
+ * check_result(), so that make check stops at the first that fails.
+ * They find their data relative to the executable, in src/tests.
+ */
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+#define TEST_CTY_DAT "cty.dat"
+#define TEST_ABBREV_TSV "../../share/clu/abbrev.tsv"
+
+static int check_failures;
+
+/* count a failure, and say what it was (only the first few times) */
+#define CHECK(cond, ...) \
+	do { \
+		if (!(cond) && check_failures++ < 20) { \
+			printf("%s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+static inline int check_result(const char* name)
+{
+	printf("%s: %s (%d failures)\n", name, check_failures ? "FAIL" : "ok", check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif /* CHECK_H */
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * cursor.c - a dxcc_cursor must agree with dxcc_lookup()
+ *
+ * Callsigns are typed one character at a time, some of them in lower case
+ * and with mistakes taken back, and after every character the cursor's
+ * result is compared with a dxcc_lookup() of what's been typed. What it
+ * says could still be reached is compared with the entities of every
+ * prefix in cty.dat that begins with what's been typed, found by reading
+ * the file here rather than through the trie.
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dxcc.h"
+#include "check.h"
+
+#define MAX_PREFIXES 1024
+#define MAX_CALLS 8192
+
+typedef struct
+{
+	char text[DXCC_MAX_CALLSIGN + 1];
+	int country;
+} prefix;
+
+static prefix prefixes[MAX_PREFIXES];
+static int nprefixes;
+static char calls[MAX_CALLS][DXCC_MAX_CALLSIGN + 1];
+static int ncalls;
+static unsigned int seed = 1;
+
+/* the same sequence on every run, whatever the C library */
+static unsigned int next_random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) & 0x7fff;
+}
+
+static void add_call(const char* call)
+{
+	if (ncalls < MAX_CALLS && strlen(call) <= DXCC_MAX_CALLSIGN)
+		strcpy(calls[ncalls++], call);
+}
+
+/* a prefix given again, by a later entity, is that entity's */
+static void add_prefix(const char* text, int country)
+{
+	int i;
+
+	if (strlen(text) > DXCC_MAX_CALLSIGN)
+		return;
+	for (i = 0; i < nprefixes && strcmp(prefixes[i].text, text); ++i)
+		;
+	if (i == nprefixes && nprefixes < MAX_PREFIXES)
+		strcpy(prefixes[nprefixes++].text, text);
+	if (i < nprefixes)
+		prefixes[i].country = country;
+}
+
+/* the entity named \a name, by looking through all of them */
+static int entity_named(const dxcc_context* ctx, const char* name)
+{
+	dxcc_data data;
+
+	for (int i = 1; i < dxcc_context_entities(ctx); ++i)
+		if (dxcc_entity(ctx, i, &data) && !strcmp(data.countryname, name))
+			return i;
+	return 0;
+}
+
+/*
+   read the prefixes of each entity from \a path, and take the full-call
+   exceptions as callsigns to type
+ */
+static bool read_prefixes(const dxcc_context* ctx, const char* path)
+{
+	static char text[1 << 16];
+	char file[4096], *record, *next;
+	size_t len;
+	FILE* f;
+
+	set_data_path_relative(file, sizeof(file), path);
+	if (!(f = fopen(file, "r")))
+		return false;
+	len = fread(text, 1, sizeof(text) - 1, f);
+	fclose(f);
+	text[len] = '\0';
+	for (record = text; (next = strchr(record, ';')); record = next + 1) {
+		char *p = record, *name, *primary = NULL, *token, *save;
+		int colons = 0, country;
+
+		*next = '\0';
+		while (isspace((unsigned char)*p))
+			++p;
+		name = p;
+		for (; *p && colons < 8; ++p) {
+			if (*p == ':' && ++colons == 7)
+				primary = p + 1;
+		}
+		if (colons < 8)
+			continue;
+		*strchr(name, ':') = '\0';
+		while (isspace((unsigned char)*primary))
+			++primary;
+		/* entities only on the WAE list have a primary prefix beginning with '*' */
+		if (*primary == '*')
+			continue;
+		country = entity_named(ctx, name);
+		CHECK(country > 0, "no entity is named %s", name);
+		/* a primary prefix with a '/' (like VP8/s) is a prefix too */
+		primary[strcspn(primary, ":")] = '\0';
+		if (strchr(primary, '/')) {
+			for (char* c = primary; *c; ++c)
+				*c = toupper((unsigned char)*c);
+			add_prefix(primary, country);
+		}
+		for (token = strtok_r(p, ", \t\r\n", &save); token; token = strtok_r(NULL, ", \t\r\n", &save)) {
+			token[strcspn(token, "([<{~")] = '\0';
+			for (char* c = token; *c; ++c)
+				*c = toupper((unsigned char)*c);
+			if (*token == '=')
+				add_call(token + 1);
+			else if (*token)
+				add_prefix(token, country);
+		}
+	}
+	return nprefixes > 0;
+}
+
+/* the entities of all the prefixes that begin with \a typed, by brute force */
+static int reachable(const char* typed, bool* seen, int nentities)
+{
+	size_t len = strlen(typed);
+	int n = 0;
+
+	memset(seen, 0, nentities * sizeof(bool));
+	for (int i = 0; i < nprefixes; ++i) {
+		if (!strncmp(prefixes[i].text, typed, len) && !seen[prefixes[i].country]) {
+			seen[prefixes[i].country] = true;
+			++n;
+		}
+	}
+	return n;
+}
+
+/* after typing \a got, the cursor should say what dxcc_lookup() does */
+static void compare(const dxcc_context* ctx, const dxcc_cursor* cursor, int got, bool* seen, int nentities)
+{
+	const char* typed = dxcc_cursor_callsign(cursor);
+	const unsigned short* list;
+	dxcc_scratch scratch;
+	dxcc_data want, have;
+	int expected = dxcc_lookup(ctx, typed, &want, &scratch);
+	size_t n;
+
+	CHECK(got == expected, "\"%s\": typing it gave %d, dxcc_lookup() %d", typed, got, expected);
+	CHECK(dxcc_cursor_result(cursor, &have) == expected && have.country == want.country
+	    && have.cq == want.cq && have.itu == want.itu && !strcmp(have.px, want.px)
+	    && !strcmp(have.countryname, want.countryname),
+	    "\"%s\": cursor has %d %s cq %d itu %d, dxcc_lookup() %d %s cq %d itu %d", typed,
+	    have.country, have.px, have.cq, have.itu, want.country, want.px, want.cq, want.itu);
+
+	n = dxcc_cursor_reachable(cursor, &list);
+	CHECK((int)n == reachable(typed, seen, nentities), "\"%s\": %zu entities reachable, not %d",
+	    typed, n, reachable(typed, seen, nentities));
+	for (size_t i = 0; i < n; ++i) {
+		CHECK(list[i] < nentities && seen[list[i]] && (!i || list[i] > list[i - 1]),
+		    "\"%s\": entity %u shouldn't be reachable, or is out of order", typed, list[i]);
+	}
+}
+
+int main(void)
+{
+	static const char* const extra[] = {
+		"K7IHZ", "W1AW", "K0AR/2", "DL/K7IHZ", "VP8/S", "VP8/s", "KH6/W1AW", "UA9XX/1",
+		"ve2im", "k0ar", "TM2025", "VE/K7IHZ/P", "K7IHZ/KH6", "2E0ABC", "/P", "//",
+	};
+	static const char alphabet[] = "ADEFIJKLMNOPRSUVWZ0123456789/";
+	dxcc_context* ctx = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+	dxcc_cursor* cursor;
+	char call[DXCC_MAX_CALLSIGN + 1];
+	bool* seen;
+	int nentities, got;
+
+	CHECK(ctx, "can't load %s", TEST_CTY_DAT);
+	if (!ctx)
+		return check_result("cursor");
+	nentities = dxcc_context_entities(ctx);
+	seen = calloc(nentities, sizeof(bool));
+	CHECK(read_prefixes(ctx, TEST_CTY_DAT), "no prefixes in %s", TEST_CTY_DAT);
+
+	for (size_t i = 0; i < sizeof(extra) / sizeof(extra[0]); ++i)
+		add_call(extra[i]);
+	for (int i = 0; i < nprefixes; ++i) {
+		snprintf(call, sizeof(call), "%.16s%dABC", prefixes[i].text, i % 10);
+		add_call(call);
+		snprintf(call, sizeof(call), "%.15s/%.15s", prefixes[i].text, prefixes[(i * 7) % nprefixes].text);
+		add_call(call);
+	}
+	while (ncalls < MAX_CALLS) {
+		int len = 1 + next_random() % 12;
+
+		for (int j = 0; j < len; ++j)
+			call[j] = alphabet[next_random() % (sizeof(alphabet) - 1)];
+		call[len] = '\0';
+		add_call(call);
+	}
+
+	cursor = dxcc_cursor_new(ctx);
+	CHECK(cursor, "no cursor");
+	for (int i = 0; cursor && i < ncalls; ++i) {
+		dxcc_cursor_reset(cursor);
+		compare(ctx, cursor, 0, seen, nentities);
+		for (const char* c = calls[i]; *c; ++c) {
+			got = dxcc_cursor_push(cursor, next_random() % 5 ? *c : tolower((unsigned char)*c));
+			compare(ctx, cursor, got, seen, nentities);
+			if (next_random() % 7 == 0) {
+				/* a typo, taken back */
+				dxcc_cursor_push(cursor, alphabet[next_random() % (sizeof(alphabet) - 1)]);
+				got = dxcc_cursor_pop(cursor);
+				compare(ctx, cursor, got, seen, nentities);
+			}
+		}
+		while (dxcc_cursor_callsign(cursor)[0]) {
+			got = dxcc_cursor_pop(cursor);
+			compare(ctx, cursor, got, seen, nentities);
+		}
+	}
+
+	/* one too many characters is ignored */
+	if (cursor) {
+		dxcc_cursor_reset(cursor);
+		for (int i = 0; i < DXCC_MAX_CALLSIGN; ++i)
+			dxcc_cursor_push(cursor, i ? '1' : 'K');
+		CHECK(dxcc_cursor_push(cursor, 'A') == -1, "typing past DXCC_MAX_CALLSIGN wasn't refused");
+		CHECK(strlen(dxcc_cursor_callsign(cursor)) == DXCC_MAX_CALLSIGN, "callsign grew past DXCC_MAX_CALLSIGN");
+	}
+
+	dxcc_cursor_free(cursor);
+	free(seen);
+	dxcc_context_free(ctx);
+	return check_result("cursor");
+}
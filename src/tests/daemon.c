@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * daemon.c - a client of serve_unix_socket() that sends its requests and
+ * shuts down its side must still get every reply, in order
+ *
+ * The server runs in a thread of this program. One client sends a few
+ * lines, the last without a newline; another sends so many that the
+ * replies are far more than the socket buffers hold when the server
+ * reads the end of the requests. Each shuts down its side as soon as it
+ * has sent everything, and only then reads the replies.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "dxcc.h"
+#include "check.h"
+
+#define MANY 10000
+
+static const char* const callsigns[] = { "W1AW", "DL1ABC", "G4ABC", "K7IHZ", "VK6AB", "JA1XYZ", "KH6/W1AW", "Q" };
+#define NCALLSIGNS (int)(sizeof(callsigns) / sizeof(callsigns[0]))
+
+static char dir[] = "/tmp/clu-daemon-XXXXXX";
+static char path[sizeof(dir) + 16];
+static int served;
+
+static void* server(void* arg)
+{
+	(void)arg;
+	served = serve_unix_socket(path, TEST_CTY_DAT, TEST_ABBREV_TSV);
+	return NULL;
+}
+
+/* connect to the server, waiting for it to start listening */
+static int connect_server(void)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	for (int tries = 0; tries < 5000; ++tries) {
+		if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+			return -1;
+		if (!connect(fd, (struct sockaddr*)&addr, sizeof(addr)))
+			return fd;
+		close(fd);
+		usleep(1000);
+	}
+	return -1;
+}
+
+/* send \a requests, shut down, and return all the replies until the server closes */
+static char* exchange(const char* requests, size_t* len)
+{
+	size_t size = 1 << 16, sent = 0, n;
+	char* replies = malloc(size);
+	ssize_t got;
+	int fd = connect_server();
+
+	*len = 0;
+	CHECK(fd >= 0, "can't connect to %s", path);
+	if (fd < 0)
+		return replies;
+	for (n = strlen(requests); sent < n; sent += got)
+		if ((got = write(fd, requests + sent, n - sent)) <= 0)
+			break;
+	CHECK(sent == n, "sent %zu bytes of %zu", sent, n);
+	shutdown(fd, SHUT_WR);
+	while ((got = read(fd, replies + *len, size - *len - 1)) > 0) {
+		*len += got;
+		if (size - *len < 4096)
+			replies = realloc(replies, size *= 2);
+	}
+	replies[*len] = '\0';
+	close(fd);
+	return replies;
+}
+
+/* check that \a replies are to \a count requests for callsigns[i % NCALLSIGNS], in order */
+static void check_replies(const char* name, char* replies, int count)
+{
+	char *line = replies, *end;
+	int i;
+
+	for (i = 0; i < count && (end = strchr(line, '\n')); ++i, line = end + 1) {
+		const char* callsign = callsigns[i % NCALLSIGNS];
+		dxcc_scratch scratch;
+		dxcc_data info;
+		char expected[64];
+
+		*end = '\0';
+		snprintf(expected, sizeof(expected), "%s\t%d\t", callsign,
+		    lookupcountry_by_callsign_r(callsign, &info, &scratch));
+		CHECK(!strncmp(line, expected, strlen(expected)), "%s: reply %d is \"%s\", not to %s", name, i, line,
+		    callsign);
+	}
+	CHECK(i == count && !*line, "%s: %d replies to %d requests", name, i, count);
+}
+
+int main(void)
+{
+	size_t len, n = 0;
+	char *requests, *replies;
+	pthread_t thread;
+
+	CHECK(loadctydata(TEST_CTY_DAT, TEST_ABBREV_TSV) == 0, "can't load %s", TEST_CTY_DAT);
+	CHECK(mkdtemp(dir), "can't make %s", dir);
+	if (check_failures)
+		return check_result("daemon");
+	snprintf(path, sizeof(path), "%s/socket", dir);
+	pthread_create(&thread, NULL, server, NULL);
+
+	/* a few, the last without a newline, and one with a CR */
+	replies = exchange("W1AW\nDL1ABC\r\nG4ABC\nK7IHZ", &len);
+	check_replies("a few", replies, 4);
+	free(replies);
+
+	/* replies to many more than the socket holds */
+	requests = malloc(MANY * 16);
+	for (int i = 0; i < MANY; ++i)
+		n += sprintf(requests + n, "%s\n", callsigns[i % NCALLSIGNS]);
+	replies = exchange(requests, &len);
+	check_replies("many", replies, MANY);
+	free(replies);
+	free(requests);
+
+	/* an empty request gets an empty reply */
+	replies = exchange("", &len);
+	CHECK(len == 0, "%zu bytes of replies to nothing", len);
+	free(replies);
+
+	pthread_kill(thread, SIGTERM);
+	pthread_join(thread, NULL);
+	CHECK(served == 0, "the server returned %d", served);
+	CHECK(access(path, F_OK), "the server left %s behind", path);
+	rmdir(dir);
+	return check_result("daemon");
+}
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * ft8msg.c - ft8_parse() must find who is who in each standard message,
+ * and refuse what isn't one
+ *
+ * Each message is given with the role of each of its words, one letter
+ * per word: Q for CQ or QRZ, M its modifier, E the station called, A the
+ * station calling, G the grid and R the report (or R, RRR, RR73, 73). A
+ * callsign in angle brackets must be flagged as hashed.
+ */
+
+#include <string.h>
+
+#include "clu.h"
+#include "check.h"
+
+#define MAX_WORDS 8
+
+static const struct
+{
+	const char* message;
+	const char* roles; /* NULL if it must be refused */
+} messages[] = {
+	/* calling CQ */
+	{ "CQ K7IHZ DM43", "QAG" },
+	{ "CQ K7IHZ", "QA" },
+	{ "CQ DX K7IHZ DM43", "QMAG" },
+	{ "CQ POTA W1AW FN31", "QMAG" },
+	{ "CQ TEST DL1ABC JO59", "QMAG" },
+	{ "CQ NA VE3ABC", "QMA" },
+	{ "CQ 145 K7IHZ DM43", "QMAG" },
+	{ "CQ PJ4/K1ABC", "QA" },
+	{ "CQ <PJ4/K1ABC>", "QA" },
+	{ "QRZ K7IHZ DM43", "QAG" },
+	{ "QRZ K7IHZ", "QA" },
+	/* a QSO */
+	{ "K7IHZ W1AW FN31", "EAG" },
+	{ "K7IHZ W1AW", "EA" },
+	{ "K7IHZ W1AW -12", "EAR" },
+	{ "K7IHZ W1AW +05", "EAR" },
+	{ "W1AW K7IHZ R-07", "EAR" },
+	{ "W1AW K7IHZ R+10", "EAR" },
+	{ "W1AW K7IHZ R DM43", "EARG" },
+	{ "K7IHZ W1AW RRR", "EAR" },
+	{ "K7IHZ W1AW RR73", "EAR" },
+	{ "W1AW K7IHZ 73", "EAR" },
+	{ "JA1XYZ VK6AB/P PF78", "EAG" },
+	{ "DL/K7IHZ F5XYZ -20", "EAR" },
+	/* hashed callsigns */
+	{ "<...> W1AW -12", "EAR" },
+	{ "K7IHZ <PJ4/K1ABC> RR73", "EAR" },
+	{ "<PJ4/K1ABC> K7IHZ", "EA" },
+	{ "<PJ4/K1ABC> <...> R-03", "EAR" },
+	{ "<W1AW> K7IHZ DM43", "EAG" },
+	/* not standard messages */
+	{ "", NULL },
+	{ "CQ", NULL },
+	{ "QRZ", NULL },
+	{ "DM43", NULL },
+	{ "K7IHZ", NULL },
+	{ "CQ DX", NULL },
+	{ "CQ DM43", NULL },
+	{ "CQ K7IHZ DM43 -12", NULL },
+	{ "CQ DX K7IHZ DM43 73", NULL },
+	{ "CQ TOOLONG K7IHZ", NULL },
+	{ "QRZ DX K7IHZ", NULL },
+	{ "K7IHZ -12", NULL },
+	{ "K7IHZ DM43", NULL },
+	{ "K7IHZ W1AW R", NULL },
+	{ "K7IHZ W1AW -1234", NULL },
+	{ "K7IHZ W1AW DM43 -12", NULL },
+	{ "K7IHZ W1AW RR73 73", NULL },
+	{ "K7IHZ W1AW FN31pr", NULL },
+	{ "K7IHZ <> -12", NULL },
+	{ "TNX FOR QSO 73", NULL },
+	{ "HELLO WORLD", NULL },
+};
+
+/* the index of \a role in \a roles, or -1 */
+static int role_of(const char* roles, char role)
+{
+	const char* p = strchr(roles, role);
+
+	return p ? p - roles : -1;
+}
+
+int main(void)
+{
+	for (size_t m = 0; m < sizeof(messages) / sizeof(messages[0]); ++m) {
+		const char* text = messages[m].message;
+		const char* roles = messages[m].roles;
+		char copy[128], *words[MAX_WORDS], *save;
+		ft8_message msg;
+		int count = 0;
+		bool parsed;
+
+		strcpy(copy, text);
+		for (char* w = strtok_r(copy, " ", &save); w && count < MAX_WORDS; w = strtok_r(NULL, " ", &save))
+			words[count++] = w;
+		parsed = ft8_parse(count, (const char* const*)words, &msg);
+		CHECK(parsed == (roles != NULL), "\"%s\" was %s", text, parsed ? "parsed" : "refused");
+		if (!parsed || !roles)
+			continue;
+		CHECK(msg.cq == role_of(roles, 'Q') && msg.modifier == role_of(roles, 'M')
+		    && msg.callee == role_of(roles, 'E') && msg.caller == role_of(roles, 'A')
+		    && msg.grid == role_of(roles, 'G') && msg.report == role_of(roles, 'R'),
+		    "\"%s\": CQ %d modifier %d callee %d caller %d grid %d report %d, not %s", text, msg.cq,
+		    msg.modifier, msg.callee, msg.caller, msg.grid, msg.report, roles);
+		CHECK(msg.callee_hashed == (msg.callee >= 0 && words[msg.callee][0] == '<')
+		    && msg.caller_hashed == (msg.caller >= 0 && words[msg.caller][0] == '<'),
+		    "\"%s\": callee hashed %d, caller hashed %d", text, msg.callee_hashed, msg.caller_hashed);
+	}
+	return check_result("ft8msg");
+}
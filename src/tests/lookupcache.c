@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * lookupcache.c - lookup_cache_lookup() must give what an uncached lookup
+ * would, counting hits and misses, replacing the least recently used entry
+ * when it's full, and forgetting everything when cty.dat is reloaded
+ *
+ * The reload is of a copy of the test cty.dat in which W1AW has moved from
+ * the United States to England, and back again: each time, the cache must
+ * give the entity that the tables just loaded give.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lookupcache.h"
+#include "check.h"
+
+static lookup_cache* cache;
+
+/* look \a callsign up in the cache, which must find it there if \a hit, and give \a country */
+static void lookup(const char* callsign, bool hit, const char* country)
+{
+	guint64 hits, misses, hits_after, misses_after;
+	dxcc_data cached, plain;
+	dxcc_scratch scratch;
+	int ret, plain_ret;
+
+	lookup_cache_stats(cache, &hits, &misses);
+	ret = lookup_cache_lookup(cache, callsign, &cached);
+	lookup_cache_stats(cache, &hits_after, &misses_after);
+	CHECK(hits_after == hits + hit && misses_after == misses + !hit, "%s: expected a %s, got %lu hits and %lu misses",
+	    callsign, hit ? "hit" : "miss", (unsigned long)(hits_after - hits), (unsigned long)(misses_after - misses));
+	plain_ret = lookupcountry_by_callsign_r(callsign, &plain, &scratch);
+	CHECK(ret == plain_ret && cached.country == plain.country && cached.countryname == plain.countryname
+	    && cached.cq == plain.cq && cached.itu == plain.itu,
+	    "%s: cached as %u %s, but it's %u %s", callsign, cached.country, cached.countryname, plain.country,
+	    plain.countryname);
+	CHECK(plain.countryname && !strcmp(plain.countryname, country), "%s is in %s, not %s", callsign,
+	    plain.countryname, country);
+}
+
+/* write a copy of the test cty.dat to \a path, with W1AW in England */
+static bool write_moved(char* path)
+{
+	static char text[1 << 16];
+	char file[4096], *w1aw, *england;
+	size_t len;
+	FILE* f;
+	int fd;
+
+	set_data_path_relative(file, sizeof(file), TEST_CTY_DAT);
+	if (!(f = fopen(file, "r")))
+		return false;
+	len = fread(text, 1, sizeof(text) - 1, f);
+	fclose(f);
+	text[len] = '\0';
+	w1aw = strstr(text, "=W1AW,");
+	england = strstr(text, "2E,G,M,");
+	if (!w1aw || !england || england < w1aw || (fd = mkstemp(path)) < 0)
+		return false;
+	f = fdopen(fd, "w");
+	fwrite(text, 1, w1aw - text, f);
+	w1aw += strlen("=W1AW,");
+	england += strlen("2E,G,M,");
+	fwrite(w1aw, 1, england - w1aw, f);
+	fputs("=W1AW,", f);
+	fputs(england, f);
+	return fclose(f) == 0;
+}
+
+int main(void)
+{
+	char moved[] = "/tmp/clu-lookupcache-XXXXXX";
+	char long_call[DXCC_MAX_CALLSIGN + 8];
+
+	CHECK(readctydata(TEST_CTY_DAT) == 0, "can't load %s", TEST_CTY_DAT);
+	CHECK(write_moved(moved), "can't write a copy of %s", TEST_CTY_DAT);
+	if (check_failures)
+		return check_result("lookupcache");
+
+	cache = lookup_cache_new(3);
+	lookup("W1AW", false, "United States");
+	lookup("W1AW", true, "United States");
+	lookup("DL1ABC", false, "Germany");
+	lookup("G4ABC", false, "England");
+	/* full: W1AW is used again, so DL1ABC is now the oldest, and goes next */
+	lookup("W1AW", true, "United States");
+	lookup("F5XYZ", false, "France");
+	lookup("G4ABC", true, "England");
+	lookup("W1AW", true, "United States");
+	lookup("DL1ABC", false, "Germany");
+	/* which pushed out F5XYZ, used longest ago; then F5XYZ pushes out G4ABC */
+	lookup("W1AW", true, "United States");
+	lookup("F5XYZ", false, "France");
+	lookup("G4ABC", false, "England");
+	/* lookups are case-sensitive, as cty.dat is */
+	lookup("w1aw", false, "Unknown");
+
+	/* callsigns too long to keep aren't counted */
+	memset(long_call, 'W', sizeof(long_call) - 1);
+	long_call[sizeof(long_call) - 1] = '\0';
+	{
+		guint64 hits, misses;
+		dxcc_data result;
+
+		lookup_cache_lookup(cache, long_call, &result);
+		lookup_cache_lookup(cache, long_call, &result);
+		lookup_cache_stats(cache, &hits, &misses);
+		CHECK(hits == 5 && misses == 8, "%lu hits and %lu misses", (unsigned long)hits, (unsigned long)misses);
+	}
+
+	/* after a reload, nothing cached is found, and what's looked up is from the new tables */
+	lookup("G4ABC", true, "England");
+	CHECK(readctydata(moved) == 0, "can't load %s", moved);
+	lookup("W1AW", false, "England");
+	lookup("G4ABC", false, "England");
+	lookup("W1AW", true, "England");
+	CHECK(readctydata(TEST_CTY_DAT) == 0, "can't load %s", TEST_CTY_DAT);
+	lookup("W1AW", false, "United States");
+	lookup("W1AW", true, "United States");
+
+	/* and so after clearing it, but the counts are kept */
+	lookup_cache_clear(cache);
+	lookup("W1AW", false, "United States");
+
+	lookup_cache_free(cache);
+	unlink(moved);
+	return check_result("lookupcache");
+}
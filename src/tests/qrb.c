@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrb.c - qrb_batch(), qrb_from_home() and qrb_from_home_float() must
+ * stay within the bounds their comments give against qrb()
+ *
+ * Random pairs of points are compared: all over the world, at and near the
+ * poles, on both sides of the 180th meridian, near each other's antipodes,
+ * close together, and on whole and half degrees, plus some out of range.
+ * Each of the kernels qrbbatch.c chooses from (the default one, and the
+ * AVX2 one where the CPU has it) is checked, as well as the choice.
+ *
+ * The bounds, from qrbbatch.c: in double precision, the distance is within
+ * 1 m of qrb()'s (0.1 m above 100 m), and the azimuth the same, except
+ * within 1e-9 degree of a half degree, where it may round the other way;
+ * in single precision, the distance is within 5 m, and the azimuth the
+ * same, except within 1e-3 degree of a half degree (or 0.1 degree over the
+ * km to home or its antipode, if more), at the poles and within 1 km of
+ * home. Points too near qrb()'s thresholds for coinciding and antipodal
+ * points are skipped, since the kernels may decide them either way.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "locator.h"
+#include "qrbbatch.h"
+#include "check.h"
+
+#define PAIRS 200000
+#define HOMES 64
+#define POINTS 4096 /* from each home */
+
+#define RADIAN (180.0 / M_PI)
+#define ARC_IN_KM 111.2
+#define ANTIPODE_KM (180.0 * ARC_IN_KM)
+
+typedef int (*batch_fn)(const double*, const double*, const double*, const double*, double*, double*, size_t);
+typedef int (*float_fn)(const qrb_home*, const float*, const float*, float*, float*, size_t);
+
+static double lon1[PAIRS], lat1[PAIRS], lon2[PAIRS], lat2[PAIRS];
+static double distance[PAIRS], azimuth[PAIRS];
+static unsigned int seed = 4;
+
+/* the same sequence on every run, whatever the C library */
+static double random_between(double a, double b)
+{
+	seed = seed * 1103515245u + 12345u;
+	return a + (b - a) * ((seed >> 8) & 0xffffff) / (double)0xffffff;
+}
+
+/* a small offset of either sign, of any size from 1e-8 to 0.1 */
+static double nudge(void)
+{
+	return (random_between(0, 1) < 0.5 ? -1 : 1) * pow(10, random_between(-8, -1));
+}
+
+static double clamp(double v, double lo, double hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static double wrap(double lon)
+{
+	return lon > 180 ? lon - 360 : lon < -180 ? lon + 360 : lon;
+}
+
+/* a point of \a kind, near \a lon, \a lat where that matters */
+static void make_point(int kind, double lon, double lat, double* x, double* y)
+{
+	switch (kind) {
+	case 0: /* anywhere */
+	default:
+		*x = random_between(-180, 180);
+		*y = random_between(-90, 90);
+		break;
+	case 1: /* at or near a pole */
+		*x = random_between(-180, 180);
+		*y = random_between(0, 1) < 0.2 ? 90 : 90 - fabs(nudge());
+		if (random_between(0, 1) < 0.5)
+			*y = -*y;
+		break;
+	case 2: /* at or near the 180th meridian */
+		*x = random_between(0, 1) < 0.2 ? 180 : 180 - fabs(nudge());
+		if (random_between(0, 1) < 0.5)
+			*x = -*x;
+		*y = random_between(-90, 90);
+		break;
+	case 3: /* near the antipode */
+		*x = wrap(lon + 180 + nudge());
+		*y = clamp(-lat + nudge(), -90, 90);
+		break;
+	case 4: /* close by, perhaps across the 180th meridian */
+		*x = wrap(lon + nudge());
+		*y = clamp(lat + nudge(), -90, 90);
+		break;
+	case 5: /* on whole and half degrees, as grid squares are */
+		*x = round(random_between(-180, 180));
+		*y = round(random_between(-90, 90) * 2) / 2;
+		break;
+	}
+}
+
+/* what qrb() computes before rounding, and compares with its thresholds: the dot product */
+static double qrb_dot(double x1, double y1, double x2, double y2)
+{
+	y1 = clamp(y1, -89.999999999, 89.999999999) / RADIAN;
+	y2 = clamp(y2, -89.999999999, 89.999999999) / RADIAN;
+	return sin(y1) * sin(y2) + cos(y1) * cos(y2) * cos(x2 / RADIAN - x1 / RADIAN);
+}
+
+/* and the azimuth, before it's rounded */
+static double qrb_exact_azimuth(double x1, double y1, double x2, double y2)
+{
+	double az;
+
+	y1 = clamp(y1, -89.999999999, 89.999999999) / RADIAN;
+	y2 = clamp(y2, -89.999999999, 89.999999999) / RADIAN;
+	az = RADIAN * atan2(sin(x2 / RADIAN - x1 / RADIAN) * cos(y2),
+	    cos(y1) * sin(y2) - sin(y1) * cos(y2) * cos(x2 / RADIAN - x1 / RADIAN));
+	return az < 0 ? az + 360 : az;
+}
+
+/* whether an azimuth of exactly \a az is within \a margin of a half degree */
+static bool near_half_degree(double az, double margin)
+{
+	return fabs(az - floor(az) - 0.5) < margin;
+}
+
+/* whether whole degrees \a a and \a b are the same (360 being 0, as qrb() may give either) */
+static bool same_degrees(double a, double b)
+{
+	return fmod(a, 360) == fmod(b, 360);
+}
+
+/* whether whole degrees \a a and \a b are the same or next to each other, around the circle */
+static bool adjacent_degrees(double a, double b)
+{
+	double d = fabs(fmod(a, 360) - fmod(b, 360));
+
+	return d <= 1 || d >= 359;
+}
+
+static void make_pairs(void)
+{
+	for (int i = 0; i < PAIRS; ++i) {
+		make_point(i % 3 ? 0 : (i / 3) % 6, 0, 0, &lon1[i], &lat1[i]);
+		make_point((i / 2) % 6, lon1[i], lat1[i], &lon2[i], &lat2[i]);
+		if (i % 1000 == 999) {
+			/* out of range */
+			lat1[i] = 90.5;
+			lon2[i] = i % 2000 == 999 ? -180.25 : NAN;
+		}
+	}
+}
+
+static void check_batch(const char* name, batch_fn fn)
+{
+	int bad = 0, got;
+
+	got = fn(lon1, lat1, lon2, lat2, distance, azimuth, PAIRS);
+	for (int i = 0; i < PAIRS; ++i) {
+		double d, a, dot;
+
+		if (qrb(lon1[i], lat1[i], lon2[i], lat2[i], &d, &a) != RIG_OK) {
+			++bad;
+			CHECK(isnan(distance[i]) && isnan(azimuth[i]), "%s: pair %d is out of range, but gave %g km at %g",
+			    name, i, distance[i], azimuth[i]);
+			continue;
+		}
+		dot = qrb_dot(lon1[i], lat1[i], lon2[i], lat2[i]);
+		if (fabs(dot + .999999) < 1e-9)
+			continue;
+		CHECK(fabs(distance[i] - d) < (d < 0.1 ? 1e-3 : 1e-4),
+		    "%s: %.9g,%.9g to %.9g,%.9g is %.9f km, not %.9f", name, lon1[i], lat1[i], lon2[i], lat2[i],
+		    distance[i], d);
+		if (fabs(dot - .999999999999999) < 1e-13)
+			continue;
+		CHECK(same_degrees(azimuth[i], a) || (near_half_degree(qrb_exact_azimuth(lon1[i], lat1[i], lon2[i], lat2[i]), 1e-9)
+		    && adjacent_degrees(azimuth[i], a)),
+		    "%s: %.9g,%.9g to %.9g,%.9g is at %g, not %g", name, lon1[i], lat1[i], lon2[i], lat2[i],
+		    azimuth[i], a);
+	}
+	CHECK(got == bad, "%s: %d pairs out of range, not %d", name, got, bad);
+}
+
+/* qrb_from_home() is qrb() */
+static void check_from_home(void)
+{
+	for (int i = 0; i < PAIRS; ++i) {
+		qrb_home home;
+		double d, a, hd, ha;
+		int ret = qrb(lon1[i], lat1[i], lon2[i], lat2[i], &d, &a);
+
+		if (qrb_home_init(&home, lon1[i], lat1[i]) != RIG_OK) {
+			CHECK(ret != RIG_OK, "qrb_from_home: %g,%g is out of range, but qrb() took it", lon1[i], lat1[i]);
+			continue;
+		}
+		CHECK(qrb_from_home(&home, lon2[i], lat2[i], &hd, &ha) == ret, "qrb_from_home: pair %d: not as qrb()", i);
+		if (ret != RIG_OK)
+			continue;
+		CHECK(fabs(hd - d) < 1e-9 && (same_degrees(ha, a)
+		    || near_half_degree(qrb_exact_azimuth(lon1[i], lat1[i], lon2[i], lat2[i]), 1e-9)),
+		    "qrb_from_home: %.9g,%.9g to %.9g,%.9g is %.12f km at %g, not %.12f km at %g",
+		    lon1[i], lat1[i], lon2[i], lat2[i], hd, ha, d, a);
+	}
+}
+
+/* from homes of each kind to points of every kind, in single precision */
+static void check_float(const char* name, float_fn fn)
+{
+	static float lon[POINTS], lat[POINTS], fdistance[POINTS], fazimuth[POINTS];
+
+	seed = 6;
+	for (int h = 0; h < HOMES; ++h) {
+		double home_lon, home_lat;
+		qrb_home home;
+		int bad = 0, got;
+
+		make_point(h % 6, 0, 0, &home_lon, &home_lat);
+		qrb_home_init(&home, home_lon, home_lat);
+		for (int i = 0; i < POINTS; ++i) {
+			double x, y;
+
+			make_point(i % 6, home_lon, home_lat, &x, &y);
+			lon[i] = x;
+			lat[i] = y;
+			if (i % 500 == 499)
+				lat[i] = -91;
+		}
+		got = fn(&home, lon, lat, fdistance, fazimuth, POINTS);
+		for (int i = 0; i < POINTS; ++i) {
+			double d, a, gap;
+
+			if (qrb(home_lon, home_lat, lon[i], lat[i], &d, &a) != RIG_OK) {
+				++bad;
+				CHECK(isnan(fdistance[i]) && isnan(fazimuth[i]), "%s: %g,%g is out of range, but gave %g km",
+				    name, lon[i], lat[i], fdistance[i]);
+				continue;
+			}
+			/* how far from the antipode, before qrb() decides it's there */
+			gap = ANTIPODE_KM - ARC_IN_KM * RADIAN * acos(clamp(qrb_dot(home_lon, home_lat, lon[i], lat[i]), -1, 1));
+			if (fabs(gap - 9.01) < 0.05)
+				continue;
+			CHECK(fabs(fdistance[i] - d) < 5e-3, "%s: %.9g,%.9g to %.9g,%.9g is %.6f km, not %.6f", name,
+			    home_lon, home_lat, lon[i], lat[i], fdistance[i], d);
+			if (d < 1 || fabs(home_lat) > 89.99 || fabs(lat[i]) > 89.99)
+				continue;
+			CHECK(same_degrees(fazimuth[i], a) || (near_half_degree(qrb_exact_azimuth(home_lon, home_lat, lon[i], lat[i]), fmax(1e-3, 0.1 / fmin(d, gap)))
+			    && adjacent_degrees(fazimuth[i], a)),
+			    "%s: %.9g,%.9g to %.9g,%.9g is at %g, not %g", name, home_lon, home_lat, lon[i], lat[i],
+			    fazimuth[i], a);
+		}
+		CHECK(got == bad, "%s: %d points out of range, not %d", name, got, bad);
+	}
+}
+
+int main(void)
+{
+	make_pairs();
+	check_batch("qrb_batch", qrb_batch);
+	check_batch("qrb_batch_default", qrb_batch_default);
+	check_from_home();
+	check_float("qrb_from_home_float", qrb_from_home_float);
+	check_float("qrb_from_home_float_default", qrb_from_home_float_default);
+#ifdef QRB_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		check_batch("qrb_batch_avx2", qrb_batch_avx2);
+		check_float("qrb_from_home_float_avx2", qrb_from_home_float_avx2);
+	} else {
+		printf("qrb: no AVX2 on this CPU, so only the default kernels were checked\n");
+	}
+#endif
+	return check_result("qrb");
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * qrbtables.c - qrb_tables_grid() and qrb_tables_entity() must give what
+ * qrb() gives from the home locator, and be built again when the home or
+ * the context changes, but not otherwise
+ *
+ * Every one of the 32400 grids, and every entity of the test cty.dat, is
+ * checked against qrb(), from two homes. Between them, the context is
+ * freed and another loaded, from a copy of cty.dat in which England has
+ * moved; it may well be at the same address as the old one, and the
+ * entities must still be built again.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dxcc.h"
+#include "locator.h"
+#include "check.h"
+
+static char dir[] = "/tmp/clu-qrbtables-XXXXXX";
+
+/* whether \a path is the path from \a home_locator to \a longitude, \a latitude */
+static bool path_ok(const qrb_path* path, const char* home_locator, double longitude, double latitude)
+{
+	double home_lon, home_lat, d, a;
+
+	locator2longlat(&home_lon, &home_lat, home_locator);
+	qrb(home_lon, home_lat, longitude, latitude, &d, &a);
+	return path && path->distance == (float)d && path->azimuth == a
+	    && path->long_distance == (float)distance_long_path(d) && path->long_azimuth == azimuth_long_path(a);
+}
+
+static void check_grids(const qrb_tables* tables, const char* home)
+{
+	char grid[5] = { 0 };
+	double longitude, latitude;
+
+	for (int x = 0; x < 180; ++x) {
+		for (int y = 0; y < 180; ++y) {
+			const qrb_path* path;
+
+			grid[0] = 'A' + x / 10;
+			grid[1] = 'A' + y / 10;
+			grid[2] = '0' + x % 10;
+			grid[3] = '0' + y % 10;
+			locator2longlat(&longitude, &latitude, grid);
+			path = qrb_tables_grid(tables, grid);
+			CHECK(path_ok(path, home, longitude, latitude), "%s to %s: %g km at %d", home, grid,
+			    path ? path->distance : -1, path ? path->azimuth : -1);
+		}
+	}
+}
+
+static void check_entities(const qrb_tables* tables, const char* home, const dxcc_context* ctx)
+{
+	int n = dxcc_context_entities(ctx);
+	dxcc_data entity;
+
+	for (int i = 0; i < n; ++i) {
+		const qrb_path* path = qrb_tables_entity(tables, i);
+
+		CHECK(dxcc_entity(ctx, i, &entity) && path_ok(path, home, entity.longitude, entity.latitude),
+		    "%s to entity %d (%s): %g km at %d", home, i, entity.countryname, path ? path->distance : -1,
+		    path ? path->azimuth : -1);
+	}
+	CHECK(!qrb_tables_entity(tables, n) && !qrb_tables_entity(tables, -1), "entities out of range have paths");
+}
+
+/* copy the test cty.dat into \a dir, with England moved to the Bay of Biscay */
+static bool write_moved(char* path, size_t size)
+{
+	static char text[1 << 16];
+	char file[4096], *england;
+	size_t len;
+	FILE* f;
+
+	set_data_path_relative(file, sizeof(file), TEST_CTY_DAT);
+	if (!(f = fopen(file, "r")))
+		return false;
+	len = fread(text, 1, sizeof(text) - 1, f);
+	fclose(f);
+	text[len] = '\0';
+	if (!(england = strstr(text, "England:")) || !(england = strstr(england, "52.77")) || !mkdtemp(dir))
+		return false;
+	memcpy(england, "45.00", 5);
+	snprintf(path, size, "%s/cty.dat", dir);
+	if (!(f = fopen(path, "w")))
+		return false;
+	fwrite(text, 1, len, f);
+	return fclose(f) == 0;
+}
+
+int main(void)
+{
+	char moved[sizeof(dir) + 16], snapshot[sizeof(moved) + 4];
+	qrb_tables* tables = qrb_tables_new();
+	dxcc_context* ctx;
+	uintptr_t old;
+	dxcc_data england;
+
+	CHECK(write_moved(moved, sizeof(moved)), "can't write a copy of %s", TEST_CTY_DAT);
+	/* write both snapshots first, so that both contexts are made alike, and likely at the same address */
+	dxcc_context_free(dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL));
+	dxcc_context_free(dxcc_context_load(moved, TEST_ABBREV_TSV, NULL));
+	ctx = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx, "can't load %s", TEST_CTY_DAT);
+	if (check_failures)
+		return check_result("qrbtables");
+
+	CHECK(!qrb_tables_grid(tables, "FN31"), "there's a path before there's a home");
+	CHECK(qrb_tables_set_home(tables, "FN31pr", ctx) == 1, "the tables weren't built");
+	check_grids(tables, "FN31pr");
+	check_entities(tables, "FN31pr", ctx);
+	CHECK(qrb_tables_grid(tables, "fn31") == qrb_tables_grid(tables, "FN31")
+	    && qrb_tables_grid(tables, "FN31pr") == qrb_tables_grid(tables, "FN31"),
+	    "a grid in lower case, or with a subsquare, is another grid");
+	CHECK(!qrb_tables_grid(tables, "FN3") && !qrb_tables_grid(tables, "SN31") && !qrb_tables_grid(tables, "F131")
+	    && !qrb_tables_grid(tables, ""), "a grid that isn't one has a path");
+
+	/* nothing changed */
+	CHECK(qrb_tables_set_home(tables, "FN31pr", ctx) == 0, "the tables were built again for the same home");
+	CHECK(qrb_tables_set_home(tables, "fn31PR", ctx) == 0, "the tables were built again for the home in lower case");
+	CHECK(qrb_tables_set_home(tables, "FN31zz", ctx) == -RIG_EINVAL
+	    && qrb_tables_set_home(tables, "", ctx) == -RIG_EINVAL, "a home that isn't a locator was taken");
+	check_grids(tables, "FN31pr");
+
+	/* another context */
+	old = (uintptr_t)ctx;
+	dxcc_context_free(ctx);
+	ctx = dxcc_context_load(moved, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx && dxcc_entity(ctx, 11, &england) && !strcmp(england.countryname, "England")
+	    && england.latitude == 45.0f, "can't load %s", moved);
+	CHECK(qrb_tables_set_home(tables, "FN31pr", ctx) == 1, "the entities weren't built again for a new context%s",
+	    (uintptr_t)ctx == old ? " at the same address" : "");
+	check_entities(tables, "FN31pr", ctx);
+
+	/* moving builds everything again */
+	CHECK(qrb_tables_set_home(tables, "JO59jw", ctx) == 1, "the tables weren't built again for a new home");
+	check_grids(tables, "JO59jw");
+	check_entities(tables, "JO59jw", ctx);
+	CHECK(qrb_tables_set_home(tables, "JO59jw", NULL) == 1 && !qrb_tables_entity(tables, 0),
+	    "the entities are still there without a context");
+
+	qrb_tables_free(tables);
+	dxcc_context_free(ctx);
+	snprintf(snapshot, sizeof(snapshot), "%s.bin", moved);
+	unlink(snapshot);
+	unlink(moved);
+	rmdir(dir);
+	return check_result("qrbtables");
+}
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * snapshot.c - cty.dat.bin must be used only while it matches cty.dat,
+ * and a corrupt one must never be trusted so far as to crash a lookup
+ *
+ * A copy of the test cty.dat is loaded in a directory of its own, which
+ * writes the snapshot; loading again must map it, not write it again. Then
+ * cty.dat is changed (W1AW moves to England, which keeps the size the same)
+ * and given a new modification time: the snapshot must be made again, with
+ * W1AW in England.
+ *
+ * Then the snapshot is corrupted at random, a few words at a time, and
+ * truncated, and loaded each time. Whether dxcc_context_load() maps it or
+ * falls back to parsing cty.dat, every lookup must give an entity that
+ * exists, with strings, and typing callsigns must work; a snapshot shorter
+ * than it says must be refused.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dxcc.h"
+#include "ctyimage.h"
+#include "check.h"
+
+#define CORRUPTIONS 3000
+
+static const char* const callsigns[] = {
+	"W1AW", "K0AR", "K7IHZ", "VE2IM", "VA2RAC/P", "KH6/W1AW", "DL1ABC", "DL0XX/LH", "G4ABC", "GB2RN", "F5XYZ",
+	"LA9ABC", "UA9ABC", "R1ABC", "VK6AB", "JA1XYZ", "1A0KM", "3A2MW", "DL/K7IHZ", "K7IHZ/P", "W1AW/KL7", "Q",
+	"", "0", "/", "ZZZZZZ",
+};
+
+static char dir[] = "/tmp/clu-snapshot-XXXXXX";
+static char cty_dat[sizeof(dir) + 16], snapshot[sizeof(dir) + 16];
+static unsigned int seed = 2;
+
+/* the same sequence on every run, whatever the C library */
+static guint32 random_below(guint32 n)
+{
+	seed = seed * 1103515245u + 12345u;
+	return ((seed >> 8) & 0xffffff) % n;
+}
+
+static char* read_file(const char* path, size_t* len)
+{
+	char* data = NULL;
+	struct stat st;
+	FILE* f;
+
+	if (stat(path, &st) || !(f = fopen(path, "r")))
+		return NULL;
+	data = malloc(st.st_size + 1);
+	*len = fread(data, 1, st.st_size, f);
+	data[*len] = '\0';
+	fclose(f);
+	return data;
+}
+
+static bool write_file(const char* path, const char* data, size_t len)
+{
+	FILE* f = fopen(path, "w");
+
+	if (!f)
+		return false;
+	fwrite(data, 1, len, f);
+	return fclose(f) == 0;
+}
+
+/* the inode of the snapshot, which is replaced (by rename()) whenever it's written */
+static ino_t snapshot_inode(void)
+{
+	struct stat st;
+
+	return stat(snapshot, &st) ? 0 : st.st_ino;
+}
+
+static const char* entity_of(const dxcc_context* ctx, const char* callsign)
+{
+	dxcc_scratch scratch;
+	dxcc_data result;
+
+	dxcc_lookup(ctx, callsign, &result, &scratch);
+	return result.countryname;
+}
+
+static volatile size_t bytes_read; /* so that the reading isn't optimized away */
+
+/* read the strings of \a result, as a caller would */
+static void read_strings(const dxcc_data* result)
+{
+	bytes_read += strlen(result->countryname) + strlen(result->px) + strlen(result->exceptions);
+}
+
+/* look everything up, and type every callsign, in tables that may have been corrupted */
+static void use(const dxcc_context* ctx)
+{
+	int entities = dxcc_context_entities(ctx);
+	dxcc_cursor* cursor = dxcc_cursor_new(ctx);
+	dxcc_scratch scratch;
+	dxcc_data result;
+
+	for (size_t i = 0; i < sizeof(callsigns) / sizeof(callsigns[0]); ++i) {
+		const char* c;
+		int country = dxcc_lookup(ctx, callsigns[i], &result, &scratch);
+
+		CHECK(country >= 0 && country < entities && result.countryname && result.px && result.exceptions,
+		    "%s is in entity %d of %d", callsigns[i], country, entities);
+		read_strings(&result);
+		dxcc_cursor_reset(cursor);
+		for (c = callsigns[i]; *c; ++c) {
+			const unsigned short* reachable;
+			size_t n;
+
+			country = dxcc_cursor_push(cursor, *c);
+			CHECK(country >= 0 && country < entities, "typing %s gave entity %d of %d", callsigns[i], country,
+			    entities);
+			n = dxcc_cursor_reachable(cursor, &reachable);
+			for (size_t k = 0; k < n; ++k) {
+				CHECK(reachable[k] < entities, "typing %s can reach entity %d of %d", callsigns[i],
+				    reachable[k], entities);
+				if (dxcc_entity(ctx, reachable[k], &result))
+					read_strings(&result);
+			}
+		}
+		dxcc_cursor_result(cursor, &result);
+		read_strings(&result);
+	}
+	for (int i = 0; i < entities; ++i) {
+		const char* abbreviation;
+
+		CHECK(dxcc_entity(ctx, i, &result) && result.countryname, "entity %d of %d has no name", i, entities);
+		read_strings(&result);
+		if ((abbreviation = dxcc_abbreviate(ctx, result.countryname)))
+			bytes_read += strlen(abbreviation);
+	}
+	dxcc_cursor_free(cursor);
+}
+
+/* write \a image to the snapshot with a few words changed, so that they point anywhere */
+static void corrupt(const char* image, size_t len)
+{
+	static char copy[1 << 16];
+	int words = 1 + random_below(4);
+
+	memcpy(copy, image, len);
+	while (words--) {
+		guint32 at = random_below((len - 4) / 4) * 4, value;
+
+		switch (random_below(4)) {
+		case 0:
+			value = random_below(0xffffff) << random_below(9);
+			break;
+		case 1: /* just past the end */
+			value = len + random_below(64);
+			break;
+		case 2:
+			value = ~random_below(256);
+			break;
+		default: /* a bit flipped */
+			memcpy(&value, copy + at, 4);
+			value ^= 1u << random_below(32);
+			break;
+		}
+		memcpy(copy + at, &value, 4);
+	}
+	write_file(snapshot, copy, len);
+}
+
+int main(void)
+{
+	char fixture[4096], *text, *image, *w1aw, *england;
+	size_t text_len, image_len;
+	struct timespec times[2];
+	dxcc_context* ctx;
+	ino_t inode;
+
+	set_data_path_relative(fixture, sizeof(fixture), TEST_CTY_DAT);
+	CHECK((text = read_file(fixture, &text_len)), "can't read %s", fixture);
+	CHECK(mkdtemp(dir), "can't make %s", dir);
+	if (check_failures)
+		return check_result("snapshot");
+	snprintf(cty_dat, sizeof(cty_dat), "%s/cty.dat", dir);
+	snprintf(snapshot, sizeof(snapshot), "%s/cty.dat.bin", dir);
+	write_file(cty_dat, text, text_len);
+
+	/* the first load writes the snapshot, and the second maps it */
+	ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx && !strcmp(entity_of(ctx, "W1AW"), "United States"), "the first load is wrong");
+	dxcc_context_free(ctx);
+	inode = snapshot_inode();
+	CHECK(inode, "no snapshot was written");
+	ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx && !strcmp(entity_of(ctx, "W1AW"), "United States"), "the second load is wrong");
+	CHECK(snapshot_inode() == inode, "the snapshot was written again, when it was up to date");
+	dxcc_context_free(ctx);
+
+	/* W1AW moves to England, and cty.dat is the same size, but newer */
+	w1aw = strstr(text, "=W1AW,");
+	england = strstr(text, "2E,G,M,");
+	CHECK(w1aw && england && england > w1aw, "%s isn't as expected", fixture);
+	if (check_failures)
+		return check_result("snapshot");
+	memmove(w1aw, w1aw + 6, england + 7 - (w1aw + 6));
+	memcpy(england + 1, "=W1AW,", 6);
+	write_file(cty_dat, text, text_len);
+	clock_gettime(CLOCK_REALTIME, &times[0]);
+	times[0].tv_sec += 10;
+	times[1] = times[0];
+	utimensat(AT_FDCWD, cty_dat, times, 0);
+	ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx && !strcmp(entity_of(ctx, "W1AW"), "England"), "the stale snapshot was used");
+	CHECK(snapshot_inode() != inode, "the stale snapshot wasn't written again");
+	dxcc_context_free(ctx);
+	inode = snapshot_inode();
+	ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+	CHECK(ctx && !strcmp(entity_of(ctx, "W1AW"), "England"), "the new snapshot is wrong");
+	CHECK(snapshot_inode() == inode, "the new snapshot wasn't used");
+	dxcc_context_free(ctx);
+
+	/* corrupt it */
+	CHECK((image = read_file(snapshot, &image_len)) && image_len < 1 << 16, "can't read the snapshot");
+	if (check_failures)
+		return check_result("snapshot");
+	for (int i = 0; i < CORRUPTIONS; ++i) {
+		corrupt(image, image_len);
+		ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+		CHECK(ctx, "corruption %d: can't load", i);
+		if (ctx)
+			use(ctx);
+		dxcc_context_free(ctx);
+	}
+
+	/* and truncate it */
+	for (size_t len = image_len - 1; len > 0; len -= 1 + len / 8) {
+		write_file(snapshot, image, len);
+		ctx = dxcc_context_load(cty_dat, TEST_ABBREV_TSV, NULL);
+		CHECK(ctx && !strcmp(entity_of(ctx, "W1AW"), "England"), "a snapshot of %zu bytes was used", len);
+		dxcc_context_free(ctx);
+	}
+
+	unlink(snapshot);
+	unlink(cty_dat);
+	rmdir(dir);
+	free(image);
+	free(text);
+	return check_result("snapshot");
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * spotindex.c - a spot_index must find what measuring every spot finds
+ *
+ * Spots are added all over the world, crowded near the north pole and on
+ * the date line, then some removed and some of those added again. Each
+ * query, from anywhere (the south polar cap and the date line too), with a
+ * small or a huge radius, is compared with qrb() to every spot still
+ * there: spot_index_within() must find exactly those within the radius,
+ * and spot_index_nearest() the k nearest, in order.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "clu.h"
+#include "check.h"
+
+#define SPOTS 3000
+#define QUERIES 2000
+
+static double lon[SPOTS], lat[SPOTS], dist[SPOTS], az[SPOTS];
+static int handle[SPOTS];
+static bool present[SPOTS];
+static unsigned int seed = 1;
+
+/* the same sequence on every run, whatever the C library */
+static double random_between(double a, double b)
+{
+	seed = seed * 1103515245u + 12345u;
+	return a + (b - a) * ((seed >> 8) & 0xffffff) / (double)0xffffff;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+int main(void)
+{
+	spot_index* index = spot_index_new();
+	static spot_hit hits[SPOTS];
+	static double sorted[SPOTS];
+	static bool found[SPOTS];
+	size_t n, m, k;
+	int i, q, within, remaining = 0;
+
+	CHECK(spot_index_add(index, 0, 181, 0) == -1 && spot_index_add(index, 0, 0, -90.5) == -1,
+	    "spots out of range were added");
+	for (i = 0; i < SPOTS; ++i) {
+		lon[i] = i % 50 ? random_between(-180, 180) : 180;
+		lat[i] = i % 10 ? random_between(-90, 90) : random_between(85, 90);
+		handle[i] = spot_index_add(index, i, lon[i], lat[i]);
+		present[i] = handle[i] >= 0;
+		CHECK(present[i], "spot %d at %g, %g wasn't added", i, lon[i], lat[i]);
+	}
+	for (i = 0; i < SPOTS; i += 3) {
+		CHECK(spot_index_remove(index, handle[i]), "spot %d wasn't removed", i);
+		present[i] = false;
+	}
+	CHECK(!spot_index_remove(index, handle[0]), "spot 0 was removed twice");
+	for (i = 0; i < SPOTS; i += 6) {
+		handle[i] = spot_index_add(index, i, lon[i], lat[i]);
+		present[i] = handle[i] >= 0;
+	}
+	for (i = 0; i < SPOTS; ++i)
+		remaining += present[i];
+	CHECK(spot_index_size(index) == (unsigned int)remaining, "%u spots, not %d", spot_index_size(index), remaining);
+
+	for (q = 0; q < QUERIES; ++q) {
+		double qlon = q % 11 ? random_between(-180, 180) : -180;
+		double qlat = q % 7 ? random_between(-90, 90) : random_between(-90, -80);
+		double radius = q % 5 ? random_between(1, 2000) : random_between(5000, 21000);
+
+		within = 0;
+		for (i = 0; i < SPOTS; ++i) {
+			if (!present[i])
+				continue;
+			qrb(qlon, qlat, lon[i], lat[i], &dist[i], &az[i]);
+			sorted[within++] = dist[i];
+		}
+		qsort(sorted, within, sizeof(double), compare_doubles);
+
+		/* within the radius: the same spots, with qrb()'s distance and azimuth */
+		n = spot_index_within(index, qlon, qlat, radius, hits, SPOTS);
+		memset(found, 0, sizeof(found));
+		for (size_t j = 0; j < n && j < SPOTS; ++j) {
+			unsigned int id = hits[j].id;
+
+			CHECK(id < SPOTS && present[id] && !found[id] && dist[id] <= radius,
+			    "query %d: spot %u shouldn't be within %g km", q, id, radius);
+			if (id < SPOTS) {
+				found[id] = true;
+				CHECK(hits[j].distance == dist[id] && hits[j].azimuth == az[id],
+				    "query %d: spot %u is %g km at %g, not %g km at %g", q, id,
+				    hits[j].distance, hits[j].azimuth, dist[id], az[id]);
+			}
+		}
+		for (i = 0; i < SPOTS; ++i)
+			CHECK(!present[i] || found[i] || dist[i] > radius, "query %d: spot %d wasn't found within %g km",
+			    q, i, radius);
+
+		/* the k nearest, nearest first */
+		k = 1 + q % 20;
+		m = spot_index_nearest(index, qlon, qlat, k, hits);
+		CHECK(m == k, "query %d: %zu nearest, not %zu", q, m, k);
+		for (size_t j = 0; j < m && j < k; ++j) {
+			CHECK(hits[j].distance == sorted[j], "query %d: nearest %zu is %g km, not %g km", q, j,
+			    hits[j].distance, sorted[j]);
+			CHECK(hits[j].id < SPOTS && present[hits[j].id] && dist[hits[j].id] == hits[j].distance,
+			    "query %d: nearest %zu isn't spot %u", q, j, hits[j].id);
+		}
+	}
+
+	/* fewer spots than asked for */
+	k = spot_index_nearest(index, 0, 0, SPOTS, hits);
+	CHECK(k == (size_t)remaining, "%zu nearest of all %d", k, remaining);
+
+	spot_index_free(index);
+	return check_result("spotindex");
+}
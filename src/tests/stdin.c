@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * stdin.c - clu reading callsigns from standard input must answer every
+ * line in order, and show each answer before it waits for more input
+ *
+ * clu is copied into a tree of its own, with the test cty.dat, and run on
+ * a pipe. First a stream of many lines, the last without a newline, is
+ * written all at once and the pipe closed; then lines are written one at
+ * a time, each only after the answer to the one before has been read, as
+ * someone typing would, which hangs unless clu flushes its output before
+ * it blocks.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "dxcc.h"
+#include "check.h"
+
+#define MANY 5000
+
+static const char* const callsigns[] = { "W1AW", "DL1ABC", "G4ABC", "K7IHZ", "VK6AB", "JA1XYZ", "F5XYZ", "GB2RN" };
+#define NCALLSIGNS (int)(sizeof(callsigns) / sizeof(callsigns[0]))
+
+static char dir[] = "/tmp/clu-stdin-XXXXXX";
+static char clu[sizeof(dir) + 32];
+
+/* copy \a from (relative to this program) to \a to in the tree, with \a mode */
+static bool copy(const char* from, const char* to, mode_t mode)
+{
+	char src[4096], dst[sizeof(dir) + 32], data[1 << 16];
+	int in, out;
+	ssize_t n;
+	bool ok = true;
+
+	set_data_path_relative(src, sizeof(src), from);
+	snprintf(dst, sizeof(dst), "%s/%s", dir, to);
+	if ((in = open(src, O_RDONLY)) < 0)
+		return false;
+	if ((out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, mode)) < 0) {
+		close(in);
+		return false;
+	}
+	while ((n = read(in, data, sizeof(data))) > 0)
+		ok &= write(out, data, n) == n;
+	close(in);
+	return close(out) == 0 && ok && n == 0;
+}
+
+static bool make_tree(void)
+{
+	char path[sizeof(dir) + 32];
+
+	if (!mkdtemp(dir))
+		return false;
+	snprintf(clu, sizeof(clu), "%s/bin/clu", dir);
+	for (const char* const* d = (const char* const[]) { "bin", "share", "share/clu", NULL }; *d; ++d) {
+		snprintf(path, sizeof(path), "%s/%s", dir, *d);
+		if (mkdir(path, 0755))
+			return false;
+	}
+	return copy("../clu", "bin/clu", 0755) && copy(TEST_CTY_DAT, "share/clu/cty.dat", 0644)
+	    && copy(TEST_ABBREV_TSV, "share/clu/abbrev.tsv", 0644);
+}
+
+static void remove_tree(void)
+{
+	static const char* const files[] = { "bin/clu", "share/clu/cty.dat", "share/clu/cty.dat.bin",
+		"share/clu/abbrev.tsv", "share/clu", "share", "bin" };
+	char path[sizeof(dir) + 32];
+
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+		remove(path);
+	}
+	rmdir(dir);
+}
+
+/* start clu, with pipes to its standard input and from its standard output */
+static pid_t start(int* to, int* from)
+{
+	int in[2], out[2];
+	pid_t pid;
+
+	if (pipe(in) || pipe(out))
+		return -1;
+	if ((pid = fork()) == 0) {
+		dup2(in[0], STDIN_FILENO);
+		dup2(out[1], STDOUT_FILENO);
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		execl(clu, "clu", (char*)NULL);
+		_exit(127);
+	}
+	close(in[0]);
+	close(out[1]);
+	*to = in[1];
+	*from = out[0];
+	return pid;
+}
+
+static bool finish(pid_t pid)
+{
+	int status;
+
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* whether \a line is clu's answer for \a callsign */
+static bool answer_ok(const char* line, const char* callsign)
+{
+	dxcc_scratch scratch;
+	dxcc_data info;
+	char expected[64];
+
+	snprintf(expected, sizeof(expected), "%s: country %d ", callsign,
+	    lookupcountry_by_callsign_r(callsign, &info, &scratch));
+	return !strncmp(line, expected, strlen(expected));
+}
+
+struct writer {
+	int fd;
+	const char* data;
+};
+
+/* write everything and close, while the main thread reads what comes back */
+static void* write_all(void* arg)
+{
+	struct writer* w = arg;
+	size_t len = strlen(w->data), sent = 0;
+	ssize_t n;
+
+	while (sent < len && (n = write(w->fd, w->data + sent, len - sent)) > 0)
+		sent += n;
+	close(w->fd);
+	return NULL;
+}
+
+static void check_stream(void)
+{
+	char *requests = malloc(MANY * 16), *answers, *line, *end;
+	size_t n = 0, size = 1 << 20, len = 0;
+	struct writer w;
+	pthread_t thread;
+	ssize_t got;
+	pid_t pid;
+	int from, i;
+
+	for (i = 0; i < MANY; ++i)
+		n += sprintf(requests + n, "%s\n", callsigns[i % NCALLSIGNS]);
+	requests[n - 1] = '\0'; /* the last line without a newline */
+	answers = malloc(size);
+	CHECK((pid = start(&w.fd, &from)) > 0, "can't run %s", clu);
+	if (pid <= 0)
+		return;
+	w.data = requests;
+	pthread_create(&thread, NULL, write_all, &w);
+	while ((got = read(from, answers + len, size - len - 1)) > 0)
+		if ((len += got) == size - 1)
+			answers = realloc(answers, size *= 2);
+	answers[len] = '\0';
+	close(from);
+	pthread_join(thread, NULL);
+	CHECK(finish(pid), "clu failed on a stream of callsigns");
+
+	for (i = 0, line = answers; i < MANY && (end = strchr(line, '\n')); ++i, line = end + 1) {
+		*end = '\0';
+		CHECK(answer_ok(line, callsigns[i % NCALLSIGNS]), "answer %d is \"%s\", not for %s", i, line,
+		    callsigns[i % NCALLSIGNS]);
+	}
+	CHECK(i == MANY && !*line, "%d answers to %d lines", i, MANY);
+	free(answers);
+	free(requests);
+}
+
+/* read one line from \a fd, waiting no more than a few seconds */
+static bool read_line(int fd, char* line, size_t size)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	size_t len = 0;
+
+	while (len < size - 1 && poll(&pfd, 1, 5000) == 1 && read(fd, line + len, 1) == 1)
+		if (line[len++] == '\n')
+			break;
+	line[len] = '\0';
+	return len > 0 && line[len - 1] == '\n';
+}
+
+static void check_interactive(void)
+{
+	char line[256];
+	int to, from;
+	pid_t pid;
+
+	CHECK((pid = start(&to, &from)) > 0, "can't run %s", clu);
+	if (pid <= 0)
+		return;
+	for (int i = 0; i < NCALLSIGNS; ++i) {
+		const char* callsign = callsigns[i];
+		bool answered;
+
+		dprintf(to, "%s\n", callsign);
+		answered = read_line(from, line, sizeof(line));
+		CHECK(answered && answer_ok(line, callsign), "typing %s gave \"%s\"%s", callsign, line,
+		    answered ? "" : " before waiting for more");
+		if (!answered)
+			break;
+	}
+	close(to);
+	CHECK(read(from, line, sizeof(line)) == 0, "clu said more than it was asked");
+	close(from);
+	CHECK(finish(pid), "clu failed on typed callsigns");
+}
+
+int main(void)
+{
+	CHECK(loadctydata(TEST_CTY_DAT, TEST_ABBREV_TSV) == 0, "can't load %s", TEST_CTY_DAT);
+	CHECK(make_tree(), "can't copy clu and its data into %s", dir);
+	if (!check_failures) {
+		signal(SIGPIPE, SIG_IGN);
+		check_stream();
+		check_interactive();
+	}
+	remove_tree();
+	return check_result("stdin");
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * stress.c - look things up from many threads while the tables change
+ *
+ * Reader threads share one context, and also look up through the global
+ * tables (directly, through each thread's cache, and in batches on the
+ * thread pool), checking every result. Meanwhile other threads load and
+ * free contexts of their own, and replace the global tables over and over,
+ * both by parsing cty.dat and by mapping the snapshot. (So fast that the
+ * strings in results from the global tables may be gone by the time they
+ * are compared: they only last until the tables are replaced twice more.
+ * The numbers are checked instead.)
+ *
+ * make check runs it as is; make check-tsan builds it and the library with
+ * -fsanitize=thread, which reports any data race.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "dxcc.h"
+#include "check.h"
+
+#define READERS 4
+#define LOADERS 2
+#define SWAPPERS 2
+#define RELOADS 25 /* by each loader and swapper */
+#define BATCH 3000
+
+static const char* const calls[] = {
+	"K7IHZ", "W1AW", "JA1XYZ", "VK2AB", "LB2JK", "K0AR/2", "DL/K7IHZ", "KH6/W1AW",
+	"VP8/S", "VE2IM", "UA9XX/1", "TM2025", "XX9XX", "K7IHZ/P",
+};
+#define NCALLS (sizeof(calls) / sizeof(calls[0]))
+
+static dxcc_context* shared;
+static dxcc_data expected[NCALLS];
+static atomic_bool stop;
+static pthread_mutex_t failures_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* whether \a a is \a expected; its strings too, if \a strings */
+static bool same(const dxcc_data* a, const dxcc_data* expected, bool strings)
+{
+	return a->country == expected->country && a->cq == expected->cq && a->itu == expected->itu
+	    && (!strings || (!strcmp(a->countryname, expected->countryname) && !strcmp(a->px, expected->px)));
+}
+
+static void failed(const char* how, const char* call)
+{
+	pthread_mutex_lock(&failures_lock);
+	CHECK(false, "%s(\"%s\") gave the wrong entity", how, call);
+	pthread_mutex_unlock(&failures_lock);
+}
+
+static void* reader(void* arg)
+{
+	static const char* batch[BATCH];
+	static dxcc_data results[BATCH];
+	bool batches = arg != NULL; /* only one reader, since they're static */
+	dxcc_scratch scratch;
+	dxcc_data result;
+
+	for (int i = 0; batches && i < BATCH; ++i)
+		batch[i] = calls[i % NCALLS];
+	while (!atomic_load(&stop)) {
+		for (size_t i = 0; i < NCALLS; ++i) {
+			dxcc_lookup(shared, calls[i], &result, &scratch);
+			if (!same(&result, &expected[i], true))
+				failed("dxcc_lookup", calls[i]);
+			lookupcountry_by_callsign_r(calls[i], &result, &scratch);
+			if (!same(&result, &expected[i], false))
+				failed("lookupcountry_by_callsign_r", calls[i]);
+			result = lookupcountry_by_callsign(calls[i]);
+			if (!same(&result, &expected[i], false))
+				failed("lookupcountry_by_callsign", calls[i]);
+		}
+		if (batches) {
+			lookupcountry_batch(batch, results, BATCH);
+			for (int i = 0; i < BATCH; ++i)
+				if (!same(&results[i], &expected[i % NCALLS], false))
+					failed("lookupcountry_batch", batch[i]);
+		}
+	}
+	return NULL;
+}
+
+static void* loader(void* arg)
+{
+	dxcc_scratch scratch;
+	dxcc_data result;
+
+	(void)arg;
+	for (int r = 0; r < RELOADS; ++r) {
+		dxcc_context* ctx = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+
+		if (!ctx) {
+			failed("dxcc_context_load", TEST_CTY_DAT);
+			continue;
+		}
+		for (size_t i = 0; i < NCALLS; ++i) {
+			dxcc_lookup(ctx, calls[i], &result, &scratch);
+			if (!same(&result, &expected[i], true))
+				failed("dxcc_lookup in a new context", calls[i]);
+		}
+		dxcc_context_free(ctx);
+	}
+	return NULL;
+}
+
+static void* swapper(void* arg)
+{
+	for (int r = 0; r < RELOADS; ++r) {
+		/* half of them parse cty.dat, and half map the snapshot */
+		int ret = (r + (arg != NULL)) % 2 ? readctydata(TEST_CTY_DAT)
+		    : loadctydata(TEST_CTY_DAT, TEST_ABBREV_TSV);
+
+		if (ret)
+			failed("loadctydata", TEST_CTY_DAT);
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t readers[READERS], loaders[LOADERS], swappers[SWAPPERS];
+	dxcc_scratch scratch;
+
+	shared = dxcc_context_load(TEST_CTY_DAT, TEST_ABBREV_TSV, NULL);
+	CHECK(shared, "can't load %s", TEST_CTY_DAT);
+	if (!shared || loadctydata(TEST_CTY_DAT, TEST_ABBREV_TSV))
+		return check_result("stress");
+	for (size_t i = 0; i < NCALLS; ++i)
+		dxcc_lookup(shared, calls[i], &expected[i], &scratch);
+	lookupcountry_cache(64);
+
+	for (int i = 0; i < READERS; ++i)
+		pthread_create(&readers[i], NULL, reader, i ? NULL : &readers[i]);
+	for (int i = 0; i < LOADERS; ++i)
+		pthread_create(&loaders[i], NULL, loader, NULL);
+	for (int i = 0; i < SWAPPERS; ++i)
+		pthread_create(&swappers[i], NULL, swapper, i ? &swappers[i] : NULL);
+	for (int i = 0; i < LOADERS; ++i)
+		pthread_join(loaders[i], NULL);
+	for (int i = 0; i < SWAPPERS; ++i)
+		pthread_join(swappers[i], NULL);
+	atomic_store(&stop, true);
+	for (int i = 0; i < READERS; ++i)
+		pthread_join(readers[i], NULL);
+
+	dxcc_context_free(shared);
+	cleanup_dxcc();
+	return check_result("stress");
+}
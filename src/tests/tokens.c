@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * tokens.c - scan_tokens() must find the words strtok() would, and
+ * classify them as token_kind() does
+ *
+ * A few words are checked by name, then random text made of words like
+ * the ones in ALL.TXT, with runs of separators and words of every length
+ * up to past 64 characters, so that words run across the blocks
+ * scan_tokens() reads.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "clu.h"
+#include "check.h"
+
+#define TEXT_SIZE (1 << 20)
+#define MAX_SPANS (TEXT_SIZE / 2)
+
+static const struct
+{
+	const char* word;
+	int kind;
+} words[] = {
+	{ "K7IHZ", TOKEN_CALLSIGN }, { "TM2025", TOKEN_CALLSIGN }, { "VP8/S", TOKEN_CALLSIGN },
+	{ "DL/K7IHZ", TOKEN_CALLSIGN }, { "K0AR/2", TOKEN_CALLSIGN }, { "2E0ABC", TOKEN_CALLSIGN },
+	{ "w1aw", TOKEN_CALLSIGN }, { "3D2/R", TOKEN_CALLSIGN }, { "A61", TOKEN_CALLSIGN },
+	{ "DM43", TOKEN_GRID }, { "JO59", TOKEN_GRID }, { "PM95ab", TOKEN_GRID }, { "FN31pr44", TOKEN_GRID },
+	{ "CQ", TOKEN_OTHER }, { "73", TOKEN_OTHER }, { "RR73", TOKEN_GRID }, { "rr73", TOKEN_OTHER },
+	{ "RRR", TOKEN_OTHER }, { "-12", TOKEN_OTHER }, { "R-12", TOKEN_OTHER }, { "+05", TOKEN_OTHER },
+	{ "599", TOKEN_OTHER }, { "5NN", TOKEN_OTHER }, { "55N", TOKEN_OTHER }, { "TNX", TOKEN_OTHER },
+	{ "K7", TOKEN_OTHER }, { "K7IHZ/", TOKEN_CALLSIGN }, { "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456", TOKEN_OTHER },
+};
+
+static unsigned int seed = 1;
+
+/* the same sequence on every run, whatever the C library */
+static unsigned int next_random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) & 0x7fff;
+}
+
+int main(void)
+{
+	static const char alphabet[] = "AKNRZaknrz0357/+-";
+	static const char separators[] = " \t\r\n";
+	char* text = malloc(TEXT_SIZE + 1);
+	char* copy = malloc(TEXT_SIZE + 1);
+	token_span* spans = malloc(MAX_SPANS * sizeof(token_span));
+	size_t size = 0, count, i;
+	char *word, *save;
+
+	for (i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+		int kind = token_kind(words[i].word, strlen(words[i].word));
+
+		CHECK(kind == words[i].kind, "%s is kind %d, not %d", words[i].word, kind, words[i].kind);
+	}
+
+	/* the words above, random ones, and now and then a long one */
+	while (size < TEXT_SIZE - 200) {
+		unsigned int r = next_random() % 16, len;
+
+		if (r < 6) {
+			const char* w = words[next_random() % (sizeof(words) / sizeof(words[0]))].word;
+
+			memcpy(text + size, w, strlen(w));
+			size += strlen(w);
+		} else {
+			len = 1 + (r == 15 ? next_random() % 100 : next_random() % 10);
+			for (i = 0; i < len; ++i)
+				text[size++] = alphabet[next_random() % (sizeof(alphabet) - 1)];
+		}
+		len = 1 + (next_random() % 8 == 0 ? next_random() % 70 : 0);
+		for (i = 0; i < len; ++i)
+			text[size++] = separators[next_random() % (sizeof(separators) - 1)];
+	}
+
+	count = scan_tokens(text, size, spans, MAX_SPANS, NULL);
+	memcpy(copy, text, size);
+	copy[size] = '\0';
+	i = 0;
+	for (word = strtok_r(copy, separators, &save); word; word = strtok_r(NULL, separators, &save), ++i) {
+		size_t len = strlen(word);
+
+		if (i >= count) {
+			CHECK(false, "scan_tokens() found %zu words, strtok() more", count);
+			break;
+		}
+		CHECK(spans[i].start == (size_t)(word - copy) && spans[i].length == len,
+		    "word %zu is at %zu, length %zu, not at %zu, length %u", i, (size_t)(word - copy), len,
+		    spans[i].start, spans[i].length);
+		CHECK(spans[i].kind == token_kind(word, len), "%.*s: scan_tokens() says kind %d, token_kind() %d",
+		    (int)len, word, spans[i].kind, token_kind(word, len));
+		CHECK(spans[i].line_start == (i == 0 || memchr(text + spans[i - 1].start, '\n',
+		    spans[i].start - spans[i - 1].start)), "word %zu: line_start is wrong", i);
+	}
+	CHECK(i == count, "strtok() found %zu words, scan_tokens() %zu", i, count);
+
+	free(spans);
+	free(copy);
+	free(text);
+	return check_result("tokens");
+}
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * zonemap.c - zone_map_locate() must agree with testing every polygon
+ *
+ * A zones.dat of random polygons is written to a temporary file: star
+ * shapes of 3 to 60 vertices and all sizes, a third of them with their
+ * vertices on whole and half degrees, as real zone maps often are, plus a
+ * polar cap and a box against the 180th meridian. Then 400,000 locations,
+ * many of them on whole and half degrees too, are located with the map and
+ * by casting a ray against every polygon; the first polygon of each layer
+ * that holds a location is the one that counts. Locations on an edge are
+ * skipped, since which side they fall is a matter of rounding.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "clu.h"
+#include "check.h"
+
+#define POLYGONS 202
+#define MAX_VERTICES 60
+#define LOCATIONS 400000
+
+typedef struct
+{
+	int layer, zone;
+	char entity[16];
+	int n;
+	double x[MAX_VERTICES], y[MAX_VERTICES];
+	double min_x, min_y, max_x, max_y;
+} test_polygon;
+
+static test_polygon polygons[POLYGONS];
+static unsigned int seed = 5;
+
+/* the same sequence on every run, whatever the C library */
+static double random_between(double a, double b)
+{
+	seed = seed * 1103515245u + 12345u;
+	return a + (b - a) * ((seed >> 8) & 0xffffff) / (double)0xffffff;
+}
+
+static double clamp(double v, double lo, double hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void add_vertex(test_polygon* p, double x, double y)
+{
+	p->x[p->n] = x;
+	p->y[p->n] = y;
+	p->min_x = p->n ? fmin(p->min_x, x) : x;
+	p->max_x = p->n ? fmax(p->max_x, x) : x;
+	p->min_y = p->n ? fmin(p->min_y, y) : y;
+	p->max_y = p->n ? fmax(p->max_y, y) : y;
+	++p->n;
+}
+
+static bool inside(const test_polygon* p, double x, double y)
+{
+	bool in = false;
+
+	for (int i = 0, j = p->n - 1; i < p->n; j = i++) {
+		if ((p->y[i] > y) != (p->y[j] > y)
+		    && x < p->x[i] + (y - p->y[i]) * (p->x[j] - p->x[i]) / (p->y[j] - p->y[i]))
+			in = !in;
+	}
+	return in;
+}
+
+/* whether \a x, \a y is on (or all but on) an edge of \a p */
+static bool on_edge(const test_polygon* p, double x, double y)
+{
+	for (int i = 0, j = p->n - 1; i < p->n; j = i++) {
+		double dx = p->x[j] - p->x[i], dy = p->y[j] - p->y[i], l = dx * dx + dy * dy;
+		double t = l ? ((x - p->x[i]) * dx + (y - p->y[i]) * dy) / l : 0;
+
+		t = clamp(t, 0, 1);
+		if (hypot(x - p->x[i] - t * dx, y - p->y[i] - t * dy) < 1e-7)
+			return true;
+	}
+	return false;
+}
+
+/* make the polygons, and write them to \a f as zones.dat */
+static void write_polygons(FILE* f)
+{
+	static const char* const layers[] = { "CQ", "ITU", "DXCC" };
+
+	fprintf(f, "# random polygons\n");
+	for (int i = 0; i < POLYGONS - 2; ++i) {
+		test_polygon* p = &polygons[i];
+		double cx = random_between(-170, 170), cy = random_between(-80, 80), r = random_between(0.3, 25);
+		int n = 3 + (int)random_between(0, MAX_VERTICES - 3);
+
+		p->layer = i % 3;
+		p->zone = i + 1;
+		snprintf(p->entity, sizeof(p->entity), "P%d", i);
+		for (int k = 0; k < n; ++k) {
+			double a = 2 * M_PI * k / n, rr = r * random_between(0.3, 1);
+			double x = clamp(cx + rr * cos(a), -180, 180), y = clamp(cy + rr * sin(a), -90, 90);
+
+			if (i % 3 == 0) {
+				x = round(x);
+				y = round(y * 2) / 2;
+			}
+			add_vertex(p, x, y);
+		}
+	}
+	/* a polar cap, and a box against the 180th meridian */
+	polygons[POLYGONS - 2].layer = ZONE_CQ;
+	polygons[POLYGONS - 2].zone = 999;
+	add_vertex(&polygons[POLYGONS - 2], -180, 80);
+	add_vertex(&polygons[POLYGONS - 2], 180, 80);
+	add_vertex(&polygons[POLYGONS - 2], 180, 90);
+	add_vertex(&polygons[POLYGONS - 2], -180, 90);
+	polygons[POLYGONS - 1].layer = ZONE_ITU;
+	polygons[POLYGONS - 1].zone = 998;
+	add_vertex(&polygons[POLYGONS - 1], 170, -10);
+	add_vertex(&polygons[POLYGONS - 1], 180, -10);
+	add_vertex(&polygons[POLYGONS - 1], 180, 10);
+	add_vertex(&polygons[POLYGONS - 1], 170, 10);
+
+	for (int i = 0; i < POLYGONS; ++i) {
+		const test_polygon* p = &polygons[i];
+
+		if (p->layer == ZONE_ENTITY)
+			fprintf(f, "%s %s", layers[p->layer], p->entity);
+		else
+			fprintf(f, "%s %d", layers[p->layer], p->zone);
+		for (int k = 0; k < p->n; ++k)
+			fprintf(f, " %.17g,%.17g", p->x[k], p->y[k]);
+		/* one line ends as on Windows */
+		fprintf(f, i == POLYGONS - 1 ? "\r\n" : "\n");
+	}
+}
+
+int main(void)
+{
+	char path[] = "/tmp/clu-zones-XXXXXX";
+	int fd = mkstemp(path), cq, itu, skipped = 0;
+	FILE* f = fd >= 0 ? fdopen(fd, "w") : NULL;
+	const char* entity;
+	zone_location z;
+	zone_map* map;
+
+	CHECK(f, "can't make a temporary file");
+	if (!f)
+		return check_result("zonemap");
+	write_polygons(f);
+	fclose(f);
+	map = zone_map_load(path);
+	unlink(path);
+	CHECK(map, "can't load the polygons");
+	CHECK(!zone_map_load("/nonexistent/zones.dat"), "loaded a file that isn't there");
+	if (!map)
+		return check_result("zonemap");
+
+	for (int q = 0; q < LOCATIONS; ++q) {
+		double x = random_between(-180, 180), y = random_between(-90, 90);
+		bool edge = false;
+
+		if (q % 4 == 0) {
+			x = round(x);
+			y = floor(y) + 0.5;
+		}
+		if (q % 13 == 0) {
+			x = round(x);
+			y = round(y);
+		}
+		if (q == 1) {
+			x = 180;
+			y = 90;
+		}
+		cq = itu = 0;
+		entity = NULL;
+		for (int i = 0; i < POLYGONS; ++i) {
+			const test_polygon* p = &polygons[i];
+
+			if (x < p->min_x - 1e-6 || x > p->max_x + 1e-6 || y < p->min_y - 1e-6 || y > p->max_y + 1e-6)
+				continue;
+			edge |= on_edge(p, x, y);
+			if (!inside(p, x, y))
+				continue;
+			if (p->layer == ZONE_CQ && !cq)
+				cq = p->zone;
+			else if (p->layer == ZONE_ITU && !itu)
+				itu = p->zone;
+			else if (p->layer == ZONE_ENTITY && !entity)
+				entity = p->entity;
+		}
+		if (edge) {
+			++skipped;
+			continue;
+		}
+		CHECK(zone_map_locate(map, x, y, &z) == (cq || itu || entity),
+		    "%g,%g: wrong about being in any polygon", x, y);
+		CHECK(z.cq == cq && z.itu == itu && (z.entity == NULL) == (entity == NULL)
+		    && (!entity || !strcmp(entity, z.entity)),
+		    "%g,%g: in CQ %d ITU %d %s, not CQ %d ITU %d %s", x, y, z.cq, z.itu,
+		    z.entity ? z.entity : "-", cq, itu, entity ? entity : "-");
+	}
+	CHECK(skipped < LOCATIONS / 10, "%d locations were on edges", skipped);
+	CHECK(!zone_map_locate(map, 180.5, 0, &z) && !zone_map_locate(map, 0, NAN, &z),
+	    "located a place out of range");
+
+	zone_map_free(map);
+	return check_result("zonemap");
+}
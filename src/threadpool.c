@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * threadpool.c - split work on large arrays across a pool of threads
+ *
+ * The workers are started on first use: one less than the number of
+ * online CPUs (or CLU_THREADS, if set), because the calling thread works
+ * too. They claim chunks of the array until there are none left, so
+ * uneven chunks balance out. One job runs at a time; if another thread
+ * calls threadpool_run() meanwhile, it does its job by itself.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "threadpool.h"
+
+typedef struct
+{
+	threadpool_fn fn;
+	void* data;
+	size_t count;
+	size_t chunk;
+	atomic_size_t next; /* start of the next unclaimed chunk */
+} threadpool_job;
+
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER; /* one job at a time */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER; /* protects the rest */
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t* workers;
+static int nworkers;
+static threadpool_job* job;
+static unsigned job_generation;
+static unsigned start_generation; /* job_generation when the workers were started */
+static int busy;
+static bool started;
+static bool stopping;
+
+static void work(threadpool_job* j, int worker)
+{
+	size_t begin, end;
+
+	while ((begin = atomic_fetch_add(&j->next, j->chunk)) < j->count) {
+		end = begin + j->chunk < j->count ? begin + j->chunk : j->count;
+		j->fn(j->data, worker, begin, end);
+	}
+}
+
+static void* worker_main(void* arg)
+{
+	int worker = (int)(long)arg;
+	unsigned seen = start_generation;
+
+	pthread_mutex_lock(&pool_lock);
+	for (;;) {
+		while (!stopping && job_generation == seen)
+			pthread_cond_wait(&pool_wake, &pool_lock);
+		if (stopping)
+			break;
+		seen = job_generation;
+		threadpool_job* j = job;
+		pthread_mutex_unlock(&pool_lock);
+		work(j, worker);
+		pthread_mutex_lock(&pool_lock);
+		if (--busy == 0)
+			pthread_cond_signal(&pool_idle);
+	}
+	pthread_mutex_unlock(&pool_lock);
+	return NULL;
+}
+
+static void start_workers(void)
+{
+	const char* env = getenv("CLU_THREADS");
+	long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+	sigset_t all, old;
+
+	pthread_mutex_lock(&pool_lock);
+	if (!started) {
+		started = true;
+		stopping = false;
+		start_generation = job_generation;
+		nworkers = 0;
+		if (n > 1)
+			workers = malloc((n - 1) * sizeof(pthread_t));
+		/* workers block all signals, so that they go to the application's threads */
+		sigfillset(&all);
+		pthread_sigmask(SIG_SETMASK, &all, &old);
+		while (nworkers < n - 1
+		    && !pthread_create(&workers[nworkers], NULL, worker_main, (void*)(long)(nworkers + 1)))
+			++nworkers;
+		pthread_sigmask(SIG_SETMASK, &old, NULL);
+	}
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/* the number of threads that may run a job's function, including the caller */
+int threadpool_size(void)
+{
+	start_workers();
+	return nworkers + 1;
+}
+
+/*!
+    Call \a fn on consecutive ranges of up to \a chunk items, which together
+    cover 0 .. \a count - 1, spread over the pool. Returns when all are done.
+ */
+void threadpool_run(threadpool_fn fn, void* data, size_t count, size_t chunk)
+{
+	threadpool_job j = { fn, data, count, chunk ? chunk : 1, 0 };
+
+	start_workers();
+	if (count <= j.chunk || pthread_mutex_trylock(&run_lock)) {
+		work(&j, 0);
+		return;
+	}
+	if (!nworkers) {
+		work(&j, 0);
+		pthread_mutex_unlock(&run_lock);
+		return;
+	}
+
+	pthread_mutex_lock(&pool_lock);
+	job = &j;
+	busy = nworkers;
+	++job_generation;
+	pthread_cond_broadcast(&pool_wake);
+	pthread_mutex_unlock(&pool_lock);
+
+	work(&j, 0);
+
+	pthread_mutex_lock(&pool_lock);
+	while (busy)
+		pthread_cond_wait(&pool_idle, &pool_lock);
+	job = NULL;
+	pthread_mutex_unlock(&pool_lock);
+	pthread_mutex_unlock(&run_lock);
+}
+
+/* stop the workers; the next threadpool_run() starts them again */
+void threadpool_shutdown(void)
+{
+	int i;
+
+	pthread_mutex_lock(&run_lock);
+	pthread_mutex_lock(&pool_lock);
+	stopping = true;
+	pthread_cond_broadcast(&pool_wake);
+	pthread_mutex_unlock(&pool_lock);
+	for (i = 0; i < nworkers; ++i)
+		pthread_join(workers[i], NULL);
+	free(workers);
+	workers = NULL;
+	nworkers = 0;
+	started = false;
+	pthread_mutex_unlock(&run_lock);
+}
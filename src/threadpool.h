@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * threadpool.h - split work on large arrays across a pool of threads
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+
+/*
+ * Process items [begin, end) of the array described by \a data.
+ * \a worker is in 0 .. threadpool_size() - 1, and no two ranges are being
+ * processed with the same \a worker at the same time during one
+ * threadpool_run(), so it can index per-thread state.
+ */
+typedef void (*threadpool_fn)(void* data, int worker, size_t begin, size_t end);
+
+void threadpool_run(threadpool_fn fn, void* data, size_t count, size_t chunk);
+int threadpool_size(void);
+void threadpool_shutdown(void);
+
+#endif /* THREADPOOL_H */
@@ -0,0 +1,301 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * tokenscan.c - find the words in a buffer of text that could be
+ * callsigns or grids, without copying them
+ *
+ * The text is taken 64 bytes at a time. Each block is compared 16 bytes at a
+ * time against the character classes that matter (separators, newlines,
+ * digits, letters, and the letters allowed in grids), and each comparison is
+ * reduced to one bit per byte, so that a block becomes a few 64-bit masks.
+ * The word boundaries are then where the separator mask changes, and each
+ * word is classified by shifting, masking and comparing those bits (of its
+ * block and the next, if it runs on), a whole word at once. Only words of
+ * 64 characters or more are looked at one character at a time, by
+ * token_kind().
+ */
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "clu.h"
+
+#define BLOCK 64
+
+/* the positions in a grid of letters (including the first two) and of digits */
+#define GRID_LETTERS 0x3333333333333333ULL
+#define GRID_DIGITS 0xccccccccccccccccULL
+
+typedef unsigned char vbyte __attribute__((vector_size(16)));
+typedef signed char vmask __attribute__((vector_size(16)));
+
+/*
+   bit i of each mask is about byte i of a block: whether it's a separator or a
+   newline; whether it's not a digit, not a letter allowed in a grid after the
+   first two, or not one allowed in the first two; whether it can't be in a
+   callsign; and whether it's a digit, or a letter, one of each being what
+   makes a word look like a callsign
+ */
+typedef struct
+{
+	uint64_t sep, newline, not_digit, not_sub, not_field, not_callsign, digit, alpha;
+} block_classes;
+
+/* one bit from each byte of the result of a vector comparison */
+static inline uint64_t bits(vmask v)
+{
+#if defined(__SSE2__)
+	return (unsigned int)_mm_movemask_epi8((__m128i)v);
+#elif defined(__aarch64__)
+	const uint8x16_t weights = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint8x16_t m = vandq_u8((uint8x16_t)v, weights);
+
+	return vaddv_u8(vget_low_u8(m)) | (unsigned int)vaddv_u8(vget_high_u8(m)) << 8;
+#else
+	uint64_t ret = 0;
+
+	for (int i = 0; i < 16; ++i)
+		ret |= (uint64_t)(v[i] & 1) << i;
+	return ret;
+#endif
+}
+
+static inline void classify_block(const char* p, block_classes* c)
+{
+	uint64_t slash = 0, sub = 0, field = 0;
+
+	c->sep = c->newline = c->digit = c->alpha = 0;
+	for (int i = 0; i < BLOCK; i += 16) {
+		vbyte v, folded;
+
+		memcpy(&v, p + i, sizeof(v));
+		/* letters of either case to 0..25 */
+		folded = (v | 0x20) - 'a';
+		c->sep |= bits((v == ' ') | (v == '\t') | (v == '\r') | (v == '\n')) << i;
+		c->newline |= bits(v == '\n') << i;
+		c->digit |= bits((vbyte)(v - '0') < 10) << i;
+		c->alpha |= bits(folded < 26) << i;
+		sub |= bits(folded < 24) << i;
+		field |= bits((vbyte)(v - 'A') < 18) << i;
+		slash |= bits(v == '/') << i;
+	}
+	c->not_digit = ~c->digit;
+	c->not_sub = ~sub;
+	c->not_field = ~field;
+	c->not_callsign = ~(c->digit | c->alpha | slash);
+}
+
+/* rotate left, for the repeating pattern of a grid */
+static inline uint64_t rotl(uint64_t x, int n)
+{
+	return (x << n) | (x >> ((BLOCK - n) & (BLOCK - 1)));
+}
+
+/*
+   token_kind() of the \a len bytes of block \a lo in \a lo_mask, starting
+   at \a s, and running on into the bytes of the next block \a hi in
+   \a hi_mask; without branches, since from one word to the next they would
+   be unpredictable
+ */
+static inline int block_token_kind(const block_classes* lo, uint64_t lo_mask,
+    const block_classes* hi, uint64_t hi_mask, int s, size_t len)
+{
+	uint64_t letters = rotl(GRID_LETTERS, s & 3), digits = ~letters;
+	uint64_t first_two = (lo->not_field >> s) | ((hi->not_field << 1) << (BLOCK - 1 - s));
+	bool grid, callsign;
+
+	grid = (len >= 4) & !(len & 1) & !(first_two & 3)
+	    & !(((lo->not_sub & lo_mask) | (hi->not_sub & hi_mask)) & letters)
+	    & !(((lo->not_digit & lo_mask) | (hi->not_digit & hi_mask)) & digits);
+	callsign = (len >= 3) & (len <= DXCC_MAX_CALLSIGN)
+	    & !((lo->not_callsign & lo_mask) | (hi->not_callsign & hi_mask))
+	    & !!((lo->digit & lo_mask) | (hi->digit & hi_mask))
+	    & !!((lo->alpha & lo_mask) | (hi->alpha & hi_mask));
+	return grid * TOKEN_GRID + (callsign & !grid) * TOKEN_CALLSIGN;
+}
+
+static inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool is_alpha(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/*
+   whether the \a len characters at \a token, which look like a callsign,
+   are one of the words that only look like one: RR73, or a CW report with
+   cut numbers, like 5NN or 55N
+ */
+static inline bool is_non_call(const char* token, size_t len)
+{
+	if (len == 4)
+		return (token[0] | 0x20) == 'r' && (token[1] | 0x20) == 'r' && token[2] == '7' && token[3] == '3';
+	return len == 3 && token[0] >= '1' && token[0] <= '5'
+	    && (is_digit(token[1]) || (token[1] | 0x20) == 'n') && (is_digit(token[2]) || (token[2] | 0x20) == 'n');
+}
+
+/* \a kind, the kind of a word, unless the word only looks like a callsign */
+static inline int drop_non_call(int kind, const char* token, size_t len)
+{
+	if (kind == TOKEN_CALLSIGN && len <= 4 && is_non_call(token, len))
+		return TOKEN_OTHER;
+	return kind;
+}
+
+/*!
+    Classify the \a len characters at \a token: TOKEN_GRID if is_grid()
+    would accept them; TOKEN_CALLSIGN if they look like a callsign, that is,
+    3 to DXCC_MAX_CALLSIGN letters, digits and slashes, with at least one
+    letter and one digit (so "TM2025" and "VP8/S", but not "CQ", "73" or
+    "-12"), and not a CW report like "5NN", or "rr73" (in capitals, it's a
+    grid); otherwise TOKEN_OTHER.
+ */
+int token_kind(const char* token, size_t len)
+{
+	bool grid = len >= 4 && len % 2 == 0, digit = false, alpha = false;
+	size_t i;
+
+	for (i = 0; grid && i < len; ++i) {
+		char c = token[i];
+
+		if (i < 2)
+			grid = c >= 'A' && c <= 'R';
+		else if (i % 4 < 2)
+			grid = (c >= 'A' && c <= 'X') || (c >= 'a' && c <= 'x');
+		else
+			grid = is_digit(c);
+	}
+	if (grid)
+		return TOKEN_GRID;
+	if (len < 3 || len > DXCC_MAX_CALLSIGN)
+		return TOKEN_OTHER;
+	for (i = 0; i < len; ++i) {
+		if (!is_digit(token[i]) && !is_alpha(token[i]) && token[i] != '/')
+			return TOKEN_OTHER;
+		digit |= is_digit(token[i]);
+		alpha |= is_alpha(token[i]);
+	}
+	return drop_non_call(digit && alpha ? TOKEN_CALLSIGN : TOKEN_OTHER, token, len);
+}
+
+/*!
+    Find the words in the \a size bytes of \a text, separated by spaces,
+    tabs, carriage returns and newlines, and put up to \a max_spans of them
+    into \a spans, classified by token_kind(). The first word after a newline
+    has line_start set, and so does the first word found, as if \a text began
+    a line. The text is not modified or copied, and needn't be terminated.
+
+    Returns the number of spans found. If that is \a max_spans, there may be
+    more: \a scanned (if not NULL) is set to the offset after the last one,
+    from which to scan the rest; otherwise it's set to \a size.
+ */
+size_t scan_tokens(const char* text, size_t size, token_span* spans, size_t max_spans, size_t* scanned)
+{
+	block_classes classes[2] = { 0 }, *c = &classes[0], *prev = &classes[1], *swap;
+	char tail[BLOCK];
+	size_t count = 0, base, start = 0;
+	bool in_token = false, line_start = true;
+	uint64_t prev_sep = 1; /* as if a separator came before the text */
+
+	if (scanned)
+		*scanned = size;
+	if (!max_spans)
+		return 0;
+	for (base = 0; base < size; base += BLOCK) {
+		const char* block = text + base;
+		uint64_t starts, ends, newlines, before;
+		token_span* span;
+
+		if (size - base < BLOCK) {
+			/* pad the last block with separators */
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, block, size - base);
+			block = tail;
+		}
+		swap = prev;
+		prev = c;
+		c = swap;
+		classify_block(block, c);
+		starts = ~c->sep & ((c->sep << 1) | prev_sep);
+		ends = c->sep & ~((c->sep << 1) | prev_sep);
+		prev_sep = c->sep >> (BLOCK - 1);
+		newlines = c->newline;
+
+		/* the end of a word from an earlier block */
+		if (in_token) {
+			int e;
+
+			if (!ends)
+				continue;
+			e = __builtin_ctzll(ends);
+			ends &= ends - 1;
+			before = (1ULL << e) - 1;
+			span = &spans[count++];
+			span->start = start;
+			span->length = base + e - start;
+			if (span->length < BLOCK)
+				span->kind = drop_non_call(block_token_kind(prev, ~((1ULL << (start + BLOCK - base)) - 1),
+				    c, before, start + BLOCK - base, span->length), text + start, span->length);
+			else
+				span->kind = token_kind(text + start, span->length);
+			span->line_start = line_start;
+			line_start = in_token = false;
+			if (count == max_spans) {
+				if (scanned)
+					*scanned = base + e;
+				return count;
+			}
+		}
+
+		/* then words start and end in turn */
+		while (starts) {
+			int s = __builtin_ctzll(starts), e;
+
+			starts &= starts - 1;
+			before = (1ULL << s) - 1;
+			line_start |= (newlines & before) != 0;
+			newlines &= ~before;
+			start = base + s;
+			if (!ends) {
+				in_token = true;
+				break;
+			}
+			e = __builtin_ctzll(ends);
+			ends &= ends - 1;
+			span = &spans[count++];
+			span->start = start;
+			span->length = e - s;
+			span->kind = drop_non_call(block_token_kind(c, ((1ULL << e) - 1) & ~before, c, 0, s, span->length),
+			    text + start, span->length);
+			span->line_start = line_start;
+			line_start = false;
+			if (count == max_spans) {
+				if (scanned)
+					*scanned = base + e;
+				return count;
+			}
+		}
+		line_start |= newlines != 0;
+	}
+	/* a word running to the end of a multiple of BLOCK bytes */
+	if (in_token) {
+		spans[count].start = start;
+		spans[count].length = size - start;
+		spans[count].kind = token_kind(text + start, size - start);
+		spans[count].line_start = line_start;
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,418 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+   clu - Callsign Looker Upper
+   Copyright (C) 2025        Shawn Rutledge <s@ecloud.org>
+*/
+
+/*
+ * zonemap.c - which CQ zone, ITU zone and entity a location is in
+ *
+ * cty.dat gives the zones of a prefix, but a big country spans several, so
+ * a station's zones depend on where it is. The boundaries come from a text
+ * file, zones.dat, with one polygon per line:
+ *
+ *   CQ 5 -100,49 -70,49 -70,20 -100,20
+ *   ITU 8 ...
+ *   DXCC K ...
+ *
+ * that is, the layer, the zone number (or for DXCC, the entity's primary
+ * prefix in cty.dat), and the vertices as longitude,latitude pairs in
+ * degrees. Edges are straight in longitude and latitude, as zone maps are
+ * drawn, and a polygon must not cross the 180th meridian: split it there.
+ * A zone or entity may have any number of polygons; lines starting with #
+ * are comments.
+ *
+ * To answer without testing every polygon, the world is divided into cells
+ * of 1 degree by 1 degree, and each cell lists the polygons that reach it:
+ * either the whole cell is inside, or the polygon's edges that cross the
+ * cell are listed along with whether a reference point in the cell is
+ * inside. A location is then inside if the reference point is, and the line
+ * between them crosses an even number of those edges, or if the point is
+ * not and the line crosses an odd number. The reference point is a little
+ * off the centre, at no simple fraction of a degree, so that it won't lie
+ * on a boundary drawn between whole or half degrees.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dxcc.h"
+
+#define CELLS_X 360
+#define CELLS_Y 180
+#define CELL_COUNT (CELLS_X * CELLS_Y)
+#define REF_X 0.48717 /* the reference point, from the cell's corner */
+#define REF_Y 0.50963
+#define WHOLE ((guint)-1) /* a cell entry for a polygon that covers the cell */
+
+typedef struct
+{
+	double x0, y0, x1, y1; /* longitude, latitude */
+} edge;
+
+typedef struct
+{
+	unsigned char layer;
+	int zone;
+	char entity[DXCC_MAX_CALLSIGN + 1];
+} polygon;
+
+typedef struct
+{
+	guint polygon;
+	bool ref_inside;
+	guint first, count; /* in edge_refs, or first is WHOLE */
+} cell_entry;
+
+struct zone_map
+{
+	GArray* polygons; /* of polygon */
+	GArray* edges; /* of edge, of all polygons */
+	guint* cell_start; /* CELL_COUNT + 1 offsets into entries */
+	cell_entry* entries;
+	guint* edge_refs;
+};
+
+/* while building: a polygon reaching a cell, with one of its edges or none */
+typedef struct
+{
+	guint cell, polygon, edge; /* edge is WHOLE for the reference point */
+	bool inside;
+} cell_item;
+
+static int cell_x(double longitude)
+{
+	int x = (int)floor(longitude + 180.0);
+
+	return x < 0 ? 0 : x >= CELLS_X ? CELLS_X - 1 : x;
+}
+
+static int cell_y(double latitude)
+{
+	int y = (int)floor(latitude + 90.0);
+
+	return y < 0 ? 0 : y >= CELLS_Y ? CELLS_Y - 1 : y;
+}
+
+static void add_item(GArray* items, guint cell, guint polygon, guint edge, bool inside)
+{
+	cell_item item = { cell, polygon, edge, inside };
+
+	g_array_append_val(items, item);
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+	double da = *(const double*)a, db = *(const double*)b;
+
+	return da < db ? -1 : da > db;
+}
+
+/*
+   list the cells that polygon \a p, with \a n edges from \a first, reaches
+   in \a items: each edge in each cell of its bounding box, then for each
+   cell in the polygon's bounding box, whether the reference point is
+   inside, by crossings along the row; \a touched is scratch, all false
+ */
+static void rasterize(const zone_map* map, guint p, guint first, guint n, GArray* items, bool* touched)
+{
+	const edge* edges = &g_array_index(map->edges, edge, first);
+	double* crossings = g_new(double, n);
+	int bx0 = CELLS_X, bx1 = -1, by0 = CELLS_Y, by1 = -1;
+
+	for (guint e = 0; e < n; ++e) {
+		int x0 = cell_x(fmin(edges[e].x0, edges[e].x1)), x1 = cell_x(fmax(edges[e].x0, edges[e].x1));
+		int y0 = cell_y(fmin(edges[e].y0, edges[e].y1)), y1 = cell_y(fmax(edges[e].y0, edges[e].y1));
+
+		for (int x = x0; x <= x1; ++x) {
+			for (int y = y0; y <= y1; ++y) {
+				add_item(items, x * CELLS_Y + y, p, first + e, false);
+				touched[x * CELLS_Y + y] = true;
+			}
+		}
+		bx0 = MIN(bx0, x0);
+		bx1 = MAX(bx1, x1);
+		by0 = MIN(by0, y0);
+		by1 = MAX(by1, y1);
+	}
+
+	for (int y = by0; y <= by1; ++y) {
+		double ref_y = y - 90.0 + REF_Y;
+		guint count = 0, crossed = 0;
+
+		for (guint e = 0; e < n; ++e) {
+			const edge* d = &edges[e];
+
+			if ((d->y0 > ref_y) != (d->y1 > ref_y))
+				crossings[count++] = d->x0 + (ref_y - d->y0) * (d->x1 - d->x0) / (d->y1 - d->y0);
+		}
+		qsort(crossings, count, sizeof(double), compare_doubles);
+		for (int x = bx0; x <= bx1; ++x) {
+			double ref_x = x - 180.0 + REF_X;
+			guint cell = x * CELLS_Y + y;
+			bool inside;
+
+			while (crossed < count && crossings[crossed] < ref_x)
+				++crossed;
+			inside = crossed & 1;
+			if (touched[cell])
+				add_item(items, cell, p, WHOLE, inside);
+			else if (inside)
+				add_item(items, cell, p, WHOLE, true);
+			touched[cell] = false;
+		}
+	}
+	g_free(crossings);
+}
+
+/*
+   turn \a items into the cells of \a map: sorted by cell, stably, each
+   polygon's items in a cell are its edges and then its reference point
+ */
+static void build_cells(zone_map* map, GArray* items)
+{
+	const cell_item* item = (const cell_item*)items->data;
+	guint* order = g_new(guint, items->len ? items->len : 1);
+	guint* next = g_new0(guint, CELL_COUNT + 1);
+	guint nentries = 0, nrefs = 0, first, k = 0;
+
+	for (guint j = 0; j < items->len; ++j) {
+		++next[item[j].cell + 1];
+		if (item[j].edge == WHOLE)
+			++nentries;
+		else
+			++nrefs;
+	}
+	for (guint cell = 0; cell < CELL_COUNT; ++cell)
+		next[cell + 1] += next[cell];
+	for (guint j = 0; j < items->len; ++j)
+		order[next[item[j].cell]++] = j;
+
+	map->cell_start = g_new(guint, CELL_COUNT + 1);
+	map->entries = g_new(cell_entry, nentries ? nentries : 1);
+	map->edge_refs = g_new(guint, nrefs ? nrefs : 1);
+	nentries = nrefs = 0;
+	for (guint cell = 0; cell < CELL_COUNT; ++cell) {
+		map->cell_start[cell] = nentries;
+		for (first = nrefs; k < items->len && item[order[k]].cell == cell; ++k) {
+			const cell_item* it = &item[order[k]];
+			cell_entry* entry;
+
+			if (it->edge != WHOLE) {
+				map->edge_refs[nrefs++] = it->edge;
+				continue;
+			}
+			entry = &map->entries[nentries++];
+			entry->polygon = it->polygon;
+			entry->ref_inside = it->inside;
+			entry->count = nrefs - first;
+			entry->first = entry->count ? first : WHOLE;
+			first = nrefs;
+		}
+	}
+	map->cell_start[CELL_COUNT] = nentries;
+	g_free(next);
+	g_free(order);
+}
+
+/* parse one line of zones.dat into \a map; false if it's malformed */
+static bool parse_polygon(zone_map* map, char* line)
+{
+	char *save = NULL, *layer = strtok_r(line, " \t\r", &save), *id = strtok_r(NULL, " \t\r", &save), *vertex;
+	double first_x = 0, first_y = 0, last_x = 0, last_y = 0;
+	guint count = 0;
+	polygon p = { 0 };
+	edge closing;
+
+	if (!layer || !id)
+		return false;
+	if (!strcmp(layer, "CQ"))
+		p.layer = ZONE_CQ;
+	else if (!strcmp(layer, "ITU"))
+		p.layer = ZONE_ITU;
+	else if (!strcmp(layer, "DXCC"))
+		p.layer = ZONE_ENTITY;
+	else
+		return false;
+	if (p.layer == ZONE_ENTITY)
+		g_strlcpy(p.entity, id, sizeof(p.entity));
+	else if ((p.zone = atoi(id)) <= 0)
+		return false;
+
+	while ((vertex = strtok_r(NULL, " \t\r", &save))) {
+		char* end;
+		double x = strtod(vertex, &end), y;
+
+		if (*end != ',')
+			return false;
+		y = strtod(end + 1, &end);
+		if (*end || x < -180.0 || x > 180.0 || y < -90.0 || y > 90.0)
+			return false;
+		if (count++) {
+			edge e = { last_x, last_y, x, y };
+
+			g_array_append_val(map->edges, e);
+		} else {
+			first_x = x;
+			first_y = y;
+		}
+		last_x = x;
+		last_y = y;
+	}
+	if (count < 3)
+		return false;
+	closing = (edge){ last_x, last_y, first_x, first_y };
+	g_array_append_val(map->edges, closing);
+	g_array_append_val(map->polygons, p);
+	return true;
+}
+
+/*!
+    Load the polygons of zones.dat from \a path (absolute, or relative to
+    the directory of the executable), and index them. Returns NULL if the
+    file can't be read, or a line of it can't be parsed.
+ */
+zone_map* zone_map_load(const char* path)
+{
+	char buf[PATH_MAX], *contents, *line, *next;
+	GArray *starts, *items;
+	zone_map* map;
+	bool* touched;
+	gsize length;
+	int lineno = 0;
+
+	set_data_path_relative(buf, sizeof(buf), path);
+	if (!g_file_get_contents(buf, &contents, &length, NULL)) {
+		printf("didn't find %s\n", buf);
+		return NULL;
+	}
+	map = g_new0(zone_map, 1);
+	map->polygons = g_array_new(FALSE, FALSE, sizeof(polygon));
+	map->edges = g_array_new(FALSE, FALSE, sizeof(edge));
+	starts = g_array_new(FALSE, FALSE, sizeof(guint));
+	for (line = contents; line; line = next) {
+		guint start = map->edges->len;
+
+		++lineno;
+		if ((next = strchr(line, '\n')))
+			*next++ = 0;
+		line += strspn(line, " \t\r");
+		if (!*line || *line == '#')
+			continue;
+		if (!parse_polygon(map, line)) {
+			printf("%s:%d: not a polygon\n", buf, lineno);
+			g_free(contents);
+			g_array_free(starts, TRUE);
+			zone_map_free(map);
+			return NULL;
+		}
+		g_array_append_val(starts, start);
+	}
+	g_free(contents);
+
+	items = g_array_new(FALSE, FALSE, sizeof(cell_item));
+	touched = g_new0(bool, CELL_COUNT);
+	for (guint p = 0; p < map->polygons->len; ++p) {
+		guint first = g_array_index(starts, guint, p);
+		guint end = p + 1 < map->polygons->len ? g_array_index(starts, guint, p + 1) : map->edges->len;
+
+		rasterize(map, p, first, end - first, items, touched);
+	}
+	build_cells(map, items);
+	g_free(touched);
+	g_array_free(items, TRUE);
+	g_array_free(starts, TRUE);
+	return map;
+}
+
+void zone_map_free(zone_map* map)
+{
+	if (!map)
+		return;
+	g_array_free(map->polygons, TRUE);
+	g_array_free(map->edges, TRUE);
+	g_free(map->cell_start);
+	g_free(map->entries);
+	g_free(map->edge_refs);
+	g_free(map);
+}
+
+/* which side of the line through a and b that c is on: > 0 for the left */
+static inline double orient(double ax, double ay, double bx, double by, double cx, double cy)
+{
+	return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/* whether the segment from r to q crosses \a e; the ends count as on the right */
+static inline bool crosses(double rx, double ry, double qx, double qy, const edge* e)
+{
+	return (orient(e->x0, e->y0, e->x1, e->y1, rx, ry) > 0) != (orient(e->x0, e->y0, e->x1, e->y1, qx, qy) > 0)
+	    && (orient(rx, ry, qx, qy, e->x0, e->y0) > 0) != (orient(rx, ry, qx, qy, e->x1, e->y1) > 0);
+}
+
+/*!
+    Find the CQ zone, ITU zone and entity that \a longitude, \a latitude is
+    in, according to \a map, and put them into \a result: 0 for a zone, or
+    NULL for the entity (its primary prefix), where no polygon has it.
+    Returns false if it's in none of them.
+ */
+bool zone_map_locate(const zone_map* map, double longitude, double latitude, zone_location* result)
+{
+	guint cell, found = 0;
+	double ref_x, ref_y;
+
+	memset(result, 0, sizeof(*result));
+	if (!map || !(longitude >= -180.0 && longitude <= 180.0) || !(latitude >= -90.0 && latitude <= 90.0))
+		return false;
+	cell = cell_x(longitude) * CELLS_Y + cell_y(latitude);
+	ref_x = floor(longitude + 180.0) - 180.0 + REF_X;
+	ref_y = floor(latitude + 90.0) - 90.0 + REF_Y;
+	if (longitude == 180.0)
+		ref_x -= 1.0;
+	if (latitude == 90.0)
+		ref_y -= 1.0;
+
+	for (guint i = map->cell_start[cell]; i < map->cell_start[cell + 1] && found != 7; ++i) {
+		const cell_entry* entry = &map->entries[i];
+		const polygon* p = &g_array_index(map->polygons, polygon, entry->polygon);
+		bool inside = entry->ref_inside;
+
+		if (found & (1 << p->layer))
+			continue;
+		if (entry->first != WHOLE) {
+			for (guint j = entry->first; j < entry->first + entry->count; ++j)
+				inside ^= crosses(ref_x, ref_y, longitude, latitude,
+				    &g_array_index(map->edges, edge, map->edge_refs[j]));
+		}
+		if (!inside)
+			continue;
+		found |= 1 << p->layer;
+		if (p->layer == ZONE_CQ)
+			result->cq = p->zone;
+		else if (p->layer == ZONE_ITU)
+			result->itu = p->zone;
+		else
+			result->entity = p->entity;
+	}
+	return found != 0;
+}
+
+/*!
+    Set the CQ and ITU zones of \a info from its location, where \a map
+    knows them; for example after set_location_from_grid(). The entity
+    stays as the callsign has it. Returns false if neither was found.
+ */
+bool set_zones_from_location(dxcc_data* info, const zone_map* map)
+{
+	zone_location where;
+
+	if (!info || !zone_map_locate(map, info->longitude, info->latitude, &where))
+		return false;
+	if (where.cq)
+		info->cq = where.cq;
+	if (where.itu)
+		info->itu = where.itu;
+	return where.cq || where.itu;
+}